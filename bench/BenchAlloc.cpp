@@ -0,0 +1,134 @@
+#include "BenchAlloc.h"
+
+#include <atomic>
+#include <malloc.h>
+#include <new>
+#include <stdlib.h>
+
+extern "C"
+{
+    void *__real_malloc(size_t size);
+    void __real_free(void *ptr);
+    void *__real_realloc(void *ptr, size_t size);
+    void *__real_calloc(size_t count, size_t size);
+}
+
+static BenchAllocStats stats = {0, 0, 0, 0};
+
+// The REST worker allocates from its own thread. A spinlock rather than a
+// mutex, since std::mutex may itself allocate on first use.
+static std::atomic_flag statsLock = ATOMIC_FLAG_INIT;
+
+static void trackAlloc(void *ptr)
+{
+    if (ptr == nullptr)
+        return;
+    size_t size = malloc_usable_size(ptr);
+    while (statsLock.test_and_set(std::memory_order_acquire))
+        ;
+    stats.allocations++;
+    stats.liveBytes += size;
+    if (stats.liveBytes > stats.peakBytes)
+        stats.peakBytes = stats.liveBytes;
+    statsLock.clear(std::memory_order_release);
+}
+
+static void trackFree(void *ptr)
+{
+    if (ptr == nullptr)
+        return;
+    size_t size = malloc_usable_size(ptr);
+    while (statsLock.test_and_set(std::memory_order_acquire))
+        ;
+    stats.frees++;
+    stats.liveBytes = size > stats.liveBytes ? 0 : stats.liveBytes - size;
+    statsLock.clear(std::memory_order_release);
+}
+
+extern "C"
+{
+    void *__wrap_malloc(size_t size)
+    {
+        void *ptr = __real_malloc(size);
+        trackAlloc(ptr);
+        return ptr;
+    }
+
+    void __wrap_free(void *ptr)
+    {
+        trackFree(ptr);
+        __real_free(ptr);
+    }
+
+    void *__wrap_realloc(void *ptr, size_t size)
+    {
+        trackFree(ptr);
+        void *result = __real_realloc(ptr, size);
+        trackAlloc(result != nullptr ? result : (size != 0 ? ptr : nullptr));
+        return result;
+    }
+
+    void *__wrap_calloc(size_t count, size_t size)
+    {
+        void *ptr = __real_calloc(count, size);
+        trackAlloc(ptr);
+        return ptr;
+    }
+}
+
+// libstdc++'s operator new calls malloc from inside the shared library, where
+// --wrap can't reach it, so route it through our (wrapped) malloc explicitly.
+void *operator new(size_t size)
+{
+    void *ptr = malloc(size ? size : 1);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+void benchAllocReset()
+{
+    stats.allocations = 0;
+    stats.frees = 0;
+    stats.peakBytes = stats.liveBytes;
+}
+
+BenchAllocStats benchAllocSnapshot()
+{
+    return stats;
+}
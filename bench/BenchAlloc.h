@@ -0,0 +1,20 @@
+#ifndef BENCH_ALLOC_H
+#define BENCH_ALLOC_H
+
+#include <stddef.h>
+
+// Heap accounting for the native benchmark build. The native environment
+// links with -Wl,--wrap=malloc/free/realloc/calloc so every allocation made
+// by the library, ArduinoJson and the String shim is routed through here.
+struct BenchAllocStats
+{
+    unsigned long allocations;
+    unsigned long frees;
+    size_t liveBytes;
+    size_t peakBytes;
+};
+
+void benchAllocReset();
+BenchAllocStats benchAllocSnapshot();
+
+#endif // BENCH_ALLOC_H
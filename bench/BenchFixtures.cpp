@@ -0,0 +1,253 @@
+#include "BenchFixtures.h"
+
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+namespace fixtures
+{
+    const char *HELLO = R"({"t":null,"s":null,"op":10,"d":{"heartbeat_interval":41250,"_trace":["[\"gateway-prd-us-east1-b-0x7f\",{\"micros\":0.0}]"]}})";
+
+    const char *READY = R"({"t":"READY","s":1,"op":0,"d":{"v":10,"user_settings":{},"user":{"verified":true,"username":"esp32-bench","mfa_enabled":false,"id":"1316019254599880704","global_name":null,"flags":0,"email":null,"discriminator":"7145","bot":true,"avatar":null},"session_type":"normal","session_id":"9f2c1e7f3d6a4b0e8c5d2a1b3c4d5e6f","resume_gateway_url":"wss://gateway-us-east1-b.discord.gg","relationships":[],"private_channels":[],"presences":[],"guilds":[{"unavailable":true,"id":"1007597357912821780"},{"unavailable":true,"id":"1110945720101597184"}],"guild_join_requests":[],"geo_ordered_rtc_regions":["newark","us-east","us-central","atlanta","us-south"],"auth":{},"application":{"id":"1316019254599880704","flags":565248},"_trace":["[\"gateway-prd-us-east1-b-0x7f\",{\"micros\":84211}]"]}})";
+
+    const char *HEARTBEAT_ACK = R"({"t":null,"s":null,"op":11,"d":null})";
+
+    const char *MESSAGE_CREATE = R"({"t":"MESSAGE_CREATE","s":42,"op":0,"d":{"type":0,"tts":false,"timestamp":"2025-09-14T08:21:43.512000+00:00","referenced_message":null,"pinned":false,"nonce":"1416703328436879360","mentions":[{"username":"sensor-admin","public_flags":0,"id":"403155427541680129","global_name":"Sensor Admin","discriminator":"0","clan":null,"avatar_decoration_data":null,"avatar":"4f6c1d1e0b2a3c4d5e6f708192a3b4c5"}],"mention_roles":[],"mention_everyone":false,"member":{"roles":["1007601240810930237"],"premium_since":null,"pending":false,"nick":null,"mute":false,"joined_at":"2022-08-10T14:02:11.408000+00:00","flags":0,"deaf":false,"communication_disabled_until":null,"banner":null,"avatar":null},"id":"1416703330399813652","flags":0,"embeds":[],"edited_timestamp":null,"content":"<@403155427541680129> !status greenhouse-3 temperature=24.6C humidity=61% soil=0.42","components":[],"channel_type":0,"channel_id":"1007597358579716106","author":{"username":"field-tech","public_flags":64,"id":"697163431288258560","global_name":"Field Tech","discriminator":"0","clan":null,"avatar_decoration_data":null,"avatar":"a_9c8b7a6f5e4d3c2b1a0f9e8d7c6b5a4f"},"attachments":[],"guild_id":"1007597357912821780"}})";
+
+    const char *MESSAGE_DELETE = R"({"t":"MESSAGE_DELETE","s":43,"op":0,"d":{"id":"1416703330399813652","channel_id":"1007597358579716106","guild_id":"1007597357912821780"}})";
+
+    const char *REST_USER = R"({"id":"697163431288258560","username":"field-tech","avatar":"a_9c8b7a6f5e4d3c2b1a0f9e8d7c6b5a4f","discriminator":"0","public_flags":64,"flags":64,"banner":null,"accent_color":3447003,"global_name":"Field Tech","avatar_decoration_data":null,"banner_color":"#3498db","clan":null})";
+
+    const char *REST_MESSAGE = R"({"type":0,"content":"ESP32 bench message","mentions":[],"mention_roles":[],"attachments":[],"embeds":[],"timestamp":"2025-09-14T08:21:44.001000+00:00","edited_timestamp":null,"flags":0,"components":[],"id":"1416703332451127296","channel_id":"1007597358579716106","author":{"id":"1316019254599880704","username":"esp32-bench","avatar":null,"discriminator":"7145","public_flags":0,"flags":0,"bot":true,"banner":null,"accent_color":null,"global_name":null,"avatar_decoration_data":null,"banner_color":null,"clan":null},"pinned":false,"mention_everyone":false,"tts":false})";
+
+    const char *REST_GUILD = R"({"id":"1007597357912821780","name":"Greenhouse Ops","icon":"8342729096ea3675442027381ff50dfe","description":null,"home_header":null,"splash":null,"discovery_splash":null,"features":["COMMUNITY","NEWS"],"banner":null,"owner_id":"403155427541680129","application_id":null,"region":"us-east","afk_channel_id":null,"afk_timeout":300,"system_channel_id":"1007597358579716106","system_channel_flags":0,"widget_enabled":false,"widget_channel_id":null,"verification_level":1,"roles":[{"id":"1007597357912821780","name":"@everyone","permissions":"1071698660929","position":0,"color":0,"hoist":false,"managed":false,"mentionable":false,"icon":null,"unicode_emoji":null,"flags":0}],"default_message_notifications":1,"mfa_level":0,"explicit_content_filter":2,"max_presences":null,"max_members":500000,"max_stage_video_channel_users":50,"max_video_channel_users":25,"vanity_url_code":null,"premium_tier":0,"premium_subscription_count":0,"preferred_locale":"en-US","rules_channel_id":"1007601240810930240","safety_alerts_channel_id":null,"public_updates_channel_id":"1007601240810930241","hub_type":null,"premium_progress_bar_enabled":false,"latest_onboarding_question_id":null,"nsfw":false,"nsfw_level":0,"emojis":[],"stickers":[],"incidents_data":null,"inventory_settings":null,"embed_enabled":false,"embed_channel_id":null})";
+
+    static std::string snowflake(unsigned long long base, int index)
+    {
+        char buf[24];
+        snprintf(buf, sizeof(buf), "%llu", base + (unsigned long long)index * 4194304ULL);
+        return std::string(buf);
+    }
+
+    std::string guildCreate(int channels, int roles, int members)
+    {
+        std::string out;
+        out.reserve(512 + channels * 420 + roles * 260 + members * 560);
+        out += R"({"t":"GUILD_CREATE","s":2,"op":0,"d":{"id":"1007597357912821780","name":"Greenhouse Ops","icon":"8342729096ea3675442027381ff50dfe","icon_hash":null,"splash":null,"discovery_splash":null,"owner_id":"403155427541680129","region":"us-east","afk_channel_id":null,"afk_timeout":300,"widget_enabled":false,"widget_channel_id":null,"verification_level":1,"default_message_notifications":1,"explicit_content_filter":2,"mfa_level":0,"application_id":null,"system_channel_id":"1007597358579716106","system_channel_flags":0,"rules_channel_id":"1007601240810930240","max_presences":null,"max_members":500000,"vanity_url_code":null,"description":null,"banner":null,"premium_tier":0,"premium_subscription_count":0,"preferred_locale":"en-US","public_updates_channel_id":"1007601240810930241","max_video_channel_users":25,"max_stage_video_channel_users":50,"nsfw_level":0,"premium_progress_bar_enabled":false,"safety_alerts_channel_id":null,"unavailable":false,"large":true,"joined_at":"2024-12-13T05:31:02.118000+00:00",)";
+        out += "\"member_count\":" + std::to_string(members) + ",";
+        out += R"("features":["COMMUNITY","NEWS"],"emojis":[],"stickers":[],"voice_states":[],"threads":[],"stage_instances":[],"guild_scheduled_events":[],"embedded_activities":[],)";
+
+        out += "\"channels\":[";
+        for (int i = 0; i < channels; i++)
+        {
+            if (i > 0)
+                out += ",";
+            out += R"({"version":1726300000000,"type":0,"topic":"Readings from greenhouse sensor bank )" + std::to_string(i) + R"(","rate_limit_per_user":0,"position":)" + std::to_string(i) + R"(,"permission_overwrites":[{"type":0,"id":"1007597357912821780","deny":"2048","allow":"0"}],"parent_id":"1007597358579716105","nsfw":false,"name":"sensor-bank-)" + std::to_string(i) + R"(","last_message_id":")" + snowflake(1416703330399813652ULL, i) + R"(","id":")" + snowflake(1007597358579716106ULL, i) + R"(","icon_emoji":null,"flags":0})";
+        }
+        out += "],\"roles\":[";
+        for (int i = 0; i < roles; i++)
+        {
+            if (i > 0)
+                out += ",";
+            out += R"({"version":1726300000000,"unicode_emoji":null,"tags":{},"position":)" + std::to_string(i) + R"(,"permissions":"1071698660929","name":"operator-)" + std::to_string(i) + R"(","mentionable":false,"managed":false,"id":")" + snowflake(1007601240810930237ULL, i) + R"(","icon":null,"hoist":false,"flags":0,"colors":{"tertiary_color":null,"secondary_color":null,"primary_color":3447003},"color":3447003})";
+        }
+        out += "],\"members\":[";
+        for (int i = 0; i < members; i++)
+        {
+            if (i > 0)
+                out += ",";
+            out += R"({"user":{"username":"member-)" + std::to_string(i) + R"(","public_flags":0,"primary_guild":null,"id":")" + snowflake(403155427541680129ULL, i) + R"(","global_name":"Member )" + std::to_string(i) + R"(","display_name":null,"discriminator":"0","collectibles":null,"bot":false,"avatar_decoration_data":null,"avatar":null},"roles":["1007601240810930237"],"premium_since":null,"pending":false,"nick":null,"mute":false,"joined_at":"2023-02-01T10:00:00.000000+00:00","flags":0,"deaf":false,"communication_disabled_until":null,"banner":null,"avatar":null})";
+        }
+        out += "],\"presences\":[";
+        for (int i = 0; i < members; i++)
+        {
+            if (i > 0)
+                out += ",";
+            out += R"({"user":{"id":")" + snowflake(403155427541680129ULL, i) + R"("},"status":"online","client_status":{"desktop":"online"},"broadcast":null,"activities":[]})";
+        }
+        out += "]}}";
+        return out;
+    }
+
+    std::string channelMessages(int count)
+    {
+        return channelMessages(count, count);
+    }
+
+    unsigned long long messageId(int index)
+    {
+        return 1416703330399813652ULL + (unsigned long long)index * 4194304ULL;
+    }
+
+    int messageIndex(unsigned long long id)
+    {
+        return (int)((id - 1416703330399813652ULL) / 4194304ULL);
+    }
+
+    std::string channelMessages(int count, int newest)
+    {
+        if (count > newest)
+            count = newest > 0 ? newest : 0;
+        std::string out;
+        out.reserve(2 + count * 900);
+        out += "[";
+        for (int i = 0; i < count; i++)
+        {
+            if (i > 0)
+                out += ",";
+            out += R"({"type":0,"content":"greenhouse-3 reading #)" + std::to_string(i) + R"( temperature=24.6C humidity=61% soil=0.42","mentions":[],"mention_roles":[],"attachments":[],"embeds":[],"timestamp":"2025-09-14T08:21:43.512000+00:00","edited_timestamp":null,"flags":0,"components":[],"id":")" + snowflake(1416703330399813652ULL, newest - i) + R"(","channel_id":"1007597358579716106","author":{"id":"1316019254599880704","username":"esp32-bench","avatar":null,"discriminator":"7145","public_flags":0,"flags":0,"bot":true,"banner":null,"accent_color":null,"global_name":null,"avatar_decoration_data":null,"banner_color":null,"clan":null},"pinned":false,"mention_everyone":false,"tts":false})";
+        }
+        out += "]";
+        return out;
+    }
+
+    std::vector<std::string> zlibStream(const std::vector<std::string> &messages)
+    {
+        std::vector<std::string> frames;
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        deflateInit(&stream, Z_DEFAULT_COMPRESSION);
+
+        for (size_t i = 0; i < messages.size(); i++)
+        {
+            std::string frame;
+            char buffer[16384];
+            stream.next_in = (Bytef *)messages[i].data();
+            stream.avail_in = (uInt)messages[i].size();
+            do
+            {
+                stream.next_out = (Bytef *)buffer;
+                stream.avail_out = sizeof(buffer);
+                deflate(&stream, Z_SYNC_FLUSH);
+                frame.append(buffer, sizeof(buffer) - stream.avail_out);
+            } while (stream.avail_out == 0);
+            frames.push_back(frame);
+        }
+
+        deflateEnd(&stream);
+        return frames;
+    }
+
+    static void putU32(std::string &out, uint32_t value)
+    {
+        out += (char)(value >> 24);
+        out += (char)(value >> 16);
+        out += (char)(value >> 8);
+        out += (char)value;
+    }
+
+    static void putAtom(std::string &out, const char *name, size_t length)
+    {
+        out += (char)119; // SMALL_ATOM_UTF8_EXT
+        out += (char)length;
+        out.append(name, length);
+    }
+
+    static bool isSnowflake(const char *text, size_t length)
+    {
+        if (length < 17 || length > 20)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < length; i++)
+        {
+            if (text[i] < '0' || text[i] > '9')
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void putTerm(std::string &out, JsonVariantConst value)
+    {
+        if (value.is<JsonObjectConst>())
+        {
+            JsonObjectConst object = value.as<JsonObjectConst>();
+            out += (char)116; // MAP_EXT
+            putU32(out, (uint32_t)object.size());
+            for (JsonPairConst pair : object)
+            {
+                putAtom(out, pair.key().c_str(), pair.key().size());
+                putTerm(out, pair.value());
+            }
+        }
+        else if (value.is<JsonArrayConst>())
+        {
+            JsonArrayConst array = value.as<JsonArrayConst>();
+            if (array.size() > 0)
+            {
+                out += (char)108; // LIST_EXT
+                putU32(out, (uint32_t)array.size());
+                for (JsonVariantConst element : array)
+                {
+                    putTerm(out, element);
+                }
+            }
+            out += (char)106; // NIL_EXT
+        }
+        else if (value.is<bool>())
+        {
+            putAtom(out, value.as<bool>() ? "true" : "false", value.as<bool>() ? 4 : 5);
+        }
+        else if (value.is<long>())
+        {
+            long number = value.as<long>();
+            if (number >= 0 && number < 256)
+            {
+                out += (char)97; // SMALL_INTEGER_EXT
+                out += (char)number;
+            }
+            else
+            {
+                out += (char)98; // INTEGER_EXT
+                putU32(out, (uint32_t)number);
+            }
+        }
+        else if (value.is<double>())
+        {
+            double number = value.as<double>();
+            uint64_t bits = 0;
+            memcpy(&bits, &number, sizeof(bits));
+            out += (char)70; // NEW_FLOAT_EXT
+            putU32(out, (uint32_t)(bits >> 32));
+            putU32(out, (uint32_t)bits);
+        }
+        else if (value.is<JsonString>())
+        {
+            JsonString text = value.as<JsonString>();
+            if (isSnowflake(text.c_str(), text.size()))
+            {
+                uint64_t id = strtoull(text.c_str(), nullptr, 10);
+                out += (char)110; // SMALL_BIG_EXT
+                out += (char)8;
+                out += (char)0;
+                for (int i = 0; i < 8; i++)
+                {
+                    out += (char)(id >> (8 * i));
+                }
+            }
+            else
+            {
+                out += (char)109; // BINARY_EXT
+                putU32(out, (uint32_t)text.size());
+                out.append(text.c_str(), text.size());
+            }
+        }
+        else
+        {
+            putAtom(out, "nil", 3);
+        }
+    }
+
+    std::string etfFromJson(const std::string &json)
+    {
+        JsonDocument doc;
+        deserializeJson(doc, json);
+        std::string out(1, (char)131);
+        putTerm(out, doc.as<JsonVariantConst>());
+        return out;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef BENCH_FIXTURES_H
+#define BENCH_FIXTURES_H
+
+#include <string>
+#include <vector>
+
+// Gateway frames and REST bodies captured from a test guild, with IDs and
+// content scrubbed. The large payloads are synthesized from recorded
+// elements so their size can be scaled.
+namespace fixtures
+{
+    extern const char *HELLO;
+    extern const char *READY;
+    extern const char *HEARTBEAT_ACK;
+    extern const char *MESSAGE_CREATE;
+    extern const char *MESSAGE_DELETE;
+    extern const char *REST_USER;
+    extern const char *REST_MESSAGE;
+    extern const char *REST_GUILD;
+
+    std::string guildCreate(int channels, int roles, int members);
+    std::string channelMessages(int count);
+    // A page of history from message `newest` back, as returned for
+    // before=messageId(newest + 1); indices start at 1
+    std::string channelMessages(int count, int newest);
+    unsigned long long messageId(int index);
+    int messageIndex(unsigned long long id);
+
+    // Compresses messages the way the gateway does for compress=zlib-stream:
+    // one deflate stream, each message ended with a sync flush
+    std::vector<std::string> zlibStream(const std::vector<std::string> &messages);
+
+    // Re-encodes a JSON frame as the gateway sends it with encoding=etf:
+    // atom keys, nil for null, snowflakes as 64-bit integers
+    std::string etfFromJson(const std::string &json);
+}
+
+#endif // BENCH_FIXTURES_H
@@ -0,0 +1,513 @@
+// Host benchmark for DiscordAPI, built by the `native` PlatformIO environment:
+//
+//   pio run -e native && .pio/build/native/program [filter]
+//
+// Recorded gateway frames and REST bodies are pushed through the real
+// library code via the WebSocketsClient/HTTPClient shims in lib/NativeShims.
+// Each case reports wall time, heap allocations and peak heap growth per
+// operation; the process exits non-zero if a case stops dispatching.
+
+#include <Arduino.h>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+#include "DiscordAPI.h"
+#include "BenchAlloc.h"
+#include "BenchFixtures.h"
+
+static unsigned long readyCount = 0;
+static unsigned long messageCount = 0;
+static unsigned long guildCount = 0;
+
+static void onBenchReady(DiscordUser user)
+{
+    readyCount++;
+}
+
+// Handlers usually only read a couple of fields; the materialized case
+// measures the cost of an owned copy on top of the view
+static bool materializeMessages = false;
+static DiscordMessage materializedMessage;
+
+static void onBenchMessage(const MessageView &message)
+{
+    if (materializeMessages)
+    {
+        message.materialize(materializedMessage);
+    }
+    if (message.channelId().isValid() && !message.contentStartsWith("!"))
+    {
+        messageCount++;
+    }
+}
+
+static unsigned long deleteCount = 0;
+
+static void onBenchMessageDelete(DiscordEventType type, JsonObject data)
+{
+    if (data["id"].as<Snowflake>().isValid())
+    {
+        deleteCount++;
+    }
+}
+
+static void onBenchGuildCreate(DiscordGuild guild)
+{
+    guildCount++;
+}
+
+static unsigned long streamedMembers = 0;
+
+static void onBenchGuildMember(Snowflake guildId, JsonObject member)
+{
+    streamedMembers++;
+}
+
+static unsigned long asyncCompleted = 0;
+
+static void onBenchAsyncSent(uint32_t requestId, const DiscordResponse &response, void *context)
+{
+    if (response.success)
+    {
+        asyncCompleted++;
+    }
+}
+
+static bool runCase(const char *filter, const char *name, unsigned long iterations, std::function<bool()> op)
+{
+    if (filter != nullptr && strstr(name, filter) == nullptr)
+    {
+        return true;
+    }
+
+    // Warm-up pass so one-off growth (shim buffers, lazily built tables)
+    // is not attributed to the steady state
+    if (!op())
+    {
+        printf("%-40s FAILED (warm-up)\n", name);
+        return false;
+    }
+
+    benchAllocReset();
+    BenchAllocStats before = benchAllocSnapshot();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        if (!op())
+        {
+            printf("%-40s FAILED (iteration %lu)\n", name, i);
+            return false;
+        }
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    BenchAllocStats after = benchAllocSnapshot();
+
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    printf("%-40s %8lu %12.0f %11.1f %14lu\n",
+           name,
+           iterations,
+           ns / iterations,
+           (double)(after.allocations - before.allocations) / iterations,
+           (unsigned long)(after.peakBytes - before.liveBytes));
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *filter = argc > 1 ? argv[1] : nullptr;
+
+    static DiscordAPI discord;
+    discord.onReady(onBenchReady);
+    discord.onMessage(onBenchMessage);
+    discord.onGuildCreate(onBenchGuildCreate);
+    discord.on(DISCORD_EVENT_MESSAGE_DELETE, onBenchMessageDelete);
+    discord.setBotToken("MTMxNjAxOTI1NDU5OTg4MDcwNA.Gbench.0000000000000000000000000000000000000");
+
+    std::string guildSmall = fixtures::guildCreate(20, 10, 50);
+    std::string guildLarge = fixtures::guildCreate(200, 60, 1000);
+    std::string history = fixtures::channelMessages(100);
+    bool chunkedHistory = false;
+    // Older pages, by URL, so the mock doesn't build them on every request
+    std::map<std::string, std::string> historyPages;
+
+    HTTPClient::setMockHandler([&](const String &method, const String &url, const String &body) {
+        HTTPMockResponse response;
+        int before = url.indexOf("before=");
+        if (before != -1)
+        {
+            std::string &page = historyPages[url.c_str()];
+            if (page.empty())
+            {
+                int limit = atoi(url.c_str() + url.indexOf("limit=") + 6);
+                int newest = fixtures::messageIndex(strtoull(url.c_str() + before + 7, nullptr, 10)) - 1;
+                page = fixtures::channelMessages(limit, newest);
+            }
+            response.body = page.c_str();
+        }
+        else if (url.indexOf("/messages?") != -1)
+        {
+            response.body = history.c_str();
+            response.chunked = chunkedHistory;
+        }
+        else if (url.indexOf("/messages") != -1)
+        {
+            response.body = fixtures::REST_MESSAGE;
+        }
+        else if (url.indexOf("/guilds/") != -1)
+        {
+            response.body = fixtures::REST_GUILD;
+        }
+        else if (url.indexOf("/users/") != -1)
+        {
+            response.body = fixtures::REST_USER;
+        }
+        else
+        {
+            response.code = 404;
+            response.body = R"({"message": "404: Not Found", "code": 0})";
+        }
+        // Never exhausted, so no request waits; the cost measured is tracking the bucket
+        response.headers.push_back(std::make_pair(String("X-RateLimit-Bucket"), String("80c17d2f203122d936070c88c8d10f33")));
+        response.headers.push_back(std::make_pair(String("X-RateLimit-Limit"), String("5")));
+        response.headers.push_back(std::make_pair(String("X-RateLimit-Remaining"), String("4")));
+        response.headers.push_back(std::make_pair(String("X-RateLimit-Reset-After"), String("1.000")));
+        return response;
+    });
+
+    // Thousands of requests per second against the mock; the client-side
+    // 50/s global limit would make the REST cases measure delay()
+    discord.setGlobalRateLimit(0);
+
+    discord.connectWebSocket();
+    WebSocketsClient *ws = WebSocketsClient::active();
+    if (ws == nullptr)
+    {
+        printf("connectWebSocket() did not start a client\n");
+        return 1;
+    }
+    ws->injectConnected();
+    ws->injectText(fixtures::HELLO, strlen(fixtures::HELLO));
+    ws->injectText(fixtures::READY, strlen(fixtures::READY));
+    if (!discord.isWebSocketConnected())
+    {
+        printf("Gateway session did not become ready\n");
+        return 1;
+    }
+    ws->clearSentFrames();
+
+    printf("%-40s %8s %12s %11s %14s\n", "benchmark", "iters", "ns/op", "allocs/op", "peak heap (B)");
+
+    bool ok = true;
+
+    ok &= runCase(filter, "gateway/HEARTBEAT_ACK", 20000, [&]() {
+        ws->injectText(fixtures::HEARTBEAT_ACK, strlen(fixtures::HEARTBEAT_ACK));
+        return true;
+    });
+
+    ok &= runCase(filter, "gateway/READY", 2000, [&]() {
+        unsigned long seen = readyCount;
+        ws->injectText(fixtures::READY, strlen(fixtures::READY));
+        return readyCount == seen + 1;
+    });
+
+    ok &= runCase(filter, "gateway/MESSAGE_CREATE", 20000, [&]() {
+        unsigned long seen = messageCount;
+        ws->injectText(fixtures::MESSAGE_CREATE, strlen(fixtures::MESSAGE_CREATE));
+        return messageCount == seen + 1;
+    });
+
+    materializeMessages = true;
+    ok &= runCase(filter, "gateway/MESSAGE_CREATE (materialized)", 20000, [&]() {
+        unsigned long seen = messageCount;
+        ws->injectText(fixtures::MESSAGE_CREATE, strlen(fixtures::MESSAGE_CREATE));
+        return messageCount == seen + 1 && materializedMessage.mentions.size() == 1;
+    });
+    materializeMessages = false;
+
+    ok &= runCase(filter, "gateway/MESSAGE_DELETE (on handler)", 20000, [&]() {
+        unsigned long seen = deleteCount;
+        ws->injectText(fixtures::MESSAGE_DELETE, strlen(fixtures::MESSAGE_DELETE));
+        return deleteCount == seen + 1;
+    });
+
+    ok &= runCase(filter, "gateway/GUILD_CREATE (50 members)", 500, [&]() {
+        unsigned long seen = guildCount;
+        ws->injectText(guildSmall.c_str(), guildSmall.size());
+        return guildCount == seen + 1;
+    });
+
+    ok &= runCase(filter, "gateway/GUILD_CREATE (1000 members)", 50, [&]() {
+        unsigned long seen = guildCount;
+        ws->injectText(guildLarge.c_str(), guildLarge.size());
+        return guildCount == seen + 1;
+    });
+
+    // Rebuilds the guild's 200 channels and 60 roles in the state store
+    discord.setGuildState(64 * 1024, DISCORD_STATE_ALL_FIELDS);
+    ok &= runCase(filter, "gateway/GUILD_CREATE (1000, guild state)", 50, [&]() {
+        unsigned long seen = guildCount;
+        ws->injectText(guildLarge.c_str(), guildLarge.size());
+        DiscordStateStats state = discord.getGuildState().stats();
+        return guildCount == seen + 1 && state.channels == 200 && state.roles == 60 && state.dropped == 0;
+    });
+    DiscordStateStats state = discord.getGuildState().stats();
+    printf("%-40s %lu channels, %lu roles, %lu of %lu B\n", "(guild state)", (unsigned long)state.channels,
+           (unsigned long)state.roles, (unsigned long)state.bytes, (unsigned long)state.budget);
+
+    Snowflake memberRoles[] = {Snowflake(1007601240810930237ULL)};
+    ok &= runCase(filter, "state/permissions", 20000, [&]() {
+        // The role's permissions minus the @everyone overwrite's deny (2048)
+        uint64_t permissions = discord.getGuildState().permissions(Snowflake(1007597358579716106ULL + 199ULL * 4194304ULL),
+                                                                   Snowflake(403155427541680129ULL), memberRoles, 1);
+        return permissions == 1071698658881ULL;
+    });
+    discord.setGuildState(0);
+
+    discord.setEventFilteringEnabled(false);
+    ok &= runCase(filter, "gateway/GUILD_CREATE (1000, unfiltered)", 50, [&]() {
+        unsigned long seen = guildCount;
+        ws->injectText(guildLarge.c_str(), guildLarge.size());
+        return guildCount == seen + 1;
+    });
+    discord.setEventFilteringEnabled(true);
+
+    // The same recorded frames as the gateway sends them with encoding=etf
+    std::string etfMessage = fixtures::etfFromJson(fixtures::MESSAGE_CREATE);
+    std::string etfGuildSmall = fixtures::etfFromJson(guildSmall);
+    std::string etfGuildLarge = fixtures::etfFromJson(guildLarge);
+    printf("%-40s MESSAGE_CREATE %lu/%lu B, GUILD_CREATE %lu/%lu B\n", "(etf/json frame size)",
+           (unsigned long)etfMessage.size(), (unsigned long)strlen(fixtures::MESSAGE_CREATE),
+           (unsigned long)etfGuildLarge.size(), (unsigned long)guildLarge.size());
+
+    discord.setGatewayEncoding(GATEWAY_ENCODING_ETF);
+    ok &= runCase(filter, "gateway/MESSAGE_CREATE (etf)", 20000, [&]() {
+        unsigned long seen = messageCount;
+        ws->injectBinary((const uint8_t *)etfMessage.data(), etfMessage.size());
+        return messageCount == seen + 1;
+    });
+
+    ok &= runCase(filter, "gateway/GUILD_CREATE (50 members, etf)", 500, [&]() {
+        unsigned long seen = guildCount;
+        ws->injectBinary((const uint8_t *)etfGuildSmall.data(), etfGuildSmall.size());
+        return guildCount == seen + 1;
+    });
+
+    ok &= runCase(filter, "gateway/GUILD_CREATE (1000 members, etf)", 50, [&]() {
+        unsigned long seen = guildCount;
+        ws->injectBinary((const uint8_t *)etfGuildLarge.data(), etfGuildLarge.size());
+        return guildCount == seen + 1;
+    });
+    discord.setGatewayEncoding(GATEWAY_ENCODING_JSON);
+
+    // The same short session replayed as plain text frames and as a
+    // zlib-stream; each iteration starts a new connection (and stream)
+    std::vector<std::string> session;
+    session.push_back(fixtures::HELLO);
+    session.push_back(fixtures::READY);
+    session.push_back(fixtures::MESSAGE_CREATE);
+    session.push_back(fixtures::MESSAGE_DELETE);
+    session.push_back(guildSmall);
+    session.push_back(fixtures::MESSAGE_CREATE);
+    std::vector<std::string> compressed = fixtures::zlibStream(session);
+
+    ok &= runCase(filter, "gateway/session (json)", 500, [&]() {
+        unsigned long seen = guildCount;
+        ws->injectConnected();
+        for (size_t i = 0; i < session.size(); i++)
+        {
+            ws->injectText(session[i].c_str(), session[i].size());
+        }
+        ws->clearSentFrames();
+        return guildCount == seen + 1;
+    });
+
+    discord.setGatewayCompression(true);
+    ok &= runCase(filter, "gateway/session (zlib-stream)", 500, [&]() {
+        unsigned long seen = guildCount;
+        ws->injectConnected();
+        for (size_t i = 0; i < compressed.size(); i++)
+        {
+            ws->injectBinary((const uint8_t *)compressed[i].data(), compressed[i].size());
+        }
+        ws->clearSentFrames();
+        return guildCount == seen + 1;
+    });
+    if (discord.getGatewayBytesReceived() > 0)
+    {
+        printf("%-40s %.1fx (%llu B received, %llu B inflated)\n", "(zlib-stream ratio)",
+               (double)discord.getGatewayBytesInflated() / discord.getGatewayBytesReceived(),
+               (unsigned long long)discord.getGatewayBytesReceived(),
+               (unsigned long long)discord.getGatewayBytesInflated());
+    }
+    discord.setGatewayCompression(false);
+
+    discord.onGuildMember(onBenchGuildMember);
+    discord.setGuildCreateStreaming(true);
+    ok &= runCase(filter, "gateway/GUILD_CREATE (1000, streamed)", 50, [&]() {
+        unsigned long seen = guildCount;
+        unsigned long members = streamedMembers;
+        ws->injectText(guildLarge.c_str(), guildLarge.size());
+        return guildCount == seen + 1 && streamedMembers == members + 1000;
+    });
+    discord.setGuildCreateStreaming(false);
+
+    DiscordArenaStats arena = discord.getEventArenaStats();
+    printf("%-40s capacity %lu B, high water %lu B, %lu heap overflows\n", "(event arena)",
+           (unsigned long)arena.capacity, (unsigned long)arena.highWater, (unsigned long)arena.overflows);
+
+    ok &= runCase(filter, "rest/getUser", 5000, [&]() {
+        DiscordUser user = discord.getUser("697163431288258560");
+        return user.username == "field-tech";
+    });
+
+    // Every request finds its kept-alive connection closed by the server
+    ok &= runCase(filter, "rest/getUser (stale keep-alive)", 2000, [&]() {
+        HTTPClient::mockServerClose();
+        DiscordUser user = discord.getUser("697163431288258560");
+        return user.username == "field-tech";
+    });
+
+    ok &= runCase(filter, "rest/getGuild", 2000, [&]() {
+        DiscordGuild guild = discord.getGuild("1007597357912821780");
+        return guild.name == "Greenhouse Ops";
+    });
+
+    // Every call after the first is answered from the cache
+    discord.setUserCache();
+    ok &= runCase(filter, "rest/getUser (cached)", 20000, [&]() {
+        DiscordUser user = discord.getUser("697163431288258560");
+        return user.username == "field-tech";
+    });
+    DiscordCacheStats users = discord.getUserCacheStats();
+    printf("%-40s %lu hits, %lu misses, %lu evictions\n", "(user cache)",
+           (unsigned long)users.hits, (unsigned long)users.misses, (unsigned long)users.evictions);
+    discord.setUserCache(0);
+
+    ok &= runCase(filter, "rest/sendMessage", 5000, [&]() {
+        DiscordResponse response = discord.sendMessage("1007597358579716106", "ESP32 bench message");
+        return response.success;
+    });
+
+    // Round trip through the worker task, including handing the completion
+    // back to loop()
+    ok &= runCase(filter, "rest/sendMessageAsync", 5000, [&]() {
+        unsigned long before = asyncCompleted;
+        if (discord.sendMessageAsync("1007597358579716106", "ESP32 bench message", onBenchAsyncSent) == 0)
+        {
+            return false;
+        }
+        while (discord.getPendingRestRequests() > 0)
+        {
+            discord.loop();
+        }
+        return asyncCompleted == before + 1;
+    });
+
+    // A burst of eight lines to one channel, sent as a single POST once the
+    // coalescing window closes
+    discord.setMessageCoalescing(2);
+    ok &= runCase(filter, "rest/sendMessageAsync (8 coalesced)", 200, [&]() {
+        unsigned long before = asyncCompleted;
+        unsigned long requests = HTTPClient::mockRequestCount();
+        for (int i = 0; i < 8; i++)
+        {
+            if (discord.sendMessageAsync("1007597358579716106", "soil moisture 41%", onBenchAsyncSent) == 0)
+            {
+                return false;
+            }
+        }
+        while (discord.getPendingRestRequests() > 0)
+        {
+            discord.loop();
+        }
+        return asyncCompleted == before + 8 && HTTPClient::mockRequestCount() == requests + 1;
+    });
+    discord.setMessageCoalescing(0);
+
+    // A spam wave of 150 recent messages: two bulk-delete requests
+    Snowflake spam[150];
+    for (int i = 0; i < 150; i++)
+    {
+        spam[i] = Snowflake::fromTimestamp((uint64_t)time(nullptr) * 1000 - i * 1000);
+    }
+    ok &= runCase(filter, "rest/deleteMessages (150)", 1000, [&]() {
+        unsigned long requests = HTTPClient::mockRequestCount();
+        DiscordResponse response = discord.deleteMessages("1007597358579716106", spam, 150);
+        return response.success && HTTPClient::mockRequestCount() == requests + 2;
+    });
+
+    ok &= runCase(filter, "rest/getChannelMessages (100)", 200, [&]() {
+        DiscordMessage *messages = discord.getChannelMessages("1007597358579716106", 100);
+        bool parsed = messages != nullptr;
+        delete[] messages;
+        return parsed;
+    });
+
+    // Ten pages through one reused document, against getChannelMessages()
+    // holding a single page of 100 in a new[] array
+    Snowflake historyEnd(fixtures::messageId(1001));
+    ok &= runCase(filter, "rest/forEachChannelMessage (500)", 50, [&]() {
+        unsigned long visited = 0;
+        int count = discord.forEachChannelMessage(
+            "1007597358579716106",
+            [](const MessageView &message, void *context) {
+                (*(unsigned long *)context)++;
+                return message.id().isValid();
+            },
+            &visited, 500, historyEnd);
+        return count == 500 && visited == 500;
+    });
+
+    chunkedHistory = true;
+    ok &= runCase(filter, "rest/getChannelMessages (100, chunked)", 200, [&]() {
+        DiscordMessage *messages = discord.getChannelMessages("1007597358579716106", 100);
+        bool parsed = messages != nullptr && messages[99].id.isValid();
+        delete[] messages;
+        return parsed;
+    });
+    chunkedHistory = false;
+
+    DiscordRestStats rest = discord.getRestStats();
+    printf("%-40s %lu requests, %lu reused, %lu connects (%lu after a server close)\n", "(rest connections)",
+           (unsigned long)rest.requests, (unsigned long)rest.reused, (unsigned long)rest.connects,
+           (unsigned long)rest.retries);
+
+    // Both regions are the ordinary heap natively; this shows the split the
+    // threshold would make on a board with PSRAM
+    DiscordMemoryStats memory = discord.getMemoryStats();
+    printf("%-40s internal peak %lu B, psram peak %lu B (threshold %lu B)\n", "(memory regions)",
+           (unsigned long)memory.internal.peak, (unsigned long)memory.psram.peak, (unsigned long)memory.threshold);
+
+    DiscordDocumentPoolStats inbound = discord.getInboundDocumentStats();
+    DiscordDocumentPoolStats outbound = discord.getOutboundDocumentStats();
+    printf("%-40s inbound %u/%u slots, %lu misses, %lu B peak; outbound %u/%u slots, %lu misses, %lu B peak\n",
+           "(document pools)", inbound.highWater, inbound.slots, (unsigned long)inbound.misses,
+           (unsigned long)inbound.peakBytes, outbound.highWater, outbound.slots, (unsigned long)outbound.misses,
+           (unsigned long)outbound.peakBytes);
+
+    // Heartbeats come from their own task; nothing here calls loop()
+    static const char *FAST_HELLO = R"({"t":null,"s":null,"op":10,"d":{"heartbeat_interval":20}})";
+    ws->injectConnected();
+    ws->injectText(FAST_HELLO, strlen(FAST_HELLO));
+    ws->clearSentFrames();
+    delay(500);
+    std::vector<std::vector<uint8_t>> frames = ws->sentFrames();
+    ws->injectDisconnected();
+    int beats = 0;
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        std::string frame(frames[i].begin(), frames[i].end());
+        beats += frame.find("\"op\":1,") != std::string::npos;
+    }
+    printf("%-40s %d beats in 500 ms at a 20 ms interval\n", "(heartbeat task)", beats);
+    ok &= beats >= 10;
+
+    return ok ? 0 : 1;
+}
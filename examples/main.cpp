@@ -16,7 +16,7 @@ DiscordAPI discord;
 void onBotReady(DiscordUser user) {
     Serial.println("Bot đã sẵn sàng!");
     Serial.println("Tên bot: " + user.username);
-    Serial.println("ID bot: " + user.id);
+    Serial.println("ID bot: " + user.id.toString());
     
     // Gửi tin nhắn chào mừng
     DiscordResponse response = discord.sendMessage(channelId, "🤖 Bot ESP32 đã kết nối thành công!");
@@ -28,44 +28,46 @@ void onBotReady(DiscordUser user) {
 }
 
 // Hàm callback khi nhận tin nhắn mới
-void onMessageReceived(DiscordMessage message) {
-    Serial.println("Nhận tin nhắn từ: " + message.author.username);
-    Serial.println("Nội dung: " + message.content);
+void onMessageReceived(const MessageView &message) {
+    Serial.print("Nhận tin nhắn từ: ");
+    Serial.println(message.authorName());
+    Serial.print("Nội dung: ");
+    Serial.println(message.content());
     
     // Phản hồi tin nhắn
-    if (message.content.startsWith("!ping")) {
-        DiscordResponse response = discord.sendMessage(message.channel_id, "🏓 Pong! Bot đang hoạt động bình thường.");
+    if (message.contentStartsWith("!ping")) {
+        DiscordResponse response = discord.sendMessage(message.channelId(), "🏓 Pong! Bot đang hoạt động bình thường.");
         if (response.success) {
             Serial.println("Đã phản hồi lệnh ping!");
         }
     }
-    else if (message.content.startsWith("!time")) {
+    else if (message.contentStartsWith("!time")) {
         String currentTime = String(millis() / 1000) + " giây";
-        DiscordResponse response = discord.sendMessage(message.channel_id, "⏰ Thời gian hoạt động: " + currentTime);
+        DiscordResponse response = discord.sendMessage(message.channelId(), "⏰ Thời gian hoạt động: " + currentTime);
         if (response.success) {
             Serial.println("Đã gửi thời gian hoạt động!");
         }
     }
-    else if (message.content.startsWith("!help")) {
+    else if (message.contentStartsWith("!help")) {
         String helpText = "📋 **Các lệnh có sẵn:**\n";
         helpText += "`!ping` - Kiểm tra bot\n";
         helpText += "`!time` - Xem thời gian hoạt động\n";
         helpText += "`!help` - Hiển thị trợ giúp\n";
         helpText += "`!status` - Trạng thái hệ thống\n";
         
-        DiscordResponse response = discord.sendMessage(message.channel_id, helpText);
+        DiscordResponse response = discord.sendMessage(message.channelId(), helpText);
         if (response.success) {
             Serial.println("Đã gửi trợ giúp!");
         }
     }
-    else if (message.content.startsWith("!status")) {
+    else if (message.contentStartsWith("!status")) {
         String statusText = "📊 **Trạng thái hệ thống:**\n";
         statusText += "• WiFi: " + String(WiFi.isConnected() ? "✅ Kết nối" : "❌ Mất kết nối") + "\n";
         statusText += "• Discord: " + String(discord.isWebSocketConnected() ? "✅ Kết nối" : "❌ Mất kết nối") + "\n";
         statusText += "• RAM tự do: " + String(ESP.getFreeHeap()) + " bytes\n";
         statusText += "• Uptime: " + String(millis() / 1000) + " giây";
         
-        DiscordResponse response = discord.sendMessage(message.channel_id, statusText);
+        DiscordResponse response = discord.sendMessage(message.channelId(), statusText);
         if (response.success) {
             Serial.println("Đã gửi trạng thái hệ thống!");
         }
@@ -7,6 +7,24 @@
 #include <WiFiClientSecure.h>
 #include <ArduinoJson.h>
 #include <WebSocketsClient.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <atomic>
+
+#include "DiscordAllocator.h"
+#include "DiscordArena.h"
+#include "DiscordBodyStream.h"
+#include "DiscordCache.h"
+#include "DiscordDocumentPool.h"
+#include "DiscordEtf.h"
+#include "DiscordEvents.h"
+#include "DiscordInflate.h"
+#include "DiscordInlineVector.h"
+#include "DiscordJsonReader.h"
+#include "DiscordSnowflake.h"
+#include "DiscordState.h"
 
 // Discord API endpoints
 #define DISCORD_API_BASE "https://discord.com/api/v10"
@@ -14,7 +32,85 @@
 
 // Discord API limits
 #define DISCORD_RATE_LIMIT 50 // requests per second
+// Per-route rate limit buckets tracked at once; the least recently used
+// route is forgotten when the table is full
+#define DISCORD_RATE_LIMIT_BUCKETS 16
+// Longest a request waits for its bucket to refill (ms) before it fails
+// without being sent
+#define DISCORD_RATE_LIMIT_MAX_WAIT 5000
+// Requests answered with a 429 are retried after retry_after plus up to
+// DISCORD_RATE_LIMIT_JITTER ms, at most DISCORD_RATE_LIMIT_MAX_RETRIES
+// times and only while the total stays within the retry deadline (ms)
+#define DISCORD_RATE_LIMIT_RETRY_DEADLINE 15000
+#define DISCORD_RATE_LIMIT_MAX_RETRIES 3
+#define DISCORD_RATE_LIMIT_JITTER 250
 #define DISCORD_MAX_MESSAGE_LENGTH 2000
+// bulk-delete takes 2 to 100 messages, none older than two weeks; a minute
+// of margin covers clock skew and the time the request takes
+#define DISCORD_BULK_DELETE_MAX 100
+#define DISCORD_BULK_DELETE_MAX_AGE (14ULL * 24 * 60 * 60 * 1000 - 60000)
+// Messages fetched per request by forEachChannelMessage() (at most 100);
+// one page is all that is held in memory at a time
+#define DISCORD_HISTORY_PAGE_SIZE 50
+
+// Longest REST endpoint path DiscordPath can hold
+#define DISCORD_MAX_PATH_LENGTH 192
+
+// Gateway payload encodings (setGatewayEncoding)
+#define GATEWAY_ENCODING_JSON 0
+#define GATEWAY_ENCODING_ETF 1
+
+// Idle time after which the kept-alive REST connection is closed (ms). An
+// open TLS connection holds tens of KB of buffers, and the server drops idle
+// connections on its own schedule anyway.
+#define DISCORD_REST_IDLE_TIMEOUT 30000
+
+// Asynchronous REST worker (sendMessageAsync() etc.)
+#define DISCORD_REST_QUEUE_LENGTH 8
+#define DISCORD_REST_TASK_STACK 8192
+#define DISCORD_REST_TASK_PRIORITY 1
+#define DISCORD_REST_TASK_CORE tskNO_AFFINITY
+// Debug lines the worker hands to loop(); further lines are dropped and counted
+#define DISCORD_REST_LOG_QUEUE_LENGTH 16
+
+// Heartbeat task. It sits above loop() so beats go out on time while the
+// sketch is busy; it only sleeps and sends, so the stack can stay small.
+#define DISCORD_HEARTBEAT_TASK_STACK 4096
+#define DISCORD_HEARTBEAT_TASK_PRIORITY 2
+#define DISCORD_HEARTBEAT_TASK_CORE tskNO_AFFINITY
+// ACKs are read by loop(), so missing ones are only counted once loop() has
+// been polling the gateway without a longer gap for this long (ms)
+#define DISCORD_HEARTBEAT_ACK_GRACE 5000
+
+// Message coalescing (setMessageCoalescing): channels that can have a batch
+// open at once, and callers per batch kept without a heap allocation
+#define DISCORD_COALESCE_CHANNELS 4
+#define DISCORD_COALESCE_INLINE_WAITERS 4
+
+// Entity caches (setUserCache() etc.): default capacities and entry TTL.
+// Gateway events keep cached entries current, so the TTL only bounds how
+// stale an entry can get while events for it are missed.
+#define DISCORD_USER_CACHE_SIZE 32
+#define DISCORD_CHANNEL_CACHE_SIZE 32
+#define DISCORD_GUILD_CACHE_SIZE 4
+#define DISCORD_CACHE_TTL 300000
+
+// Guild state store (setGuildState): default memory budget and fields
+#define DISCORD_STATE_BUDGET 16384
+#define DISCORD_STATE_DEFAULT_FIELDS (DISCORD_STATE_NAMES | DISCORD_STATE_ROLES | DISCORD_STATE_OVERWRITES)
+
+// Pooled documents: inbound ones hold REST responses, outbound ones build
+// request bodies and gateway payloads. Slots start at the first size and
+// double up to the max when a document outgrows them.
+#define DISCORD_INBOUND_DOCUMENTS 2
+#define DISCORD_INBOUND_DOCUMENT_SIZE 4096
+#define DISCORD_INBOUND_DOCUMENT_MAX_SIZE 32768
+#define DISCORD_OUTBOUND_DOCUMENTS 2
+#define DISCORD_OUTBOUND_DOCUMENT_SIZE 1024
+#define DISCORD_OUTBOUND_DOCUMENT_MAX_SIZE 8192
+
+// Number of per-event deserialization filters that can be registered
+#define DISCORD_MAX_EVENT_FILTERS 8
 
 // WebSocket opcodes
 #define OPCODE_DISPATCH 0
@@ -154,12 +250,39 @@ struct DiscordResponse
     String body;
     bool success;
     String error;
+    unsigned long retryAfter; // ms, when statusCode is 429
+};
+
+// Rate limit state of one route, from the X-RateLimit-* response headers.
+// A route is the method and path with ids other than the major parameter
+// (channel, guild or webhook) replaced; routes answering with the same
+// X-RateLimit-Bucket for the same major parameter share one limit.
+struct DiscordRateLimitBucket
+{
+    uint32_t route;         // hash of the route and its major parameter; 0 = unused
+    uint32_t bucket;        // hash of the bucket id and the major parameter
+    int remaining;          // requests left before resetAt
+    unsigned long resetAt;  // millis() when the bucket refills
+    unsigned long lastUsed;
+};
+
+// REST transport counters (getRestStats)
+struct DiscordRestStats
+{
+    uint32_t requests;
+    uint32_t reused;   // sent on the already open connection
+    uint32_t connects; // needed a new TCP + TLS connection
+    uint32_t retries;  // resent after the server had closed the kept-alive connection
+    // Time spent in requests on a new vs. a reused connection; the
+    // difference in averages is what a handshake costs on this network
+    uint32_t connectMillis;
+    uint32_t reusedMillis;
 };
 
 // Discord User structure
 struct DiscordUser
 {
-    String id;
+    Snowflake id;
     String username;
     String discriminator;
     String global_name;
@@ -178,74 +301,123 @@ struct DiscordUser
     String avatar_decoration;
 };
 
-// Discord Message structure
+// Optional message fields kept as raw JSON in DiscordMessageExtras
+enum DiscordMessageField
+{
+    DISCORD_MESSAGE_MENTION_CHANNELS,
+    DISCORD_MESSAGE_ATTACHMENTS,
+    DISCORD_MESSAGE_EMBEDS,
+    DISCORD_MESSAGE_REACTIONS,
+    DISCORD_MESSAGE_ACTIVITY,
+    DISCORD_MESSAGE_APPLICATION,
+    DISCORD_MESSAGE_REFERENCE,
+    DISCORD_MESSAGE_REFERENCED_MESSAGE,
+    DISCORD_MESSAGE_INTERACTION,
+    DISCORD_MESSAGE_THREAD,
+    DISCORD_MESSAGE_COMPONENTS,
+    DISCORD_MESSAGE_STICKER_ITEMS,
+    DISCORD_MESSAGE_STICKERS,
+    DISCORD_MESSAGE_ROLE_SUBSCRIPTION_DATA,
+    DISCORD_MESSAGE_FIELD_COUNT
+};
+
+// Sparse storage for the optional message fields. Only fields that were
+// present and non-empty take space (one heap block for all of them); the
+// values are the field's JSON text, e.g. deserializeJson(doc, extras.get(
+// DISCORD_MESSAGE_EMBEDS)).
+//
+// Only getMessage() fills them by default. The default MESSAGE_CREATE
+// event filter and the history calls (getChannelMessages(),
+// forEachChannelMessage()) strip these fields to save memory, so they stay
+// empty unless the field is added to the event filter, e.g.
+// eventFilter(EVENT_MESSAGE_CREATE)["d"]["embeds"] = true.
+class DiscordMessageExtras
+{
+private:
+    struct Entry
+    {
+        uint8_t field;
+        String json;
+    };
+
+    Entry *_entries;
+    uint8_t _count;
+
+public:
+    DiscordMessageExtras() : _entries(nullptr), _count(0) {}
+    DiscordMessageExtras(const DiscordMessageExtras &other);
+    DiscordMessageExtras(DiscordMessageExtras &&other);
+    ~DiscordMessageExtras();
+    DiscordMessageExtras &operator=(const DiscordMessageExtras &other);
+    DiscordMessageExtras &operator=(DiscordMessageExtras &&other);
+
+    bool has(DiscordMessageField field) const;
+    // JSON text of `field`, or an empty String if it was not present
+    const String &get(DiscordMessageField field) const;
+    bool set(DiscordMessageField field, const String &json);
+    void clear();
+    size_t size() const { return _count; }
+
+    // Key of `field` in the Discord message object
+    static const char *key(DiscordMessageField field);
+};
+
+// Mentions past these counts spill to the heap
+#define DISCORD_MESSAGE_INLINE_MENTIONS 4
+#define DISCORD_MESSAGE_INLINE_MENTION_ROLES 2
+
+// sizeof(DiscordMessage) on the ESP32 (12-byte String). Checked at compile
+// time on 32-bit targets; the fixed part is ~320 bytes, most of it the
+// embedded DiscordUser.
+#define DISCORD_MESSAGE_SIZE_BUDGET 384
+
+// Discord Message structure. Fields read on every message come first; all
+// arrays are owned and released with the message.
 struct DiscordMessage
 {
-    String id;
-    String channel_id;
-    String guild_id;
+    Snowflake id;
+    Snowflake channel_id;
+    Snowflake guild_id;
     DiscordUser author;
     String content;
+    DiscordInlineVector<Snowflake, DISCORD_MESSAGE_INLINE_MENTIONS> mentions;
+    DiscordInlineVector<Snowflake, DISCORD_MESSAGE_INLINE_MENTION_ROLES> mention_roles;
     String timestamp;
     String edited_timestamp;
-    bool tts;
-    bool mention_everyone;
-    String *mentions;
-    int mentions_count;
-    String *mention_roles;
-    int mention_roles_count;
-    String *mention_channels;
-    int mention_channels_count;
-    String *attachments;
-    int attachments_count;
-    String *embeds;
-    int embeds_count;
-    String *reactions;
-    int reactions_count;
     String nonce;
-    bool pinned;
-    String webhook_id;
-    int type;
-    String *activity;
-    String *application;
-    String application_id;
-    String *message_reference;
-    int flags;
-    String *referenced_message;
-    String *interaction;
-    String *thread;
-    String *components;
-    int components_count;
-    String *sticker_items;
-    int sticker_items_count;
-    String *stickers;
-    int stickers_count;
-    int position;
-    String *role_subscription_data;
+    Snowflake webhook_id;
+    Snowflake application_id;
+    DiscordMessageExtras extras;
+    int32_t flags = 0;
+    int32_t position = 0;
+    uint8_t type = 0;
+    bool tts = false;
+    bool mention_everyone = false;
+    bool pinned = false;
 };
 
 // Discord Channel structure
 struct DiscordChannel
 {
-    String id;
+    Snowflake id;
     int type;
-    String guild_id;
+    Snowflake guild_id;
     int position;
     String *permission_overwrites;
     int permission_overwrites_count;
     String name;
     String topic;
     bool nsfw;
-    String last_message_id;
+    Snowflake last_message_id;
     int bitrate;
     int user_limit;
     int rate_limit_per_user;
     String *recipients;
     int recipients_count;
     String icon;
-    String owner_id;
-    String application_id;
-    String parent_id;
+    Snowflake owner_id;
+    Snowflake application_id;
+    Snowflake parent_id;
     String last_pin_timestamp;
     String rtc_region;
     int video_quality_mode;
@@ -270,20 +442,20 @@ struct DiscordChannel
 // Discord Guild structure
 struct DiscordGuild
 {
-    String id;
+    Snowflake id;
     String name;
     String icon;
     String icon_hash;
     String splash;
     String discovery_splash;
     bool owner;
-    String owner_id;
+    Snowflake owner_id;
     String permissions;
     String region;
-    String afk_channel_id;
+    Snowflake afk_channel_id;
     int afk_timeout;
     bool widget_enabled;
-    String widget_channel_id;
+    Snowflake widget_channel_id;
     int verification_level;
     int default_message_notifications;
     int explicit_content_filter;
@@ -294,10 +466,10 @@ struct DiscordGuild
     String *features;
     int features_count;
     int mfa_level;
-    String application_id;
-    String system_channel_id;
+    Snowflake application_id;
+    Snowflake system_channel_id;
     int system_channel_flags;
-    String rules_channel_id;
+    Snowflake rules_channel_id;
     int max_presences;
     int max_members;
     String vanity_url_code;
@@ -306,7 +478,7 @@ struct DiscordGuild
     int premium_tier;
     int premium_subscription_count;
     String preferred_locale;
-    String public_updates_channel_id;
+    Snowflake public_updates_channel_id;
     int max_video_channel_users;
     int max_stage_video_channel_users;
     String *approximate_member_count;
@@ -316,12 +488,161 @@ struct DiscordGuild
     String *stickers;
     int stickers_count;
     bool premium_progress_bar_enabled;
-    String safety_alerts_channel_id;
+    Snowflake safety_alerts_channel_id;
+};
+
+// Fixed-capacity builder for REST endpoint paths, so routes such as
+// "/channels/{id}/messages/{id}" are composed without heap allocations
+class DiscordPath
+{
+private:
+    char _buffer[DISCORD_MAX_PATH_LENGTH];
+    size_t _length;
+    bool _overflow;
+
+public:
+    DiscordPath() : _length(0), _overflow(false) { _buffer[0] = '\0'; }
+
+    DiscordPath &append(const char *part, size_t length);
+    DiscordPath &operator<<(const char *part) { return append(part, strlen(part)); }
+    DiscordPath &operator<<(const String &part) { return append(part.c_str(), part.length()); }
+    DiscordPath &operator<<(const Snowflake &id);
+    DiscordPath &operator<<(int value);
+
+    const char *c_str() const { return _buffer; }
+    size_t length() const { return _length; }
+    bool overflowed() const { return _overflow; }
+};
+
+// Completion of an asynchronous REST request, called from loop()
+typedef void (*DiscordRestCallback)(uint32_t requestId, const DiscordResponse &response, void *context);
+
+// Caller of a coalesced sendMessageAsync(), completed with the response
+// to the merged message
+struct DiscordRestWaiter
+{
+    uint32_t id;
+    DiscordRestCallback callback;
+    void *context;
+};
+
+typedef DiscordInlineVector<DiscordRestWaiter, DISCORD_COALESCE_INLINE_WAITERS> DiscordRestWaiters;
+
+// An asynchronous REST request. Owned by the worker queues from the
+// *Async() call until its completion has been delivered.
+struct DiscordRestJob
+{
+    uint32_t id;
+    const char *method;
+    DiscordPath path;
+    String body;
+    DiscordRestCallback callback;
+    void *context;
+    DiscordResponse response;
+    // 429 retries
+    uint8_t attempts;
+    unsigned long queuedAt;
+    unsigned long dueAt;
+    // Set for coalesced messages instead of callback/context
+    DiscordRestWaiters waiters;
+    // Worker's list of completions waiting for room in the done queue
+    DiscordRestJob *next;
+};
+
+// sendMessageAsync() calls to one channel collected during the coalescing
+// window, sent as one message
+struct DiscordMessageBatch
+{
+    Snowflake channelId; // invalid while the slot is free
+    String content;
+    unsigned long openedAt;
+    DiscordRestWaiters waiters;
+};
+
+// Deserialization filter applied to gateway dispatches of one event type
+struct DiscordEventFilter
+{
+    String eventType;
+    JsonDocument filter;
+};
+
+class DiscordAPI;
+
+// Read-only views over a gateway event while it is being dispatched. Fields
+// are decoded from the event's JsonDocument only when accessed, and strings
+// point into the document, so nothing is copied up front. A view and the
+// pointers it returns are only valid until the callback returns; call
+// materialize() to keep an owned copy.
+class MessageView
+{
+private:
+    JsonObject _obj;
+    DiscordAPI *_api;
+
+public:
+    MessageView(JsonObject obj, DiscordAPI *api) : _obj(obj), _api(api) {}
+
+    Snowflake id() const { return _obj["id"].as<Snowflake>(); }
+    Snowflake channelId() const { return _obj["channel_id"].as<Snowflake>(); }
+    Snowflake guildId() const { return _obj["guild_id"].as<Snowflake>(); }
+    const char *content() const { return _obj["content"] | ""; }
+    bool contentStartsWith(const char *prefix) const;
+    const char *timestamp() const { return _obj["timestamp"] | ""; }
+
+    Snowflake authorId() const { return _obj["author"]["id"].as<Snowflake>(); }
+    const char *authorName() const { return _obj["author"]["username"] | ""; }
+    bool authorIsBot() const { return _obj["author"]["bot"] | false; }
+
+    size_t mentionCount() const { return _obj["mentions"].size(); }
+    Snowflake mention(size_t index) const { return _obj["mentions"][index]["id"].as<Snowflake>(); }
+    bool mentions(Snowflake userId) const;
+    bool mentionEveryone() const { return _obj["mention_everyone"] | false; }
+
+    uint8_t type() const { return _obj["type"] | 0; }
+    int32_t flags() const { return _obj["flags"] | 0; }
+    bool tts() const { return _obj["tts"] | false; }
+    bool pinned() const { return _obj["pinned"] | false; }
+
+    // The underlying event object ("d"), for fields without an accessor
+    JsonObject json() const { return _obj; }
+
+    DiscordMessage materialize() const;
+    void materialize(DiscordMessage &message) const;
+};
+
+// Visitor for forEachChannelMessage(); return false to stop the walk
+typedef bool (*DiscordHistoryCallback)(const MessageView &message, void *context);
+
+class GuildView
+{
+private:
+    JsonObject _obj;
+    DiscordAPI *_api;
+
+public:
+    GuildView(JsonObject obj, DiscordAPI *api) : _obj(obj), _api(api) {}
+
+    Snowflake id() const { return _obj["id"].as<Snowflake>(); }
+    const char *name() const { return _obj["name"] | ""; }
+    const char *icon() const { return _obj["icon"] | ""; }
+    const char *description() const { return _obj["description"] | ""; }
+    Snowflake ownerId() const { return _obj["owner_id"].as<Snowflake>(); }
+    int memberCount() const { return _obj["member_count"] | 0; }
+    int premiumTier() const { return _obj["premium_tier"] | 0; }
+    const char *preferredLocale() const { return _obj["preferred_locale"] | ""; }
+
+    JsonObject json() const { return _obj; }
+
+    DiscordGuild materialize() const;
+    void materialize(DiscordGuild &guild) const;
 };
 
 // Discord API Client class
 class DiscordAPI
 {
+    friend class MessageView;
+    friend class GuildView;
+
 private:
     String _botToken;
     String _clientId;
@@ -329,20 +650,68 @@ private:
     String _redirectUri;
     WiFiClientSecure _wifiClient;
     HTTPClient _httpClient;
+    bool _restKeepAlive;
+    unsigned long _restIdleTimeout;
+    unsigned long _restLastUsed;
+    DiscordRestStats _restStats;
+
+    // Asynchronous REST worker. Requests are performed on a separate task
+    // and completions handed back to loop(); _restMutex serializes the
+    // shared HTTP client between that task and blocking calls.
+    SemaphoreHandle_t _restMutex;
+    QueueHandle_t _restQueue;
+    QueueHandle_t _restDone;
+    // The worker never calls onDebug; its lines wait here for loop()
+    QueueHandle_t _restLog;
+    std::atomic<int> _restLogDropped;
+    SemaphoreHandle_t _restWorkerExit;
+    TaskHandle_t _restTask;
+    uint32_t _restNextId;
+    int _restPending;
+    unsigned long _coalesceWindow;
+    DiscordMessageBatch _messageBatches[DISCORD_COALESCE_CHANNELS];
+
+    // Entity caches consulted by getUser() etc.; empty until enabled
+    DiscordCache<DiscordUser> _userCache;
+    DiscordCache<DiscordChannel> _channelCache;
+    DiscordCache<DiscordGuild> _guildCache;
+    DiscordState _state;
+
     WebSocketsClient _webSocket;
 
-    // Rate limiting
+    // Rate limiting. _requestCount counts the requests of the one-second
+    // window started at _lastRequestTime; _rateLimitReset is when a global
+    // 429 lifts (0 if none).
     unsigned long _lastRequestTime;
     int _requestCount;
+    int _globalRateLimit;
+    unsigned long _rateLimitRetryDeadline;
+    bool _blockingRateLimitRetry;
     unsigned long _rateLimitReset;
+    DiscordRateLimitBucket _rateLimitBuckets[DISCORD_RATE_LIMIT_BUCKETS];
 
-    // WebSocket state
-    bool _wsConnected;
+    // WebSocket state. The heartbeat task reads the connection state and
+    // sequence number and sends on the socket; _socketMutex serializes the
+    // client between it and loop(), which gives the lock up while a
+    // received frame is being handled.
+    std::atomic<bool> _wsConnected;
     bool _wsAuthenticated;
     bool _resumeInProgress;
-    int _heartbeatInterval;
-    unsigned long _lastHeartbeat;
-    int _sequenceNumber;
+    std::atomic<int> _heartbeatInterval;
+    std::atomic<unsigned long> _lastHeartbeat;
+    std::atomic<unsigned long> _nextHeartbeat;
+    std::atomic<int> _sequenceNumber;
+    SemaphoreHandle_t _socketMutex;
+    bool _socketPolling;
+    SemaphoreHandle_t _heartbeatWake;
+    SemaphoreHandle_t _heartbeatExit;
+    TaskHandle_t _heartbeatTask;
+    std::atomic<bool> _heartbeatStop;
+    // Heartbeats sent or failed since loop() last logged them; the task
+    // only counts, so onDebug is never called from it
+    std::atomic<int> _heartbeatsSent;
+    std::atomic<int> _heartbeatSendFailures;
+    std::atomic<int> _heartbeatSentSequence;
     String _sessionId;
     String _resumeGatewayUrl;
 
@@ -352,27 +721,106 @@ private:
     int _maxReconnectAttempts;
     unsigned long _reconnectDelay;
 
-    // Connection stability
-    unsigned long _lastHeartbeatAck;
+    // Connection stability. _heartbeatUnacked counts beats sent since the
+    // last ACK; _pollingSince is when loop() last resumed polling after a
+    // gap, so ACKs still queued on the socket are not taken as missed.
+    std::atomic<unsigned long> _lastHeartbeatAck;
+    std::atomic<int> _heartbeatUnacked;
+    unsigned long _lastPoll;
+    unsigned long _pollingSince;
     unsigned long _connectionStartTime;
     int _heartbeatMissedCount;
     int _maxHeartbeatMissed;
 
     uint32_t _gatewayIntents;
 
+    // zlib-stream transport compression
+    bool _gatewayCompression;
+    DiscordInflate _inflate;
+    int _gatewayEncoding;
+
+    // Per-event deserialization filters
+    DiscordEventFilter _eventFilters[DISCORD_MAX_EVENT_FILTERS];
+    int _eventFilterCount;
+    // Handed out by eventFilter() when every slot is taken; never consulted
+    JsonDocument _eventFilterScratch;
+    bool _eventFiltersEnabled;
+
+    // Streaming GUILD_CREATE processing
+    bool _guildStreaming;
+    void (*_onGuildChannel)(const DiscordChannel &channel);
+    void (*_onGuildRole)(Snowflake guildId, JsonObject role);
+    void (*_onGuildMember)(Snowflake guildId, JsonObject member);
+
+    // Per-dispatch memory: gateway documents are allocated from the arena,
+    // which is reset once the outermost dispatch returns, and the parsed
+    // structs are reused so their String buffers keep their capacity
+    DiscordArena _eventArena;
+    int _dispatchDepth;
+
+    // Documents for REST responses and for outgoing bodies and payloads,
+    // leased per call (see DiscordPooledDocument)
+    DiscordDocumentPool _inboundDocuments;
+    DiscordDocumentPool _outboundDocuments;
+    DiscordMessage _eventMessage;
+    DiscordGuild _eventGuild;
+    DiscordChannel _eventChannel;
+
     // Event callbacks
     void (*_onReady)(DiscordUser user);
     void (*_onMessage)(DiscordMessage message);
+    void (*_onMessageView)(const MessageView &message);
     void (*_onGuildCreate)(DiscordGuild guild);
+    void (*_onGuildCreateView)(const GuildView &guild);
     void (*_onError)(String error);
     void (*_onDebug)(String message, int level);
     void (*_onRaw)(String rawMessage);
+    void (*_onRawPayload)(const char* payload, size_t length);
+    void (*_eventHandlers[DISCORD_EVENT_COUNT])(DiscordEventType type, JsonObject data);
 
     // Internal methods
     String _getAuthHeader();
-    DiscordResponse _makeRequest(String method, String endpoint, String body = "");
+    // With `doc`, a successful response is parsed from the connection into
+    // it (through `filter`, if set) and response.body stays empty
+    DiscordResponse _makeRequest(const char *method, const char *endpoint, const String &body = "",
+                                 JsonDocument *doc = nullptr, JsonVariantConst filter = JsonVariantConst());
+    DiscordResponse _performRequest(const char *method, const char *endpoint, const String &body,
+                                    JsonDocument *doc = nullptr, JsonVariantConst filter = JsonVariantConst());
+    int _sendRestRequest(const char *method, const String &url, const String &body);
+    unsigned long _requestWait(const char *method, const char *endpoint);
+    bool _startRestWorker();
+    static void _restWorkerTask(void *param);
+    void _deliverRestCompletions();
+    void _queueRestLog(const String &message, int level);
+    void _logRestWorker();
+    DiscordRestJob *_newRestJob(const char *method, const char *endpoint, const String &body);
+    bool _queueRestJob(DiscordRestJob *job);
+    uint32_t _coalesceMessage(Snowflake channelId, const String &content, DiscordRestCallback callback, void *context);
+    void _flushMessageBatch(DiscordMessageBatch &batch);
+    void _flushMessageBatches(unsigned long now);
+    void _closeIdleRestConnection(unsigned long now);
+    DiscordRateLimitBucket *_rateLimitBucket(uint32_t route, unsigned long now, bool create);
+    unsigned long _rateLimitWait(uint32_t route, unsigned long now);
+    void _updateRateLimit(uint32_t route, uint32_t major, int statusCode, unsigned long now);
+    unsigned long _rateLimitRetry(const DiscordResponse &response, int attempts, unsigned long started);
+    bool _runRestJob(DiscordRestJob *job, DiscordRestJob **parked, int &parkedCount);
+    void _handleTextFrame(const char* payload, size_t length);
+    void _handleCompressedFrame(const uint8_t *payload, size_t length);
+    void _handleEtfFrame(const uint8_t *payload, size_t length);
+    bool _sendGatewayPayload(JsonDocument &doc, bool quiet = false);
+    String _gatewayQuery();
     void _handleWebSocketEvent(JsonDocument &doc);
+    void _dispatchMessageCreate(JsonObject messageObj);
+    void _dispatchGuildCreate(JsonObject guildObj);
+    void _dispatchEvent(DiscordEventType type, JsonObject data);
+    void _updateCaches(DiscordEventType type, JsonObject data);
+    void _handleResumed();
+    bool _startHeartbeatTask();
+    static void _heartbeatTaskLoop(void *param);
+    void _scheduleHeartbeat(unsigned long delayMs);
     void _sendHeartbeat();
+    void _logHeartbeats();
+    void _disconnectSocket();
     void _identify();
     void _resume();
     void _parseUser(JsonObject userObj, DiscordUser &user);
@@ -380,11 +828,17 @@ private:
     void _parseChannel(JsonObject channelObj, DiscordChannel &channel);
     void _parseGuild(JsonObject guildObj, DiscordGuild &guild);
     void _debugLog(String message, int level);
+    void _debugLog(const char *message, int level);
     bool _shouldReconnect();
     void _handleReconnect();
     bool _checkConnectionStability();
     void _handleConnectionTimeout();
     void _parseGatewayUrl(const String& url, String& hostOut, String& pathOut);
+    void _initEventFilters();
+    DiscordEventFilter *_findEventFilter(const char *eventType, size_t length);
+    void _streamGuildCreate(const char *payload, size_t length);
+    void _streamGuildObject(DiscordJsonReader &reader, const char *payload, size_t length);
+    int _streamGuildArray(DiscordJsonReader &reader, JsonDocument &element, Snowflake guildId, int kind);
 
 public:
     // Constructor
@@ -402,18 +856,88 @@ public:
 
     // REST API methods
     DiscordUser getCurrentUser();
-    DiscordUser getUser(String userId);
-    DiscordGuild getGuild(String guildId);
-    DiscordChannel getChannel(String channelId);
-    DiscordMessage getMessage(String channelId, String messageId);
-    DiscordMessage *getChannelMessages(String channelId, int limit = 50, String before = "", String after = "", String around = "");
-    DiscordResponse sendMessage(String channelId, String content, bool tts = false);
-    DiscordResponse editMessage(String channelId, String messageId, String content);
-    DiscordResponse deleteMessage(String channelId, String messageId);
-    DiscordResponse addReaction(String channelId, String messageId, String emoji);
-    DiscordResponse removeReaction(String channelId, String messageId, String emoji, String userId = "@me");
-    DiscordResponse removeAllReactions(String channelId, String messageId);
-    DiscordResponse removeAllReactionsForEmoji(String channelId, String messageId, String emoji);
+    DiscordUser getUser(Snowflake userId);
+    DiscordGuild getGuild(Snowflake guildId);
+    DiscordChannel getChannel(Snowflake channelId);
+    DiscordMessage getMessage(Snowflake channelId, Snowflake messageId);
+    DiscordMessage *getChannelMessages(Snowflake channelId, int limit = 50, Snowflake before = Snowflake(), Snowflake after = Snowflake(), Snowflake around = Snowflake());
+    // Walks a channel's history page by page, handing each message to
+    // `callback`: newest first going back from `before` (default: the
+    // latest message), or oldest first going forward from `after` when it
+    // is set. Stops after `maxMessages` (0 = no limit), at the end of the
+    // history, or when the callback returns false. Memory use is one page
+    // however many messages are visited. Returns the number of messages
+    // visited, or -1 if a request failed.
+    int forEachChannelMessage(Snowflake channelId, DiscordHistoryCallback callback, void *context = nullptr,
+                              int maxMessages = 0, Snowflake before = Snowflake(), Snowflake after = Snowflake());
+    DiscordResponse sendMessage(Snowflake channelId, String content, bool tts = false);
+    DiscordResponse editMessage(Snowflake channelId, Snowflake messageId, String content);
+    DiscordResponse deleteMessage(Snowflake channelId, Snowflake messageId);
+    // Deletes many messages of one channel with bulk-delete requests of up
+    // to DISCORD_BULK_DELETE_MAX messages. Messages too old for bulk-delete
+    // (from their snowflake timestamps) are deleted one by one. Age is
+    // measured against the system clock when it is set (NTP), otherwise
+    // against the newest message in the list; without a clock a bulk
+    // request Discord rejects (400, e.g. every message is too old) is
+    // retried as single deletes. Returns the first failed response, or the
+    // last one if all succeeded.
+    DiscordResponse deleteMessages(Snowflake channelId, const Snowflake *messageIds, size_t count);
+    DiscordResponse addReaction(Snowflake channelId, Snowflake messageId, String emoji);
+    // An invalid (zero) userId removes the bot's own reaction (@me)
+    DiscordResponse removeReaction(Snowflake channelId, Snowflake messageId, String emoji, Snowflake userId = Snowflake());
+    DiscordResponse removeAllReactions(Snowflake channelId, Snowflake messageId);
+    DiscordResponse removeAllReactionsForEmoji(Snowflake channelId, Snowflake messageId, String emoji);
+
+    // Any endpoint, with the response parsed straight from the connection
+    // into `doc` (optionally through an ArduinoJson filter) instead of being
+    // buffered in response.body. The typed getters above work this way.
+    DiscordResponse requestJson(const char *method, const char *endpoint, JsonDocument &doc,
+                                JsonVariantConst filter = JsonVariantConst(), const String &body = "");
+
+    // Non-blocking variants. The request is queued to a REST worker task
+    // and the call returns at once with a request id (0 if it could not be
+    // queued); `callback` runs from loop() when the request has completed,
+    // so gateway events and heartbeats keep flowing during the round trip.
+    uint32_t requestAsync(const char *method, const char *endpoint, const String &body = "",
+                          DiscordRestCallback callback = nullptr, void *context = nullptr);
+    uint32_t sendMessageAsync(Snowflake channelId, String content, DiscordRestCallback callback = nullptr, void *context = nullptr);
+    uint32_t editMessageAsync(Snowflake channelId, Snowflake messageId, String content,
+                              DiscordRestCallback callback = nullptr, void *context = nullptr);
+    uint32_t deleteMessageAsync(Snowflake channelId, Snowflake messageId, DiscordRestCallback callback = nullptr, void *context = nullptr);
+    uint32_t addReactionAsync(Snowflake channelId, Snowflake messageId, String emoji,
+                              DiscordRestCallback callback = nullptr, void *context = nullptr);
+    // Requests queued or in flight whose completion has not been delivered
+    int getPendingRestRequests() const;
+    // Opt-in: sendMessageAsync() calls to the same channel within
+    // `windowMs` of the first one are joined with newlines into one message
+    // (up to DISCORD_MAX_MESSAGE_LENGTH; a call that doesn't fit starts the
+    // next one). Every caller keeps its own request id and callback, which
+    // receives the response to the merged message. 0 turns it off.
+    void setMessageCoalescing(unsigned long windowMs);
+
+    // Opt-in caches for getUser(), getChannel() and getGuild(). A getter
+    // answers from the cache when it can and only asks the REST API on a
+    // miss; gateway events (READY, MESSAGE_CREATE authors, GUILD_CREATE,
+    // *_UPDATE, *_DELETE) keep the entries current. When full, the least
+    // recently used entry is evicted; entries older than `ttlMs` are
+    // fetched again (0 = no expiry). `psram` puts the entries in external
+    // RAM when the board has it. A capacity of 0 turns a cache off.
+    bool setUserCache(size_t capacity = DISCORD_USER_CACHE_SIZE, unsigned long ttlMs = DISCORD_CACHE_TTL, bool psram = false);
+    bool setChannelCache(size_t capacity = DISCORD_CHANNEL_CACHE_SIZE, unsigned long ttlMs = DISCORD_CACHE_TTL, bool psram = false);
+    bool setGuildCache(size_t capacity = DISCORD_GUILD_CACHE_SIZE, unsigned long ttlMs = DISCORD_CACHE_TTL, bool psram = false);
+    DiscordCacheStats getUserCacheStats() const;
+    DiscordCacheStats getChannelCacheStats() const;
+    DiscordCacheStats getGuildCacheStats() const;
+    void clearCaches();
+
+    // Opt-in store of the guilds, channels and roles seen on the gateway,
+    // for channel type and permission questions without REST calls (see
+    // DiscordState). `fields` is a mask of DISCORD_STATE_* bits; the store
+    // never holds more than `budgetBytes`. A budget of 0 turns it off.
+    // Resets the GUILD_CREATE event filter to the default, widened with the
+    // store's fields only while it is on; customise the filter afterwards.
+    void setGuildState(size_t budgetBytes = DISCORD_STATE_BUDGET, uint32_t fields = DISCORD_STATE_DEFAULT_FIELDS);
+    const DiscordState &getGuildState() const;
 
     // WebSocket methods
     bool connectWebSocket();
@@ -430,20 +954,95 @@ public:
     void removeGatewayIntent(uint32_t intent);
     uint32_t getGatewayIntents() const;
 
+    // Requests compress=zlib-stream on the next connection. Gateway traffic
+    // then arrives deflated (typically 5-10x smaller) and is inflated into a
+    // reusable buffer before parsing; costs a 32KB window while connected.
+    void setGatewayCompression(bool enabled);
+    bool getGatewayCompression() const;
+    // Bytes received on compressed connections, before and after inflating
+    uint64_t getGatewayBytesReceived() const;
+    uint64_t getGatewayBytesInflated() const;
+
+    // Payload encoding for the next connection: GATEWAY_ENCODING_JSON or
+    // GATEWAY_ENCODING_ETF. ETF frames are binary, smaller, and decode into
+    // the same JsonDocument the JSON path builds, with snowflakes as strings.
+    // GUILD_CREATE streaming only applies to JSON frames.
+    void setGatewayEncoding(int encoding);
+    int getGatewayEncoding() const;
+
+    // Gateway deserialization filters. Dispatches of an event type with a
+    // filter only materialize the fields marked true in it (under "d"); the
+    // library registers filters for READY, MESSAGE_CREATE and GUILD_CREATE
+    // covering what it parses. Add fields your handlers read, e.g.
+    //   discord.eventFilter(EVENT_MESSAGE_CREATE)["d"]["embeds"] = true;
+    // There are DISCORD_MAX_EVENT_FILTERS slots (the library uses 3). Once
+    // they are all taken, addEventFilter() returns false and eventFilter()
+    // returns a scratch document that is never applied; existing filters
+    // are left alone.
+    bool addEventFilter(const char *eventType);
+    JsonDocument &eventFilter(const char *eventType);
+    void removeEventFilter(const char *eventType);
+    void setEventFilteringEnabled(bool enabled);
+
+    // Streaming GUILD_CREATE. When enabled, GUILD_CREATE frames are walked in
+    // place instead of being deserialized as a whole: channels (and threads),
+    // roles and members are handed to the callbacks below one element at a
+    // time, arrays without a callback (presences, voice_states, ...) are
+    // skipped without being buffered, and onGuildCreate() receives the guild
+    // header once the frame has been walked.
+    void setGuildCreateStreaming(bool enabled);
+    void onGuildChannel(void (*callback)(const DiscordChannel &channel));
+    void onGuildRole(void (*callback)(Snowflake guildId, JsonObject role));
+    void onGuildMember(void (*callback)(Snowflake guildId, JsonObject member));
+
+    // Arena backing gateway event documents (DISCORD_EVENT_ARENA_SIZE by
+    // default). Events that outgrow it spill to the heap; check overflows
+    // and highWater in the stats to size it for your bot.
+    void setEventArenaSize(size_t bytes);
+    DiscordArenaStats getEventArenaStats() const;
+
+    // Document pools (DISCORD_INBOUND_DOCUMENTS / DISCORD_OUTBOUND_DOCUMENTS
+    // slots). highWater shows how many calls needed a document at once and
+    // misses how often a call found every slot busy; overflows and grows
+    // show slots being enlarged towards their max size.
+    DiscordDocumentPoolStats getInboundDocumentStats() const;
+    DiscordDocumentPoolStats getOutboundDocumentStats() const;
+
+    // PSRAM placement of the library's large allocations (documents that
+    // overflow the event arena, REST responses, the inflate window, caches
+    // and the guild state): blocks of at least `bytes` go to PSRAM when the
+    // board has it. The policy is shared by every DiscordAPI instance.
+    void setPsramThreshold(size_t bytes);
+    DiscordMemoryStats getMemoryStats() const;
+
     // Event handlers
     void onReady(void (*callback)(DiscordUser user));
     void onMessage(void (*callback)(DiscordMessage message));
     void onGuildCreate(void (*callback)(DiscordGuild guild));
+    // View-based handlers: nothing is copied unless the handler asks for it.
+    // Can be registered alongside the struct-based ones; both are called.
+    void onMessage(void (*callback)(const MessageView &message));
+    void onGuildCreate(void (*callback)(const GuildView &guild));
+    // Generic handler for any dispatch event, called with its "d" object
+    // after the library's own handling, e.g.
+    //   discord.on(DISCORD_EVENT_MESSAGE_DELETE, onDelete);
+    // Events missing from the table are delivered to DISCORD_EVENT_UNKNOWN.
+    // Pass nullptr to remove a handler.
+    void on(DiscordEventType type, void (*handler)(DiscordEventType type, JsonObject data));
     void onError(void (*callback)(String error));
+    // Always called on the task running loop() or the call that logs; the
+    // library's REST worker and heartbeat tasks leave their lines to loop().
     void onDebug(void (*callback)(String message, int level));
     void onRaw(void (*callback)(String rawMessage));
+    // Same as onRaw() but without copying: the buffer is only valid during the call
+    void onRawPayload(void (*callback)(const char* payload, size_t length));
 
     // Utility methods
     String getBotInviteURL(String permissions = "0");
-    String formatUserMention(String userId);
-    String formatChannelMention(String channelId);
-    String formatRoleMention(String roleId);
-    String formatEmoji(String name, String id, bool animated = false);
+    String formatUserMention(Snowflake userId);
+    String formatChannelMention(Snowflake channelId);
+    String formatRoleMention(Snowflake roleId);
+    String formatEmoji(String name, Snowflake id, bool animated = false);
     String formatTimestamp(String timestamp, String style = "f");
     String formatCodeBlock(String code, String language = "");
     String formatInlineCode(String code);
@@ -455,10 +1054,34 @@ public:
     String formatQuote(String text);
     String formatBlockQuote(String text);
 
-    // Rate limiting
+    // REST connection reuse. Requests share one HTTP/1.1 keep-alive
+    // connection to discord.com instead of a TCP + TLS handshake each; it is
+    // closed after `timeoutMs` without requests (0 keeps it open until the
+    // server closes it) and reopened transparently when the server has
+    // closed it.
+    void setRestKeepAlive(bool enabled);
+    void setRestIdleTimeout(unsigned long timeoutMs);
+    DiscordRestStats getRestStats() const;
+
+    // Rate limiting. Requests wait for their route's bucket to refill
+    // (up to DISCORD_RATE_LIMIT_MAX_WAIT) instead of being sent into a 429.
+    // isRateLimited() and getRemainingRequests() describe the global limit;
+    // getRateLimitReset() is the millis() at which a global 429 lifts.
     bool isRateLimited();
     int getRemainingRequests();
     unsigned long getRateLimitReset();
+    // Client-side global limit in requests per second (default
+    // DISCORD_RATE_LIMIT); 0 leaves it to the server
+    void setGlobalRateLimit(int requestsPerSecond);
+    // How long a request may spend being retried after 429s before its
+    // 429 is returned to the caller (default
+    // DISCORD_RATE_LIMIT_RETRY_DEADLINE); 0 disables retries
+    void setRateLimitRetryDeadline(unsigned long timeoutMs);
+    // Asynchronous requests are retried after a 429 on the worker task.
+    // Blocking calls return the 429 (with retryAfter) unless this is
+    // enabled, since their retries sleep on the caller's task, usually the
+    // one running loop().
+    void setRateLimitRetry(bool blockingCalls);
 
     // Error handling
     String getLastError();
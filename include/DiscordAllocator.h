@@ -0,0 +1,67 @@
+#ifndef DISCORD_ALLOCATOR_H
+#define DISCORD_ALLOCATOR_H
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Blocks of at least this many bytes go to PSRAM when the board has it;
+// smaller ones stay in internal RAM. The default puts ArduinoJson's memory
+// pools (1KB on the ESP32) and the buffers below in PSRAM, but not the
+// small strings of a document.
+#ifndef DISCORD_PSRAM_THRESHOLD
+#define DISCORD_PSRAM_THRESHOLD 1024
+#endif
+
+// Where discordMalloc() puts a block
+#define DISCORD_MEMORY_AUTO 0     // by size, against the threshold
+#define DISCORD_MEMORY_INTERNAL 1
+#define DISCORD_MEMORY_PSRAM 2    // falls back to internal RAM without PSRAM
+
+struct DiscordMemoryRegionStats
+{
+    size_t used;
+    size_t peak;
+    uint32_t allocations; // blocks currently allocated
+};
+
+struct DiscordMemoryStats
+{
+    DiscordMemoryRegionStats internal;
+    DiscordMemoryRegionStats psram;
+    // PSRAM requests served from internal RAM (no PSRAM, or it was full)
+    uint32_t psramFallbacks;
+    uint32_t failures;
+    size_t threshold;
+    bool psramAvailable;
+};
+
+// Library-wide allocation policy for large buffers: gateway documents that
+// spill out of the event arena, REST response documents, the inflate
+// window, and the caches and state store. Blocks carry a small header with
+// their size and region, so they must be released with discordFree() and
+// resized with discordRealloc(), which may move them between regions.
+//
+// On the native build there is no PSRAM; both regions are the ordinary
+// heap so the policy and its statistics still apply.
+void *discordMalloc(size_t size, uint8_t placement = DISCORD_MEMORY_AUTO);
+void *discordRealloc(void *ptr, size_t size, uint8_t placement = DISCORD_MEMORY_AUTO);
+void discordFree(void *ptr);
+
+void discordSetPsramThreshold(size_t threshold);
+size_t discordPsramThreshold();
+DiscordMemoryStats discordMemoryStats();
+
+// ArduinoJson allocator following the policy, for documents that can get
+// large: JsonDocument doc(DiscordAllocator::instance());
+class DiscordAllocator : public ArduinoJson::Allocator
+{
+public:
+    void *allocate(size_t size) override;
+    void deallocate(void *ptr) override;
+    void *reallocate(void *ptr, size_t newSize) override;
+
+    static DiscordAllocator *instance();
+};
+
+#endif // DISCORD_ALLOCATOR_H
@@ -0,0 +1,62 @@
+#ifndef DISCORD_ARENA_H
+#define DISCORD_ARENA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "DiscordAllocator.h"
+
+// Default size of the per-dispatch arena. A filtered MESSAGE_CREATE needs
+// about 1.5KB of document memory; READY and unfiltered events need more.
+#ifndef DISCORD_EVENT_ARENA_SIZE
+#define DISCORD_EVENT_ARENA_SIZE 8192
+#endif
+
+struct DiscordArenaStats
+{
+    size_t capacity;
+    size_t used;
+    size_t highWater;
+    // Allocations that did not fit and went to the heap instead
+    uint32_t overflows;
+};
+
+// Bump allocator for JsonDocuments that live for a single gateway dispatch.
+// Memory comes from one block allocated on first use; deallocate() only
+// gives space back when it is the most recent allocation, and reset()
+// releases everything at once. Requests that do not fit fall back to the
+// heap, so an undersized arena costs speed, never correctness.
+//
+// reset() must only be called once no document allocated from the arena
+// is alive.
+class DiscordArena : public ArduinoJson::Allocator
+{
+private:
+    uint8_t *_buffer;
+    size_t _capacity;
+    size_t _used;
+    size_t _last;
+    size_t _highWater;
+    uint32_t _overflows;
+    uint8_t _placement;
+
+    bool _owns(void *ptr) const;
+    size_t &_sizeOf(void *ptr) const;
+    void *_heapAllocate(size_t size);
+
+public:
+    // `placement` is where the block goes (DISCORD_MEMORY_*); overflows
+    // always follow the PSRAM policy
+    explicit DiscordArena(size_t capacity = DISCORD_EVENT_ARENA_SIZE, uint8_t placement = DISCORD_MEMORY_INTERNAL);
+    ~DiscordArena();
+
+    void *allocate(size_t size) override;
+    void deallocate(void *ptr) override;
+    void *reallocate(void *ptr, size_t newSize) override;
+
+    void reset();
+    // Frees the block; it is reallocated with the new size on next use
+    void resize(size_t capacity);
+    DiscordArenaStats stats() const;
+};
+
+#endif // DISCORD_ARENA_H
@@ -0,0 +1,45 @@
+#ifndef DISCORD_BODY_STREAM_H
+#define DISCORD_BODY_STREAM_H
+
+#include <Arduino.h>
+
+// HTTP response body read straight from the connection, for parsing with
+// deserializeJson() instead of buffering it with getString(). Reads stop
+// at the end of the body (Content-Length, or the last chunk of a chunked
+// response, whose framing is removed), so the parser never waits on a
+// kept-alive connection for bytes that belong to the next response.
+class DiscordBodyStream : public Stream
+{
+private:
+    Stream *_source;
+    bool _chunked;
+    bool _chunkStarted;
+    // Bytes left in the body or the current chunk; -1 reads until the
+    // server closes the connection
+    long _remaining;
+    bool _finished;
+    bool _error;
+
+    int _framingByte();
+    bool _nextChunk();
+    bool _ensure();
+
+public:
+    // `contentLength` as reported by HTTPClient::getSize(): -1 if unknown
+    DiscordBodyStream(Stream &source, int contentLength, bool chunked);
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char *buffer, size_t length) override;
+    size_t write(uint8_t) override { return 0; }
+
+    // Discards whatever the parser left unread. Returns false if the body
+    // did not end where its framing said it would, in which case the
+    // connection can't be reused.
+    bool drain();
+
+    bool failed() const { return _error; }
+};
+
+#endif // DISCORD_BODY_STREAM_H
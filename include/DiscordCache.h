@@ -0,0 +1,211 @@
+#ifndef DISCORD_CACHE_H
+#define DISCORD_CACHE_H
+
+#include <Arduino.h>
+#include <new>
+#include "DiscordAllocator.h"
+#include "DiscordSnowflake.h"
+
+struct DiscordCacheStats
+{
+    uint32_t hits;
+    uint32_t misses;
+    // Entries pushed out to make room for a new one
+    uint32_t evictions;
+    // Entries found older than the TTL
+    uint32_t expirations;
+    size_t size;
+    size_t capacity;
+};
+
+// Fixed-capacity cache of entities keyed by snowflake. The entry table is
+// one block allocated by begin(); when it is full, the least recently used
+// entry makes room. Entries older than the TTL are treated as misses and
+// dropped. Lookups scan the table, which for the few dozen entries an
+// ESP32 keeps is faster than hashing. A cache that was never begun holds
+// nothing and counts nothing.
+template <typename T>
+class DiscordCache
+{
+private:
+    struct Entry
+    {
+        Snowflake id;
+        unsigned long storedAt;
+        uint32_t lastUsed;
+        T value;
+    };
+
+    Entry *_entries;
+    size_t _capacity;
+    size_t _size;
+    unsigned long _ttl;
+    uint32_t _clock;
+    DiscordCacheStats _stats;
+
+    Entry *_find(Snowflake id)
+    {
+        for (size_t i = 0; i < _size; i++)
+        {
+            if (_entries[i].id == id)
+            {
+                return &_entries[i];
+            }
+        }
+        return nullptr;
+    }
+
+    bool _expired(const Entry &entry) const
+    {
+        return _ttl > 0 && millis() - entry.storedAt >= _ttl;
+    }
+
+    // Moves the last entry into the freed slot
+    void _erase(Entry *entry)
+    {
+        Entry *last = &_entries[_size - 1];
+        if (entry != last)
+        {
+            *entry = static_cast<Entry &&>(*last);
+        }
+        last->~Entry();
+        _size--;
+    }
+
+public:
+    DiscordCache() : _entries(nullptr), _capacity(0), _size(0), _ttl(0), _clock(0)
+    {
+        memset(&_stats, 0, sizeof(_stats));
+    }
+
+    ~DiscordCache()
+    {
+        end();
+    }
+
+    DiscordCache(const DiscordCache &) = delete;
+    DiscordCache &operator=(const DiscordCache &) = delete;
+
+    // Allocates room for `capacity` entries, dropping anything cached
+    // before. `ttlMs` of 0 keeps entries until they are evicted. With
+    // `psram` the table goes to external RAM when the board has it, which
+    // leaves internal RAM for the network stack at larger capacities;
+    // otherwise it is placed by size like other large buffers.
+    bool begin(size_t capacity, unsigned long ttlMs, bool psram = false)
+    {
+        end();
+        if (capacity == 0)
+        {
+            return true;
+        }
+        void *block = discordMalloc(capacity * sizeof(Entry), psram ? DISCORD_MEMORY_PSRAM : DISCORD_MEMORY_AUTO);
+        if (block == nullptr)
+        {
+            return false;
+        }
+        _entries = static_cast<Entry *>(block);
+        _capacity = capacity;
+        _ttl = ttlMs;
+        _stats.capacity = capacity;
+        return true;
+    }
+
+    void end()
+    {
+        clear();
+        discordFree(_entries);
+        _entries = nullptr;
+        _capacity = 0;
+        _stats.capacity = 0;
+    }
+
+    bool enabled() const { return _capacity > 0; }
+
+    // Copies the cached value into `out`; false on a miss
+    bool get(Snowflake id, T &out)
+    {
+        if (_capacity == 0)
+        {
+            return false;
+        }
+        Entry *entry = _find(id);
+        if (entry != nullptr && _expired(*entry))
+        {
+            _erase(entry);
+            _stats.expirations++;
+            entry = nullptr;
+        }
+        if (entry == nullptr)
+        {
+            _stats.misses++;
+            return false;
+        }
+        entry->lastUsed = ++_clock;
+        out = entry->value;
+        _stats.hits++;
+        return true;
+    }
+
+    // Stores or refreshes `id`. Invalid ids are ignored.
+    void put(Snowflake id, const T &value)
+    {
+        if (_capacity == 0 || !id.isValid())
+        {
+            return;
+        }
+        Entry *entry = _find(id);
+        if (entry == nullptr && _size < _capacity)
+        {
+            entry = new (&_entries[_size++]) Entry();
+        }
+        else if (entry == nullptr)
+        {
+            entry = &_entries[0];
+            for (size_t i = 1; i < _size; i++)
+            {
+                if ((int32_t)(_entries[i].lastUsed - entry->lastUsed) < 0)
+                {
+                    entry = &_entries[i];
+                }
+            }
+            _stats.evictions++;
+        }
+        entry->id = id;
+        entry->storedAt = millis();
+        entry->lastUsed = ++_clock;
+        entry->value = value;
+    }
+
+    void remove(Snowflake id)
+    {
+        Entry *entry = _capacity > 0 ? _find(id) : nullptr;
+        if (entry != nullptr)
+        {
+            _erase(entry);
+        }
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < _size; i++)
+        {
+            _entries[i].~Entry();
+        }
+        _size = 0;
+    }
+
+    DiscordCacheStats stats() const
+    {
+        DiscordCacheStats stats = _stats;
+        stats.size = _size;
+        return stats;
+    }
+
+    void resetStats()
+    {
+        memset(&_stats, 0, sizeof(_stats));
+        _stats.capacity = _capacity;
+    }
+};
+
+#endif // DISCORD_CACHE_H
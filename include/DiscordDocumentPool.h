@@ -0,0 +1,120 @@
+#ifndef DISCORD_DOCUMENT_POOL_H
+#define DISCORD_DOCUMENT_POOL_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <atomic>
+#include "DiscordAllocator.h"
+#include "DiscordArena.h"
+
+// Most documents a pool can hold
+#define DISCORD_DOCUMENT_POOL_MAX_SLOTS 4
+
+struct DiscordDocumentPoolStats
+{
+    uint8_t slots;
+    uint8_t inUse;
+    // Most slots leased at the same time
+    uint8_t highWater;
+    uint32_t acquisitions;
+    // Leases that found every slot busy and got a temporary document
+    uint32_t misses;
+    // Block size of all slots together; each block is allocated when its
+    // slot is first used and then kept
+    size_t capacity;
+    // Most of a slot's block a document has used
+    size_t peakBytes;
+    // Allocations that did not fit their slot and went to the heap
+    uint32_t overflows;
+    // Times a slot was enlarged after overflowing
+    uint32_t grows;
+};
+
+// Fixed set of long-lived documents for short-lived use. Each slot is an
+// arena that keeps its block between leases, so steady traffic reuses the
+// same memory instead of building and tearing down a document's pools on
+// every call. A slot that overflowed during a lease is doubled (up to
+// `maxSize`) when it is returned. Slots are claimed atomically, so leases
+// may be taken from any task.
+class DiscordDocumentPool
+{
+private:
+    DiscordArena *_arenas[DISCORD_DOCUMENT_POOL_MAX_SLOTS];
+    std::atomic<bool> _busy[DISCORD_DOCUMENT_POOL_MAX_SLOTS];
+    uint32_t _leaseOverflows[DISCORD_DOCUMENT_POOL_MAX_SLOTS];
+    uint8_t _count;
+    size_t _maxSize;
+    uint8_t _placement;
+
+    std::atomic<uint8_t> _inUse;
+    std::atomic<uint8_t> _highWater;
+    std::atomic<uint32_t> _acquisitions;
+    std::atomic<uint32_t> _misses;
+    std::atomic<uint32_t> _overflows;
+    std::atomic<uint32_t> _grows;
+    std::atomic<size_t> _peakBytes;
+
+public:
+    DiscordDocumentPool();
+    ~DiscordDocumentPool();
+
+    DiscordDocumentPool(const DiscordDocumentPool &) = delete;
+    DiscordDocumentPool &operator=(const DiscordDocumentPool &) = delete;
+
+    // `placement` is a DISCORD_MEMORY_* value for the slot blocks. Must not
+    // be called while documents are leased.
+    void begin(uint8_t slots, size_t slotSize, size_t maxSize, uint8_t placement);
+    void end();
+
+    // Slot index, or -1 if every slot is busy
+    int acquire();
+    void release(int slot);
+    // Makes a leased slot's whole block available again; the document on
+    // it must be empty
+    void recycle(int slot);
+    // Allocator for a document on `slot`; -1 gets the PSRAM-aware heap
+    ArduinoJson::Allocator *allocator(int slot);
+
+    DiscordDocumentPoolStats stats() const;
+};
+
+// A JsonDocument leased from a pool for the lifetime of this object:
+//   DiscordPooledDocument lease(pool);
+//   JsonDocument& doc = *lease;
+// The document is cleared and its slot returned on destruction; nothing
+// from it may be used afterwards.
+class DiscordPooledDocument
+{
+private:
+    DiscordDocumentPool &_pool;
+    int _slot;
+    JsonDocument _doc;
+
+public:
+    explicit DiscordPooledDocument(DiscordDocumentPool &pool)
+        : _pool(pool), _slot(pool.acquire()), _doc(pool.allocator(_slot)) {}
+
+    ~DiscordPooledDocument()
+    {
+        // Releases everything before the slot's arena is reset
+        _doc.clear();
+        _pool.release(_slot);
+    }
+
+    DiscordPooledDocument(const DiscordPooledDocument &) = delete;
+    DiscordPooledDocument &operator=(const DiscordPooledDocument &) = delete;
+
+    // Empties the document and gives its slot's memory back. A document
+    // that is filled repeatedly must be cleared this way between uses: an
+    // arena only reclaims memory all at once.
+    void clear()
+    {
+        _doc.clear();
+        _pool.recycle(_slot);
+    }
+
+    JsonDocument &operator*() { return _doc; }
+    JsonDocument *operator->() { return &_doc; }
+};
+
+#endif // DISCORD_DOCUMENT_POOL_H
@@ -0,0 +1,89 @@
+#ifndef DISCORD_ETF_H
+#define DISCORD_ETF_H
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// External Term Format (encoding=etf). Only the terms the gateway uses are
+// handled; see https://www.erlang.org/doc/apps/erts/erl_ext_dist.html
+#define ETF_FORMAT_VERSION 131
+
+#define ETF_NEW_FLOAT_EXT 70
+#define ETF_SMALL_INTEGER_EXT 97
+#define ETF_INTEGER_EXT 98
+#define ETF_FLOAT_EXT 99
+#define ETF_ATOM_EXT 100
+#define ETF_SMALL_TUPLE_EXT 104
+#define ETF_LARGE_TUPLE_EXT 105
+#define ETF_NIL_EXT 106
+#define ETF_STRING_EXT 107
+#define ETF_LIST_EXT 108
+#define ETF_BINARY_EXT 109
+#define ETF_SMALL_BIG_EXT 110
+#define ETF_LARGE_BIG_EXT 111
+#define ETF_SMALL_ATOM_EXT 115
+#define ETF_MAP_EXT 116
+#define ETF_ATOM_UTF8_EXT 118
+#define ETF_SMALL_ATOM_UTF8_EXT 119
+
+// Forward-only reader over an ETF buffer, the binary counterpart of
+// DiscordJsonReader. It never allocates: strings are views into the input.
+// Every read*() consumes exactly one term and fails if the next term has
+// another type.
+class DiscordEtfReader
+{
+private:
+    const uint8_t *_data;
+    size_t _length;
+    size_t _pos;
+    bool _error;
+
+    bool _need(size_t count);
+    uint32_t _readU16();
+    uint32_t _readU32();
+
+public:
+    DiscordEtfReader(const uint8_t *data, size_t length);
+
+    // Consumes the version byte that starts every message
+    bool begin();
+
+    // Tag of the next term, or 0 at end of input / on error
+    uint8_t peek() const;
+
+    bool readMap(uint32_t &pairs);
+    // Lists and tuples. A list is followed by its tail term, which is NIL
+    // for every list the gateway sends; NIL itself reads as an empty list.
+    bool readList(uint32_t &count, bool &hasTail);
+    // STRING_EXT: a list of small integers packed as bytes
+    bool readByteList(const uint8_t *&bytes, size_t &length);
+    bool readBinary(const char *&value, size_t &length);
+    bool readAtom(const char *&value, size_t &length);
+    // Integers up to 64 bits, including the small bigs used for snowflakes
+    bool readInteger(uint64_t &magnitude, bool &negative);
+    bool readFloat(double &value);
+
+    bool skipValue();
+
+    size_t position() const { return _pos; }
+    bool failed() const { return _error; }
+};
+
+// Decodes one gateway message into a JsonDocument, so ETF frames feed the
+// same dispatch and parse code as JSON. Atoms become strings except nil,
+// true and false; integers wider than 32 bits become decimal strings, as
+// snowflakes are in JSON. The filter follows ArduinoJson's
+// DeserializationOption::Filter rules.
+DeserializationError deserializeEtf(JsonDocument &doc, const uint8_t *data, size_t length);
+DeserializationError deserializeEtf(JsonDocument &doc, const uint8_t *data, size_t length, JsonVariantConst filter);
+
+// Finds a string or atom member of the top-level map without decoding it
+bool peekEtfString(const uint8_t *data, size_t length, const char *key, const char *&value, size_t &valueLength);
+
+// Encodes outgoing payloads with binary keys and strings, as the gateway
+// requires. Returns the encoded size; nothing past `capacity` is written.
+size_t serializeEtf(JsonVariantConst src, uint8_t *output, size_t capacity);
+size_t measureEtf(JsonVariantConst src);
+
+#endif // DISCORD_ETF_H
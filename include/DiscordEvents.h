@@ -0,0 +1,110 @@
+#ifndef DISCORD_EVENTS_H
+#define DISCORD_EVENTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Every gateway dispatch event (the "t" field of op 0 payloads)
+#define DISCORD_DISPATCH_EVENTS(X)            \
+    X(READY)                                  \
+    X(RESUMED)                                \
+    X(APPLICATION_COMMAND_PERMISSIONS_UPDATE) \
+    X(AUTO_MODERATION_RULE_CREATE)            \
+    X(AUTO_MODERATION_RULE_UPDATE)            \
+    X(AUTO_MODERATION_RULE_DELETE)            \
+    X(AUTO_MODERATION_ACTION_EXECUTION)       \
+    X(CHANNEL_CREATE)                         \
+    X(CHANNEL_UPDATE)                         \
+    X(CHANNEL_DELETE)                         \
+    X(CHANNEL_PINS_UPDATE)                    \
+    X(THREAD_CREATE)                          \
+    X(THREAD_UPDATE)                          \
+    X(THREAD_DELETE)                          \
+    X(THREAD_LIST_SYNC)                       \
+    X(THREAD_MEMBER_UPDATE)                   \
+    X(THREAD_MEMBERS_UPDATE)                  \
+    X(ENTITLEMENT_CREATE)                     \
+    X(ENTITLEMENT_UPDATE)                     \
+    X(ENTITLEMENT_DELETE)                     \
+    X(GUILD_CREATE)                           \
+    X(GUILD_UPDATE)                           \
+    X(GUILD_DELETE)                           \
+    X(GUILD_AUDIT_LOG_ENTRY_CREATE)           \
+    X(GUILD_BAN_ADD)                          \
+    X(GUILD_BAN_REMOVE)                       \
+    X(GUILD_EMOJIS_UPDATE)                    \
+    X(GUILD_STICKERS_UPDATE)                  \
+    X(GUILD_INTEGRATIONS_UPDATE)              \
+    X(GUILD_MEMBER_ADD)                       \
+    X(GUILD_MEMBER_REMOVE)                    \
+    X(GUILD_MEMBER_UPDATE)                    \
+    X(GUILD_MEMBERS_CHUNK)                    \
+    X(GUILD_ROLE_CREATE)                      \
+    X(GUILD_ROLE_UPDATE)                      \
+    X(GUILD_ROLE_DELETE)                      \
+    X(GUILD_SCHEDULED_EVENT_CREATE)           \
+    X(GUILD_SCHEDULED_EVENT_UPDATE)           \
+    X(GUILD_SCHEDULED_EVENT_DELETE)           \
+    X(GUILD_SCHEDULED_EVENT_USER_ADD)         \
+    X(GUILD_SCHEDULED_EVENT_USER_REMOVE)      \
+    X(GUILD_SOUNDBOARD_SOUND_CREATE)          \
+    X(GUILD_SOUNDBOARD_SOUND_UPDATE)          \
+    X(GUILD_SOUNDBOARD_SOUND_DELETE)          \
+    X(GUILD_SOUNDBOARD_SOUNDS_UPDATE)         \
+    X(SOUNDBOARD_SOUNDS)                      \
+    X(INTEGRATION_CREATE)                     \
+    X(INTEGRATION_UPDATE)                     \
+    X(INTEGRATION_DELETE)                     \
+    X(INTERACTION_CREATE)                     \
+    X(INVITE_CREATE)                          \
+    X(INVITE_DELETE)                          \
+    X(MESSAGE_CREATE)                         \
+    X(MESSAGE_UPDATE)                         \
+    X(MESSAGE_DELETE)                         \
+    X(MESSAGE_DELETE_BULK)                    \
+    X(MESSAGE_REACTION_ADD)                   \
+    X(MESSAGE_REACTION_REMOVE)                \
+    X(MESSAGE_REACTION_REMOVE_ALL)            \
+    X(MESSAGE_REACTION_REMOVE_EMOJI)          \
+    X(MESSAGE_POLL_VOTE_ADD)                  \
+    X(MESSAGE_POLL_VOTE_REMOVE)               \
+    X(PRESENCE_UPDATE)                        \
+    X(STAGE_INSTANCE_CREATE)                  \
+    X(STAGE_INSTANCE_UPDATE)                  \
+    X(STAGE_INSTANCE_DELETE)                  \
+    X(SUBSCRIPTION_CREATE)                    \
+    X(SUBSCRIPTION_UPDATE)                    \
+    X(SUBSCRIPTION_DELETE)                    \
+    X(TYPING_START)                           \
+    X(USER_UPDATE)                            \
+    X(VOICE_CHANNEL_EFFECT_SEND)              \
+    X(VOICE_STATE_UPDATE)                     \
+    X(VOICE_SERVER_UPDATE)                    \
+    X(WEBHOOKS_UPDATE)
+
+#define DISCORD_EVENT_ENUM_ENTRY(name) DISCORD_EVENT_##name,
+
+enum DiscordEventType
+{
+    DISCORD_EVENT_UNKNOWN,
+    DISCORD_DISPATCH_EVENTS(DISCORD_EVENT_ENUM_ENTRY)
+    DISCORD_EVENT_COUNT
+};
+
+// 32-bit FNV-1a. The constexpr form hashes the event names at compile time
+// for the lookup switch, where a collision between two names would be a
+// duplicate case label, so the table is checked to be perfect on every
+// build. Both forms must produce the same values.
+constexpr uint32_t discordEventNameHash(const char *name, uint32_t hash = 2166136261u)
+{
+    return *name == '\0' ? hash : discordEventNameHash(name + 1, (hash ^ (uint8_t)*name) * 16777619u);
+}
+
+uint32_t discordEventHash(const char *name, size_t length);
+
+// Maps the raw "t" bytes (not necessarily NUL-terminated) to an event type
+// without allocating; DISCORD_EVENT_UNKNOWN for anything not in the table
+DiscordEventType discordEventType(const char *name, size_t length);
+const char *discordEventName(DiscordEventType type);
+
+#endif // DISCORD_EVENTS_H
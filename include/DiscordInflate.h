@@ -0,0 +1,92 @@
+#ifndef DISCORD_INFLATE_H
+#define DISCORD_INFLATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// DEFLATE back-reference window; zlib-stream needs the full 32KB
+#define DISCORD_INFLATE_WINDOW_SIZE 32768
+
+// DiscordInflate::push() results
+#define DISCORD_INFLATE_OK 0
+#define DISCORD_INFLATE_PENDING 1
+#define DISCORD_INFLATE_ERROR -1
+
+// Decoder for the gateway's zlib-stream transport compression. The whole
+// connection is one zlib stream; each gateway message ends with a sync
+// flush (00 00 FF FF), so it can be decoded on its own as long as the 32KB
+// window of previous output is kept. Output goes to a buffer that is reused
+// between messages and only grows.
+class DiscordInflate
+{
+private:
+    struct Huffman
+    {
+        uint16_t count[16];
+        uint16_t symbol[288];
+    };
+
+    uint8_t *_window;
+    uint16_t _windowPos;
+    uint32_t _history;
+    bool _started;
+    bool _finished;
+
+    // Fragments of a message still waiting for its sync flush
+    uint8_t *_in;
+    size_t _inLength;
+    size_t _inCapacity;
+
+    char *_out;
+    size_t _outLength;
+    size_t _outCapacity;
+
+    const uint8_t *_src;
+    size_t _srcLength;
+    size_t _srcPos;
+    uint32_t _bits;
+    uint8_t _bitCount;
+    bool _error;
+    const char *_errorMessage;
+
+    Huffman _lencode;
+    Huffman _distcode;
+
+    uint64_t _totalIn;
+    uint64_t _totalOut;
+
+    uint32_t _getBits(uint8_t count);
+    int _decode(const Huffman &h);
+    bool _build(Huffman &h, const uint8_t *lengths, int count);
+    bool _reserveOut(size_t extra);
+    void _emit(uint8_t value);
+    bool _stored();
+    bool _fixed();
+    bool _dynamic();
+    bool _codes();
+    bool _fail(const char *message);
+    bool _inflate(const uint8_t *data, size_t length);
+
+public:
+    DiscordInflate();
+    ~DiscordInflate();
+
+    // Feeds one WebSocket message. Returns DISCORD_INFLATE_OK when a complete
+    // gateway message is available from data()/length(), PENDING when the
+    // message continues in the next frame, or ERROR if the stream is corrupt
+    // (it cannot be recovered; reconnect and reset()).
+    int push(const uint8_t *data, size_t length);
+
+    // Decompressed message, NUL-terminated; valid until the next push()
+    const char *data() const { return _out; }
+    size_t length() const { return _outLength; }
+    const char *error() const { return _errorMessage; }
+
+    // Starts a new stream (new connection); buffers are kept
+    void reset();
+
+    uint64_t compressedBytes() const { return _totalIn; }
+    uint64_t inflatedBytes() const { return _totalOut; }
+};
+
+#endif // DISCORD_INFLATE_H
@@ -0,0 +1,138 @@
+#ifndef DISCORD_INLINE_VECTOR_H
+#define DISCORD_INLINE_VECTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+
+// Owning array with room for `InlineCapacity` elements inside the object
+// itself. Only grows onto the heap once that is exceeded, and frees its
+// heap block in the destructor. Copies are deep. Elements must be default
+// constructible and copy assignable. Allocation failures leave the vector
+// unchanged and are reported through the bool return values.
+template <typename T, size_t InlineCapacity>
+class DiscordInlineVector
+{
+private:
+    T _inline[InlineCapacity];
+    T *_heap;
+    uint16_t _size;
+    uint16_t _capacity;
+
+    T *_data() { return _heap != nullptr ? _heap : _inline; }
+    const T *_data() const { return _heap != nullptr ? _heap : _inline; }
+
+public:
+    DiscordInlineVector() : _heap(nullptr), _size(0), _capacity(InlineCapacity) {}
+
+    DiscordInlineVector(const DiscordInlineVector &other) : _heap(nullptr), _size(0), _capacity(InlineCapacity)
+    {
+        *this = other;
+    }
+
+    DiscordInlineVector(DiscordInlineVector &&other) : _heap(nullptr), _size(0), _capacity(InlineCapacity)
+    {
+        *this = static_cast<DiscordInlineVector &&>(other);
+    }
+
+    ~DiscordInlineVector()
+    {
+        delete[] _heap;
+    }
+
+    DiscordInlineVector &operator=(const DiscordInlineVector &other)
+    {
+        if (this == &other)
+        {
+            return *this;
+        }
+        _size = 0;
+        if (!reserve(other._size))
+        {
+            return *this;
+        }
+        for (uint16_t i = 0; i < other._size; i++)
+        {
+            _data()[i] = other._data()[i];
+        }
+        _size = other._size;
+        return *this;
+    }
+
+    DiscordInlineVector &operator=(DiscordInlineVector &&other)
+    {
+        if (this == &other)
+        {
+            return *this;
+        }
+        if (other._heap != nullptr)
+        {
+            delete[] _heap;
+            _heap = other._heap;
+            _capacity = other._capacity;
+            other._heap = nullptr;
+            other._capacity = InlineCapacity;
+        }
+        else
+        {
+            _size = 0;
+            reserve(other._size);
+            for (uint16_t i = 0; i < other._size; i++)
+            {
+                _data()[i] = other._inline[i];
+            }
+        }
+        _size = other._size;
+        other._size = 0;
+        return *this;
+    }
+
+    bool reserve(size_t capacity)
+    {
+        if (capacity <= _capacity)
+        {
+            return true;
+        }
+        if (capacity > 0xFFFF)
+        {
+            return false;
+        }
+        T *heap = new (std::nothrow) T[capacity];
+        if (heap == nullptr)
+        {
+            return false;
+        }
+        for (uint16_t i = 0; i < _size; i++)
+        {
+            heap[i] = _data()[i];
+        }
+        delete[] _heap;
+        _heap = heap;
+        _capacity = (uint16_t)capacity;
+        return true;
+    }
+
+    bool push_back(const T &value)
+    {
+        if (_size == _capacity && !reserve((size_t)_capacity * 2))
+        {
+            return false;
+        }
+        _data()[_size++] = value;
+        return true;
+    }
+
+    // Keeps any heap block so a reused vector does not reallocate
+    void clear() { _size = 0; }
+
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    T &operator[](size_t index) { return _data()[index]; }
+    const T &operator[](size_t index) const { return _data()[index]; }
+    T *begin() { return _data(); }
+    T *end() { return _data() + _size; }
+    const T *begin() const { return _data(); }
+    const T *end() const { return _data() + _size; }
+};
+
+#endif // DISCORD_INLINE_VECTOR_H
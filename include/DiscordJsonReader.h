@@ -0,0 +1,48 @@
+#ifndef DISCORD_JSON_READER_H
+#define DISCORD_JSON_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Forward-only JSON walker over an in-memory buffer. It never allocates:
+// keys and values are returned as views into the input, and anything the
+// caller is not interested in is skipped by scanning. Used to process large
+// gateway payloads (GUILD_CREATE) one element at a time instead of building
+// a JsonDocument for the whole frame.
+class DiscordJsonReader
+{
+private:
+    const char *_json;
+    size_t _length;
+    size_t _pos;
+    bool _error;
+
+    void _skipWhitespace();
+    bool _skipString();
+    bool _skipContainer();
+    bool _skipLiteral();
+
+public:
+    DiscordJsonReader(const char *json, size_t length);
+
+    // Type of the next value: '{', '[', '"', 'n' (null), 't'/'f' (bool),
+    // '0' (number) or 0 at end of input / on error
+    char peek();
+
+    // Enter an object/array. Must be followed by nextMember()/nextElement()
+    // calls until they return false (which consumes the closing bracket).
+    bool enterObject();
+    bool enterArray();
+    bool nextMember(const char *&key, size_t &keyLength);
+    bool nextElement();
+
+    bool skipValue();
+    // Skips the next value and returns its raw bytes
+    bool rawValue(const char *&start, size_t &length);
+    bool readInt(long &value);
+
+    size_t position() const { return _pos; }
+    bool failed() const { return _error; }
+};
+
+#endif // DISCORD_JSON_READER_H
@@ -0,0 +1,86 @@
+#ifndef DISCORD_SNOWFLAKE_H
+#define DISCORD_SNOWFLAKE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Milliseconds between the Unix epoch and the Discord epoch (2015-01-01)
+#define DISCORD_EPOCH 1420070400000ULL
+
+// Buffer size needed by Snowflake::toChars() (20 digits + NUL)
+#define DISCORD_SNOWFLAKE_STRING_SIZE 21
+
+// Discord ID stored as its 64-bit value. Parsing and formatting never touch
+// the heap, and comparisons are integer compares. Converts implicitly from
+// the decimal string forms so existing String/const char* call sites keep
+// working; the zero value means "no ID".
+class Snowflake
+{
+private:
+    uint64_t _value;
+
+public:
+    Snowflake() : _value(0) {}
+    explicit Snowflake(uint64_t value) : _value(value) {}
+    Snowflake(const char *str) : _value(parse(str, str != nullptr ? strlen(str) : 0)._value) {}
+    Snowflake(const String &str) : _value(parse(str.c_str(), str.length())._value) {}
+
+    // Parses a decimal ID; returns the zero Snowflake on anything else
+    static Snowflake parse(const char *str, size_t length);
+    // Smallest Snowflake that could have been created at `unixMillis`
+    static Snowflake fromTimestamp(uint64_t unixMillis);
+
+    uint64_t value() const { return _value; }
+    bool isValid() const { return _value != 0; }
+
+    // Creation time in milliseconds since the Unix epoch
+    uint64_t timestamp() const { return (_value >> 22) + DISCORD_EPOCH; }
+
+    // Writes the decimal form plus NUL into `buffer`; returns the number of
+    // characters written (excluding NUL), or 0 if `size` is too small
+    size_t toChars(char *buffer, size_t size) const;
+    String toString() const;
+
+    bool operator==(const Snowflake &other) const { return _value == other._value; }
+    bool operator!=(const Snowflake &other) const { return _value != other._value; }
+    bool operator<(const Snowflake &other) const { return _value < other._value; }
+    bool operator>(const Snowflake &other) const { return _value > other._value; }
+};
+
+// Lets ArduinoJson read and write Snowflakes directly:
+//   Snowflake id = obj["id"].as<Snowflake>();
+//   doc["channel_id"] = id;
+namespace ArduinoJson
+{
+    template <>
+    struct Converter<Snowflake>
+    {
+        static void toJson(const Snowflake &src, JsonVariant dst)
+        {
+            char buffer[DISCORD_SNOWFLAKE_STRING_SIZE];
+            src.toChars(buffer, sizeof(buffer));
+            dst.set((const char *)buffer);
+        }
+
+        static Snowflake fromJson(JsonVariantConst src)
+        {
+            JsonString str = src.as<JsonString>();
+            if (!str.isNull())
+            {
+                return Snowflake::parse(str.c_str(), str.size());
+            }
+#if ARDUINOJSON_USE_LONG_LONG
+            return Snowflake(src.as<uint64_t>());
+#else
+            return Snowflake((uint64_t)src.as<unsigned long>());
+#endif
+        }
+
+        static bool checkJson(JsonVariantConst src)
+        {
+            return src.is<const char *>() || src.is<unsigned long>();
+        }
+    };
+}
+
+#endif // DISCORD_SNOWFLAKE_H
@@ -0,0 +1,171 @@
+#ifndef DISCORD_STATE_H
+#define DISCORD_STATE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "DiscordEvents.h"
+#include "DiscordSnowflake.h"
+
+// Fields DiscordState keeps (setGuildState). Ids, channel types, parents,
+// positions and guild owners are always kept; the rest only when asked for.
+#define DISCORD_STATE_NAMES 0x01      // guild, channel and role names
+#define DISCORD_STATE_TOPICS 0x02     // channel topics
+#define DISCORD_STATE_ROLES 0x04      // guild roles and their permissions
+#define DISCORD_STATE_OVERWRITES 0x08 // channel permission overwrites
+#define DISCORD_STATE_ALL_FIELDS 0x0F
+
+#define DISCORD_PERMISSION_ADMINISTRATOR 0x8ULL
+#define DISCORD_PERMISSION_ALL 0xFFFFFFFFFFFFFFFFULL
+
+// Permission overwrite targets
+#define DISCORD_OVERWRITE_ROLE 0
+#define DISCORD_OVERWRITE_MEMBER 1
+
+struct DiscordPermissionOverwrite
+{
+    Snowflake id;
+    uint64_t allow;
+    uint64_t deny;
+    uint8_t type;
+};
+
+// Strings are nullptr when the field is not kept or was not sent
+struct DiscordGuildState
+{
+    Snowflake id;
+    Snowflake ownerId;
+    char *name;
+};
+
+struct DiscordChannelState
+{
+    Snowflake id;
+    Snowflake guildId;
+    Snowflake parentId;
+    char *name;
+    char *topic;
+    DiscordPermissionOverwrite *overwrites;
+    uint16_t overwriteCount;
+    int16_t position;
+    uint8_t type;
+    bool nsfw;
+};
+
+struct DiscordRoleState
+{
+    Snowflake id;
+    Snowflake guildId;
+    uint64_t permissions;
+    char *name;
+    uint32_t color;
+    int16_t position;
+};
+
+struct DiscordStateStats
+{
+    size_t guilds;
+    size_t channels;
+    size_t roles;
+    // Memory held by the store, tables and strings included
+    size_t bytes;
+    size_t budget;
+    // Records and strings left out because the budget was used up
+    uint32_t dropped;
+};
+
+// Guilds, channels and roles as last seen on the gateway. GUILD_CREATE
+// builds a guild's entries; the CHANNEL_*, GUILD_UPDATE/DELETE and
+// GUILD_ROLE_* deltas then patch individual entries in place. Entries are
+// flat records in three tables, and everything the store allocates counts
+// against its budget: once that is used up, new entries are dropped
+// (and counted) rather than evicting what is there.
+//
+// Pointers handed out stay valid until the next gateway event is applied.
+class DiscordState
+{
+private:
+    DiscordGuildState *_guilds;
+    size_t _guildCount;
+    size_t _guildCapacity;
+    DiscordChannelState *_channels;
+    size_t _channelCount;
+    size_t _channelCapacity;
+    DiscordRoleState *_roles;
+    size_t _roleCount;
+    size_t _roleCapacity;
+
+    size_t _budget;
+    size_t _bytes;
+    uint32_t _fields;
+    uint32_t _dropped;
+
+    bool _charge(size_t bytes);
+    void _release(size_t bytes);
+    bool _grow(void *&table, size_t &capacity, size_t count, size_t elementSize);
+    void _setString(char *&field, JsonVariantConst value);
+    void _freeString(char *&field);
+    void _setOverwrites(DiscordChannelState &channel, JsonArrayConst overwrites);
+
+    DiscordGuildState *_findGuild(Snowflake id) const;
+    DiscordChannelState *_findChannel(Snowflake id) const;
+    DiscordRoleState *_findRole(Snowflake id) const;
+    void _eraseChannel(size_t index);
+    void _eraseRole(size_t index);
+
+public:
+    DiscordState();
+    ~DiscordState();
+
+    DiscordState(const DiscordState &) = delete;
+    DiscordState &operator=(const DiscordState &) = delete;
+
+    // Starts an empty store; a budget of 0 turns it off
+    void begin(size_t budgetBytes, uint32_t fields);
+    void end();
+    bool enabled() const { return _budget > 0; }
+    uint32_t fields() const { return _fields; }
+
+    // Applies a dispatch's "d" object. Events the store does not track
+    // are ignored.
+    void apply(DiscordEventType type, JsonObjectConst data);
+
+    // Creates or patches entries from (partial) objects: members that are
+    // missing leave the stored value alone. A guild's "channels" and
+    // "roles" arrays, when present, are applied too; roles missing from
+    // the array are removed.
+    void putGuild(JsonObjectConst guild);
+    void putChannel(JsonObjectConst channel, Snowflake guildId = Snowflake());
+    void putRole(Snowflake guildId, JsonObjectConst role);
+    // Removing a guild removes its channels and roles
+    void removeGuild(Snowflake guildId);
+    void removeChannel(Snowflake channelId);
+    void removeRole(Snowflake roleId);
+    void clear();
+
+    const DiscordGuildState *guild(Snowflake id) const { return _findGuild(id); }
+    const DiscordChannelState *channel(Snowflake id) const { return _findChannel(id); }
+    const DiscordRoleState *role(Snowflake id) const { return _findRole(id); }
+
+    // Tables in no particular order, for walking every entry
+    size_t guildCount() const { return _guildCount; }
+    const DiscordGuildState &guildAt(size_t index) const { return _guilds[index]; }
+    size_t channelCount() const { return _channelCount; }
+    const DiscordChannelState &channelAt(size_t index) const { return _channels[index]; }
+    size_t roleCount() const { return _roleCount; }
+    const DiscordRoleState &roleAt(size_t index) const { return _roles[index]; }
+
+    // Permissions of a member in a channel, computed the way Discord does:
+    // @everyone and the member's roles, administrator and ownership, then
+    // the channel's overwrites (a thread's are its parent's). The member's
+    // roles come from the caller, e.g. a message's member object. Returns
+    // 0 for an unknown channel. Needs DISCORD_STATE_ROLES, and
+    // DISCORD_STATE_OVERWRITES for the channel part.
+    uint64_t permissions(Snowflake channelId, Snowflake userId, const Snowflake *roleIds, size_t roleCount) const;
+
+    DiscordStateStats stats() const;
+
+    // Adds what the store reads to a GUILD_CREATE "d" filter
+    static void addFilter(JsonObject guildFilter, uint32_t fields);
+};
+
+#endif // DISCORD_STATE_H
@@ -0,0 +1,192 @@
+#include "Arduino.h"
+
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+HardwareSerial Serial;
+
+static std::chrono::steady_clock::time_point bootTime()
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return start;
+}
+
+unsigned long millis()
+{
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - bootTime()).count();
+}
+
+unsigned long micros()
+{
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime()).count();
+}
+
+void delay(unsigned long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield()
+{
+    std::this_thread::yield();
+}
+
+static std::mt19937 &rng()
+{
+    static std::mt19937 engine(0x5eed);
+    return engine;
+}
+
+long random(long howbig)
+{
+    if (howbig <= 0)
+        return 0;
+    return (long)(rng()() % (unsigned long)howbig);
+}
+
+long random(long howsmall, long howbig)
+{
+    if (howsmall >= howbig)
+        return howsmall;
+    return howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed)
+{
+    rng().seed((std::mt19937::result_type)seed);
+}
+
+// Integer formatting matching Arduino's itoa/ultoa based constructors
+static std::string formatUnsigned(unsigned long long value, unsigned char base)
+{
+    if (base < 2 || base > 36)
+        base = 10;
+    char buf[65];
+    char *p = buf + sizeof(buf) - 1;
+    *p = '\0';
+    do
+    {
+        unsigned digit = (unsigned)(value % base);
+        *--p = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        value /= base;
+    } while (value != 0);
+    return std::string(p);
+}
+
+static std::string formatSigned(long long value, unsigned char base)
+{
+    if (value < 0 && base == 10)
+        return "-" + formatUnsigned((unsigned long long)(-(value + 1)) + 1, base);
+    return formatUnsigned((unsigned long long)value, base);
+}
+
+static std::string formatFloat(double value, unsigned int decimalPlaces)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimalPlaces, value);
+    return std::string(buf);
+}
+
+String::String(unsigned char value, unsigned char base) : _buffer(formatUnsigned(value, base)) {}
+String::String(int value, unsigned char base) : _buffer(formatSigned(value, base)) {}
+String::String(unsigned int value, unsigned char base) : _buffer(formatUnsigned(value, base)) {}
+String::String(long value, unsigned char base) : _buffer(formatSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base) : _buffer(formatUnsigned(value, base)) {}
+String::String(long long value, unsigned char base) : _buffer(formatSigned(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : _buffer(formatUnsigned(value, base)) {}
+String::String(float value, unsigned int decimalPlaces) : _buffer(formatFloat(value, decimalPlaces)) {}
+String::String(double value, unsigned int decimalPlaces) : _buffer(formatFloat(value, decimalPlaces)) {}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const
+{
+    if (beginIndex > endIndex)
+        std::swap(beginIndex, endIndex);
+    if (beginIndex >= _buffer.size())
+        return String();
+    if (endIndex > _buffer.size())
+        endIndex = (unsigned int)_buffer.size();
+    return String(_buffer.c_str() + beginIndex, endIndex - beginIndex);
+}
+
+void String::replace(const String &find, const String &replace)
+{
+    if (find._buffer.empty())
+        return;
+    size_t pos = 0;
+    while ((pos = _buffer.find(find._buffer, pos)) != std::string::npos)
+    {
+        _buffer.replace(pos, find._buffer.size(), replace._buffer);
+        pos += replace._buffer.size();
+    }
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+    if (index >= _buffer.size())
+        return;
+    _buffer.erase(index, count);
+}
+
+void String::toLowerCase()
+{
+    for (size_t i = 0; i < _buffer.size(); i++)
+        _buffer[i] = (char)tolower((unsigned char)_buffer[i]);
+}
+
+void String::toUpperCase()
+{
+    for (size_t i = 0; i < _buffer.size(); i++)
+        _buffer[i] = (char)toupper((unsigned char)_buffer[i]);
+}
+
+void String::trim()
+{
+    size_t begin = 0;
+    size_t end = _buffer.size();
+    while (begin < end && isspace((unsigned char)_buffer[begin]))
+        begin++;
+    while (end > begin && isspace((unsigned char)_buffer[end - 1]))
+        end--;
+    _buffer = _buffer.substr(begin, end - begin);
+}
+
+String operator+(const String &lhs, const String &rhs)
+{
+    String result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+String operator+(const String &lhs, const char *rhs)
+{
+    String result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+String operator+(const char *lhs, const String &rhs)
+{
+    String result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+String operator+(const String &lhs, char rhs)
+{
+    String result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    return fwrite(buffer, 1, size, stdout);
+}
@@ -0,0 +1,240 @@
+#ifndef NATIVE_SHIMS_ARDUINO_H
+#define NATIVE_SHIMS_ARDUINO_H
+
+// Host-side stand-in for the Arduino core, used by the `native` PlatformIO
+// environment so DiscordAPI can be built and profiled without a board.
+// Only the subset of the API used by the library is provided.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+
+// ArduinoJson only enables its Arduino adapters when ARDUINO is defined,
+// which we deliberately don't do on the host. Turn them on explicitly.
+#ifndef ARDUINOJSON_ENABLE_ARDUINO_STRING
+#define ARDUINOJSON_ENABLE_ARDUINO_STRING 1
+#endif
+#ifndef ARDUINOJSON_ENABLE_ARDUINO_STREAM
+#define ARDUINOJSON_ENABLE_ARDUINO_STREAM 1
+#endif
+#ifndef ARDUINOJSON_ENABLE_ARDUINO_PRINT
+#define ARDUINOJSON_ENABLE_ARDUINO_PRINT 1
+#endif
+
+using std::min;
+using std::max;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+class String
+{
+public:
+    String() {}
+    String(const char *cstr) : _buffer(cstr ? cstr : "") {}
+    String(const char *cstr, unsigned int length) : _buffer(cstr ? cstr : "", cstr ? length : 0) {}
+    String(const String &other) : _buffer(other._buffer) {}
+    String(String &&other) : _buffer(std::move(other._buffer)) {}
+    explicit String(char c) : _buffer(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+
+    String &operator=(const String &rhs)
+    {
+        _buffer = rhs._buffer;
+        return *this;
+    }
+    String &operator=(String &&rhs)
+    {
+        _buffer = std::move(rhs._buffer);
+        return *this;
+    }
+    String &operator=(const char *cstr)
+    {
+        _buffer = cstr ? cstr : "";
+        return *this;
+    }
+
+    bool reserve(unsigned int size)
+    {
+        _buffer.reserve(size);
+        return true;
+    }
+    unsigned int length() const { return (unsigned int)_buffer.size(); }
+    bool isEmpty() const { return _buffer.empty(); }
+    const char *c_str() const { return _buffer.c_str(); }
+    char *begin() { return &_buffer[0]; }
+    char *end() { return &_buffer[0] + _buffer.size(); }
+
+    bool concat(const String &str)
+    {
+        _buffer += str._buffer;
+        return true;
+    }
+    bool concat(const char *cstr)
+    {
+        if (cstr)
+            _buffer += cstr;
+        return true;
+    }
+    bool concat(const char *cstr, unsigned int length)
+    {
+        if (cstr)
+            _buffer.append(cstr, length);
+        return true;
+    }
+    bool concat(char c)
+    {
+        _buffer += c;
+        return true;
+    }
+    bool concat(int value) { return concat(String(value)); }
+    bool concat(unsigned int value) { return concat(String(value)); }
+    bool concat(long value) { return concat(String(value)); }
+    bool concat(unsigned long value) { return concat(String(value)); }
+
+    String &operator+=(const String &rhs)
+    {
+        concat(rhs);
+        return *this;
+    }
+    String &operator+=(const char *cstr)
+    {
+        concat(cstr);
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        concat(c);
+        return *this;
+    }
+
+    bool equals(const String &s) const { return _buffer == s._buffer; }
+    bool equals(const char *cstr) const { return _buffer == (cstr ? cstr : ""); }
+    bool equalsIgnoreCase(const String &s) const
+    {
+        return _buffer.size() == s._buffer.size() && strncasecmp(_buffer.c_str(), s._buffer.c_str(), _buffer.size()) == 0;
+    }
+    bool operator==(const String &rhs) const { return equals(rhs); }
+    bool operator==(const char *cstr) const { return equals(cstr); }
+    bool operator!=(const String &rhs) const { return !equals(rhs); }
+    bool operator!=(const char *cstr) const { return !equals(cstr); }
+    bool operator<(const String &rhs) const { return _buffer < rhs._buffer; }
+
+    bool startsWith(const String &prefix) const { return _buffer.compare(0, prefix._buffer.size(), prefix._buffer) == 0; }
+    bool endsWith(const String &suffix) const
+    {
+        return _buffer.size() >= suffix._buffer.size() &&
+               _buffer.compare(_buffer.size() - suffix._buffer.size(), suffix._buffer.size(), suffix._buffer) == 0;
+    }
+
+    char charAt(unsigned int index) const { return index < _buffer.size() ? _buffer[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char &operator[](unsigned int index) { return _buffer[index]; }
+
+    int indexOf(char ch, unsigned int fromIndex = 0) const { return _find(_buffer.find(ch, fromIndex)); }
+    int indexOf(const String &str, unsigned int fromIndex = 0) const { return _find(_buffer.find(str._buffer, fromIndex)); }
+    int lastIndexOf(char ch) const { return _find(_buffer.rfind(ch)); }
+    int lastIndexOf(const String &str) const { return _find(_buffer.rfind(str._buffer)); }
+
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, length()); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void replace(const String &find, const String &replace);
+    void remove(unsigned int index) { remove(index, (unsigned int)-1); }
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const { return strtol(_buffer.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(_buffer.c_str(), nullptr); }
+    double toDouble() const { return strtod(_buffer.c_str(), nullptr); }
+
+private:
+    static int _find(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+
+    std::string _buffer;
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
+String operator+(const String &lhs, char rhs);
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (size--)
+        {
+            if (!write(*buffer++))
+                break;
+            n++;
+        }
+        return n;
+    }
+    size_t print(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+    size_t print(const String &str) { return write((const uint8_t *)str.c_str(), str.length()); }
+    size_t println(const char *str) { return print(str) + print("\n"); }
+    size_t println(const String &str) { return print(str) + print("\n"); }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual size_t readBytes(char *buffer, size_t length)
+    {
+        size_t n = 0;
+        while (n < length)
+        {
+            int c = read();
+            if (c < 0)
+                break;
+            buffer[n++] = (char)c;
+        }
+        return n;
+    }
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+
+protected:
+    unsigned long _timeout = 1000;
+};
+
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long) {}
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+};
+
+extern HardwareSerial Serial;
+
+#endif // NATIVE_SHIMS_ARDUINO_H
@@ -0,0 +1,192 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "Arduino.h"
+
+struct NativeTask
+{
+};
+
+static thread_local TaskHandle_t currentTask = nullptr;
+
+struct NativeTaskStart
+{
+    TaskFunction_t function;
+    void *parameter;
+    TaskHandle_t handle;
+};
+
+static void runTask(NativeTaskStart start)
+{
+    currentTask = start.handle;
+    start.function(start.parameter);
+}
+
+struct NativeQueue
+{
+    std::mutex lock;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::vector<uint8_t> storage;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t count;
+    UBaseType_t head;
+};
+
+static bool waitFor(std::condition_variable &condition, std::unique_lock<std::mutex> &guard, TickType_t ticks,
+                    const std::function<bool()> &ready)
+{
+    if (ticks == portMAX_DELAY)
+    {
+        condition.wait(guard, ready);
+        return true;
+    }
+    return condition.wait_for(guard, std::chrono::milliseconds(ticks), ready);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *, uint32_t, void *parameter, UBaseType_t,
+                                   TaskHandle_t *handle, BaseType_t)
+{
+    // Never freed: handles may be compared after the task has ended
+    NativeTask *task = new NativeTask();
+    if (handle != nullptr)
+    {
+        *handle = task;
+    }
+    NativeTaskStart start = {function, parameter, task};
+    std::thread(runTask, start).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stackDepth, void *parameter,
+                       UBaseType_t priority, TaskHandle_t *handle)
+{
+    return xTaskCreatePinnedToCore(function, name, stackDepth, parameter, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t)
+{
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    return currentTask;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return (TickType_t)millis();
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    NativeQueue *queue = new NativeQueue();
+    queue->storage.resize((size_t)length * itemSize);
+    queue->length = length;
+    queue->itemSize = itemSize;
+    queue->count = 0;
+    queue->head = 0;
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    delete queue;
+}
+
+static BaseType_t queueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait, bool front)
+{
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!waitFor(queue->notFull, guard, ticksToWait, [queue]() { return queue->count < queue->length; }))
+    {
+        return pdFALSE;
+    }
+    UBaseType_t slot;
+    if (front)
+    {
+        queue->head = (queue->head + queue->length - 1) % queue->length;
+        slot = queue->head;
+    }
+    else
+    {
+        slot = (queue->head + queue->count) % queue->length;
+    }
+    if (queue->itemSize > 0)
+    {
+        memcpy(&queue->storage[(size_t)slot * queue->itemSize], item, queue->itemSize);
+    }
+    queue->count++;
+    queue->notEmpty.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait)
+{
+    return queueSend(queue, item, ticksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticksToWait)
+{
+    return queueSend(queue, item, ticksToWait, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticksToWait)
+{
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!waitFor(queue->notEmpty, guard, ticksToWait, [queue]() { return queue->count > 0; }))
+    {
+        return pdFALSE;
+    }
+    if (queue->itemSize > 0)
+    {
+        memcpy(item, &queue->storage[(size_t)queue->head * queue->itemSize], queue->itemSize);
+    }
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    queue->notFull.notify_one();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return queue->count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    SemaphoreHandle_t mutex = xQueueCreate(1, 0);
+    xQueueSend(mutex, nullptr, 0);
+    return mutex;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return xQueueCreate(1, 0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait)
+{
+    return xQueueReceive(semaphore, nullptr, ticksToWait);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    return xQueueSend(semaphore, nullptr, 0);
+}
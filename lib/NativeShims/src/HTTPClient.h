@@ -0,0 +1,114 @@
+#ifndef NATIVE_SHIMS_HTTP_CLIENT_H
+#define NATIVE_SHIMS_HTTP_CLIENT_H
+
+#include <functional>
+#include <vector>
+
+#include "Arduino.h"
+#include "WiFiClientSecure.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM (-8)
+#define HTTPC_ERROR_ENCODING (-9)
+#define HTTPC_ERROR_STREAM_WRITE (-10)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+// What the host-side request handler hands back for a request.
+struct HTTPMockResponse
+{
+    int code = 200;
+    String body;
+    // false answers with "Connection: close"
+    bool keepAlive = true;
+    // Sends the body with Transfer-Encoding: chunked; getStream() then
+    // returns the chunk framing as the device client does
+    bool chunked = false;
+    std::vector<std::pair<String, String>> headers;
+};
+
+typedef std::function<HTTPMockResponse(const String &method, const String &url, const String &body)> HTTPMockHandler;
+
+// Stream over the body of the last response, returned by getStream()
+class HTTPMockBodyClient : public WiFiClient
+{
+public:
+    void reset(const String *body)
+    {
+        _body = body;
+        _pos = 0;
+    }
+    uint8_t connected() override { return _body != nullptr && _pos < _body->length(); }
+    int available() override { return _body ? (int)(_body->length() - _pos) : 0; }
+    int read() override { return available() > 0 ? (uint8_t)_body->c_str()[_pos++] : -1; }
+    int peek() override { return available() > 0 ? (uint8_t)_body->c_str()[_pos] : -1; }
+    size_t readBytes(char *buffer, size_t length) override
+    {
+        size_t n = min(length, (size_t)available());
+        if (n > 0)
+        {
+            memcpy(buffer, _body->c_str() + _pos, n);
+            _pos += n;
+        }
+        return n;
+    }
+
+private:
+    const String *_body = nullptr;
+    size_t _pos = 0;
+};
+
+class HTTPClient
+{
+public:
+    bool begin(WiFiClient &client, String url);
+    void end();
+    bool connected();
+
+    void setReuse(bool reuse) { _reuse = reuse; }
+    void setTimeout(uint16_t timeout) { _timeout = timeout; }
+    void addHeader(const String &name, const String &value, bool first = false, bool replace = true);
+    void collectHeaders(const char *headerKeys[], const size_t headerKeysCount);
+    String header(const char *name);
+    bool hasHeader(const char *name);
+
+    int GET();
+    int POST(String payload);
+    int PUT(String payload);
+    int PATCH(String payload);
+    int sendRequest(const char *type, String payload = "");
+
+    int getSize();
+    String getString();
+    WiFiClient &getStream();
+    WiFiClient *getStreamPtr();
+
+    // Host-only hooks: route every request through `handler` instead of the network
+    static void setMockHandler(HTTPMockHandler handler);
+    static unsigned long mockRequestCount();
+    // Connections opened so far (each one a TCP + TLS handshake on the device)
+    static unsigned long mockConnectionCount();
+    // Simulates the server closing idle keep-alive connections: the next
+    // request on an already open connection fails as on the device
+    static void mockServerClose();
+
+private:
+    bool _collected(const char *name);
+
+    WiFiClient *_client = nullptr;
+    String _url;
+    bool _reuse = true;
+    uint16_t _timeout = 5000;
+    std::vector<std::pair<String, String>> _requestHeaders;
+    std::vector<String> _collectKeys;
+    HTTPMockResponse _response;
+    String _chunkedBody;
+    HTTPMockBodyClient _bodyClient;
+};
+
+#endif // NATIVE_SHIMS_HTTP_CLIENT_H
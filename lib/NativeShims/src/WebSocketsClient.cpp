@@ -0,0 +1,137 @@
+#include "WebSocketsClient.h"
+
+static WebSocketsClient *activeClient = nullptr;
+
+WebSocketsClient *WebSocketsClient::active()
+{
+    return activeClient;
+}
+
+WebSocketsClient::~WebSocketsClient()
+{
+    if (activeClient == this)
+    {
+        activeClient = nullptr;
+    }
+}
+
+void WebSocketsClient::beginSSL(const char *host, uint16_t, const char *url, const char *, const char *)
+{
+    _host = host;
+    _url = url;
+    activeClient = this;
+}
+
+void WebSocketsClient::setAuthorization(const char *, const char *) {}
+
+void WebSocketsClient::setAuthorization(const char *) {}
+
+void WebSocketsClient::setReconnectInterval(unsigned long) {}
+
+void WebSocketsClient::onEvent(WebSocketClientEvent cbEvent)
+{
+    _cbEvent = cbEvent;
+}
+
+bool WebSocketsClient::sendTXT(uint8_t *payload, size_t length, bool)
+{
+    if (length == 0)
+    {
+        length = strlen((const char *)payload);
+    }
+    return _record(payload, length);
+}
+
+bool WebSocketsClient::sendTXT(const char *payload, size_t length)
+{
+    return sendTXT((uint8_t *)payload, length);
+}
+
+bool WebSocketsClient::sendTXT(String &payload)
+{
+    return sendTXT((uint8_t *)payload.c_str(), payload.length());
+}
+
+bool WebSocketsClient::sendBIN(uint8_t *payload, size_t length, bool)
+{
+    return _record(payload, length);
+}
+
+bool WebSocketsClient::sendBIN(const uint8_t *payload, size_t length)
+{
+    return sendBIN((uint8_t *)payload, length);
+}
+
+void WebSocketsClient::disconnect()
+{
+    if (_connected)
+    {
+        _connected = false;
+        _dispatch(WStype_DISCONNECTED, nullptr, 0);
+    }
+}
+
+void WebSocketsClient::loop() {}
+
+bool WebSocketsClient::isConnected()
+{
+    return _connected;
+}
+
+std::vector<std::vector<uint8_t>> WebSocketsClient::sentFrames() const
+{
+    std::lock_guard<std::mutex> lock(_sentMutex);
+    return _sent;
+}
+
+void WebSocketsClient::clearSentFrames()
+{
+    std::lock_guard<std::mutex> lock(_sentMutex);
+    _sent.clear();
+}
+
+bool WebSocketsClient::_record(const uint8_t *payload, size_t length)
+{
+    std::lock_guard<std::mutex> lock(_sentMutex);
+    _sent.push_back(std::vector<uint8_t>(payload, payload + length));
+    return _connected;
+}
+
+void WebSocketsClient::injectConnected()
+{
+    _connected = true;
+    _dispatch(WStype_CONNECTED, (const uint8_t *)_url.c_str(), _url.length());
+}
+
+void WebSocketsClient::injectDisconnected(uint16_t closeCode)
+{
+    _connected = false;
+    uint8_t code[2] = {(uint8_t)(closeCode >> 8), (uint8_t)(closeCode & 0xFF)};
+    _dispatch(WStype_DISCONNECTED, closeCode ? code : nullptr, closeCode ? sizeof(code) : 0);
+}
+
+void WebSocketsClient::injectText(const char *payload, size_t length)
+{
+    _dispatch(WStype_TEXT, (const uint8_t *)payload, length);
+}
+
+void WebSocketsClient::injectBinary(const uint8_t *payload, size_t length)
+{
+    _dispatch(WStype_BIN, payload, length);
+}
+
+// Like the real client, hand the callback a mutable, NUL-terminated copy
+void WebSocketsClient::_dispatch(WStype_t type, const uint8_t *payload, size_t length)
+{
+    if (!_cbEvent)
+    {
+        return;
+    }
+    if (_rxBuffer.capacity() < length + 1)
+    {
+        _rxBuffer.reserve(length + 1);
+    }
+    _rxBuffer.assign(payload, payload + length);
+    _rxBuffer.push_back(0);
+    _cbEvent(type, payload ? _rxBuffer.data() : nullptr, length);
+}
@@ -0,0 +1,81 @@
+#ifndef NATIVE_SHIMS_WEBSOCKETS_CLIENT_H
+#define NATIVE_SHIMS_WEBSOCKETS_CLIENT_H
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "Arduino.h"
+
+typedef enum
+{
+    WStype_ERROR,
+    WStype_DISCONNECTED,
+    WStype_CONNECTED,
+    WStype_TEXT,
+    WStype_BIN,
+    WStype_FRAGMENT_TEXT_START,
+    WStype_FRAGMENT_BIN_START,
+    WStype_FRAGMENT,
+    WStype_FRAGMENT_FIN,
+    WStype_PING,
+    WStype_PONG,
+} WStype_t;
+
+// Host stand-in for arduinoWebSockets' client. Nothing goes on the wire:
+// the host build pushes recorded gateway frames in with injectText() /
+// injectBinary() and inspects what the library sent via sentFrames().
+// Frames may be sent from the library's heartbeat task, so the record of
+// sent frames is locked.
+class WebSocketsClient
+{
+public:
+    typedef std::function<void(WStype_t type, uint8_t *payload, size_t length)> WebSocketClientEvent;
+
+    ~WebSocketsClient();
+
+    void beginSSL(const char *host, uint16_t port, const char *url = "/", const char *fingerprint = "", const char *protocol = "arduino");
+    void setAuthorization(const char *user, const char *password);
+    void setAuthorization(const char *auth);
+    void setReconnectInterval(unsigned long time);
+    void onEvent(WebSocketClientEvent cbEvent);
+
+    bool sendTXT(uint8_t *payload, size_t length = 0, bool headerToPayload = false);
+    bool sendTXT(const char *payload, size_t length = 0);
+    bool sendTXT(String &payload);
+    bool sendBIN(uint8_t *payload, size_t length, bool headerToPayload = false);
+    bool sendBIN(const uint8_t *payload, size_t length);
+
+    void disconnect();
+    void loop();
+    bool isConnected();
+
+    // Host-only hooks
+    void injectConnected();
+    void injectDisconnected(uint16_t closeCode = 0);
+    void injectText(const char *payload, size_t length);
+    void injectBinary(const uint8_t *payload, size_t length);
+    std::vector<std::vector<uint8_t>> sentFrames() const;
+    void clearSentFrames();
+    const String &host() const { return _host; }
+    const String &url() const { return _url; }
+
+    // The most recently started client, so a harness can reach the instance
+    // owned by DiscordAPI without widening the library's interface.
+    static WebSocketsClient *active();
+
+private:
+    void _dispatch(WStype_t type, const uint8_t *payload, size_t length);
+    bool _record(const uint8_t *payload, size_t length);
+
+    WebSocketClientEvent _cbEvent;
+    String _host;
+    String _url;
+    std::atomic<bool> _connected{false};
+    std::vector<uint8_t> _rxBuffer;
+    mutable std::mutex _sentMutex;
+    std::vector<std::vector<uint8_t>> _sent;
+};
+
+#endif // NATIVE_SHIMS_WEBSOCKETS_CLIENT_H
@@ -0,0 +1,31 @@
+#ifndef NATIVE_SHIMS_WIFI_H
+#define NATIVE_SHIMS_WIFI_H
+
+#include "Arduino.h"
+
+typedef enum
+{
+    WL_IDLE_STATUS = 0,
+    WL_CONNECTED = 3,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+class IPAddress
+{
+public:
+    String toString() const { return "127.0.0.1"; }
+};
+
+class WiFiClass
+{
+public:
+    wl_status_t begin(const char *, const char * = nullptr) { return WL_CONNECTED; }
+    wl_status_t status() { return WL_CONNECTED; }
+    bool isConnected() { return true; }
+    int8_t RSSI() { return -50; }
+    IPAddress localIP() { return IPAddress(); }
+};
+
+extern WiFiClass WiFi;
+
+#endif // NATIVE_SHIMS_WIFI_H
@@ -0,0 +1,44 @@
+#ifndef NATIVE_SHIMS_WIFI_CLIENT_SECURE_H
+#define NATIVE_SHIMS_WIFI_CLIENT_SECURE_H
+
+#include "Arduino.h"
+
+// Connection state only; the bytes themselves are produced by the HTTPClient
+// shim, which is where the host build injects recorded REST responses.
+class WiFiClient : public Stream
+{
+public:
+    virtual ~WiFiClient() {}
+    virtual int connect(const char *, uint16_t)
+    {
+        _connected = true;
+        return 1;
+    }
+    virtual uint8_t connected() { return _connected ? 1 : 0; }
+    virtual void stop() { _connected = false; }
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t *, size_t size) override { return size; }
+
+    explicit operator bool() { return connected(); }
+
+private:
+    bool _connected = false;
+};
+
+class WiFiClientSecure : public WiFiClient
+{
+public:
+    void setInsecure() { _insecure = true; }
+    void setCACert(const char *) {}
+    void setHandshakeTimeout(unsigned long) {}
+
+private:
+    bool _insecure = false;
+};
+
+#endif // NATIVE_SHIMS_WIFI_CLIENT_SECURE_H
@@ -0,0 +1,27 @@
+#ifndef NATIVE_SHIMS_FREERTOS_H
+#define NATIVE_SHIMS_FREERTOS_H
+
+// Host stand-in for the FreeRTOS kernel API used by the library: tasks run
+// on std::threads, queues and semaphores are built on a mutex/condition
+// variable pair. One tick is one millisecond.
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+#endif // NATIVE_SHIMS_FREERTOS_H
@@ -0,0 +1,16 @@
+#ifndef NATIVE_SHIMS_FREERTOS_SEMPHR_H
+#define NATIVE_SHIMS_FREERTOS_SEMPHR_H
+
+#include "queue.h"
+
+// As in FreeRTOS, semaphores are queues of zero-sized items. Mutexes have
+// no priority inheritance and are not recursive.
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+#define vSemaphoreDelete vQueueDelete
+
+#endif // NATIVE_SHIMS_FREERTOS_SEMPHR_H
@@ -0,0 +1,21 @@
+#ifndef NATIVE_SHIMS_FREERTOS_TASK_H
+#define NATIVE_SHIMS_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+typedef struct NativeTask *TaskHandle_t;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackDepth, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core);
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stackDepth, void *parameter,
+                       UBaseType_t priority, TaskHandle_t *handle);
+// Only self-deletion (nullptr) is supported; the task function must return
+// right after it, which ends the thread
+void vTaskDelete(TaskHandle_t task);
+// The main thread, which created no task, gets nullptr
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+
+#endif // NATIVE_SHIMS_FREERTOS_TASK_H
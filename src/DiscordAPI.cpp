@@ -1,5 +1,176 @@
 #include "DiscordAPI.h"
 
+#include <new>
+#include <string.h>
+#include <time.h>
+
+// REST path builder
+DiscordPath& DiscordPath::append(const char* part, size_t length) {
+    if (_length + length >= sizeof(_buffer)) {
+        _overflow = true;
+        length = sizeof(_buffer) - 1 - _length;
+    }
+    memcpy(_buffer + _length, part, length);
+    _length += length;
+    _buffer[_length] = '\0';
+    return *this;
+}
+
+DiscordPath& DiscordPath::operator<<(const Snowflake& id) {
+    char digits[DISCORD_SNOWFLAKE_STRING_SIZE];
+    size_t length = id.toChars(digits, sizeof(digits));
+    return append(digits, length);
+}
+
+DiscordPath& DiscordPath::operator<<(int value) {
+    char digits[12];
+    int length = snprintf(digits, sizeof(digits), "%d", value);
+    return append(digits, length > 0 ? (size_t)length : 0);
+}
+
+#if UINTPTR_MAX == 0xFFFFFFFF && !defined(DISCORD_NATIVE)
+static_assert(sizeof(DiscordMessage) <= DISCORD_MESSAGE_SIZE_BUDGET, "DiscordMessage exceeds DISCORD_MESSAGE_SIZE_BUDGET");
+#endif
+
+// Optional message fields
+static const char* const MESSAGE_FIELD_KEYS[DISCORD_MESSAGE_FIELD_COUNT] = {
+    "mention_channels", "attachments", "embeds", "reactions", "activity",
+    "application", "message_reference", "referenced_message", "interaction",
+    "thread", "components", "sticker_items", "stickers", "role_subscription_data"
+};
+
+const char* DiscordMessageExtras::key(DiscordMessageField field) {
+    return field < DISCORD_MESSAGE_FIELD_COUNT ? MESSAGE_FIELD_KEYS[field] : "";
+}
+
+DiscordMessageExtras::DiscordMessageExtras(const DiscordMessageExtras& other) : _entries(nullptr), _count(0) {
+    *this = other;
+}
+
+DiscordMessageExtras::DiscordMessageExtras(DiscordMessageExtras&& other) : _entries(other._entries), _count(other._count) {
+    other._entries = nullptr;
+    other._count = 0;
+}
+
+DiscordMessageExtras::~DiscordMessageExtras() {
+    delete[] _entries;
+}
+
+DiscordMessageExtras& DiscordMessageExtras::operator=(const DiscordMessageExtras& other) {
+    if (this == &other) {
+        return *this;
+    }
+    clear();
+    if (other._count == 0) {
+        return *this;
+    }
+    _entries = new (std::nothrow) Entry[other._count];
+    if (_entries == nullptr) {
+        return *this;
+    }
+    for (uint8_t i = 0; i < other._count; i++) {
+        _entries[i] = other._entries[i];
+    }
+    _count = other._count;
+    return *this;
+}
+
+DiscordMessageExtras& DiscordMessageExtras::operator=(DiscordMessageExtras&& other) {
+    if (this != &other) {
+        delete[] _entries;
+        _entries = other._entries;
+        _count = other._count;
+        other._entries = nullptr;
+        other._count = 0;
+    }
+    return *this;
+}
+
+bool DiscordMessageExtras::has(DiscordMessageField field) const {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_entries[i].field == field) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const String& DiscordMessageExtras::get(DiscordMessageField field) const {
+    static const String empty;
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_entries[i].field == field) {
+            return _entries[i].json;
+        }
+    }
+    return empty;
+}
+
+bool DiscordMessageExtras::set(DiscordMessageField field, const String& json) {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_entries[i].field == field) {
+            _entries[i].json = json;
+            return true;
+        }
+    }
+
+    // Grow by one; messages rarely carry more than two or three of these
+    Entry* entries = new (std::nothrow) Entry[_count + 1];
+    if (entries == nullptr) {
+        return false;
+    }
+    for (uint8_t i = 0; i < _count; i++) {
+        entries[i] = _entries[i];
+    }
+    entries[_count].field = (uint8_t)field;
+    entries[_count].json = json;
+    delete[] _entries;
+    _entries = entries;
+    _count++;
+    return true;
+}
+
+void DiscordMessageExtras::clear() {
+    delete[] _entries;
+    _entries = nullptr;
+    _count = 0;
+}
+
+// Event views
+bool MessageView::contentStartsWith(const char* prefix) const {
+    JsonString content = _obj["content"].as<JsonString>();
+    size_t length = strlen(prefix);
+    return content.size() >= length && memcmp(content.c_str(), prefix, length) == 0;
+}
+
+bool MessageView::mentions(Snowflake userId) const {
+    for (JsonVariant mention : _obj["mentions"].as<JsonArray>()) {
+        if (mention["id"].as<Snowflake>() == userId) {
+            return true;
+        }
+    }
+    return false;
+}
+
+DiscordMessage MessageView::materialize() const {
+    DiscordMessage message;
+    materialize(message);
+    return message;
+}
+
+void MessageView::materialize(DiscordMessage& message) const {
+    _api->_parseMessage(_obj, message);
+}
+
+DiscordGuild GuildView::materialize() const {
+    DiscordGuild guild;
+    materialize(guild);
+    return guild;
+}
+
+void GuildView::materialize(DiscordGuild& guild) const {
+    _api->_parseGuild(_obj, guild);
+}
+
 // Constructor
 DiscordAPI::DiscordAPI() {
     _botToken = "";
@@ -10,49 +181,163 @@ DiscordAPI::DiscordAPI() {
     _wsAuthenticated = false;
     _heartbeatInterval = 0;
     _lastHeartbeat = 0;
+    _nextHeartbeat = 0;
     _sequenceNumber = -1;
+    _socketMutex = xSemaphoreCreateMutex();
+    _socketPolling = false;
+    _heartbeatWake = nullptr;
+    _heartbeatExit = nullptr;
+    _heartbeatTask = nullptr;
+    _heartbeatStop = false;
+    _heartbeatsSent = 0;
+    _heartbeatSendFailures = 0;
+    _heartbeatSentSequence = -1;
     _sessionId = "";
     _resumeGatewayUrl = "";
     _lastRequestTime = 0;
     _requestCount = 0;
+    _globalRateLimit = DISCORD_RATE_LIMIT;
+    _rateLimitRetryDeadline = DISCORD_RATE_LIMIT_RETRY_DEADLINE;
+    _blockingRateLimitRetry = false;
     _rateLimitReset = 0;
+    memset(_rateLimitBuckets, 0, sizeof(_rateLimitBuckets));
     _onReady = nullptr;
     _onMessage = nullptr;
+    _onMessageView = nullptr;
     _onGuildCreate = nullptr;
+    _onGuildCreateView = nullptr;
     _onError = nullptr;
     _onDebug = nullptr;
     _onRaw = nullptr;
+    _onRawPayload = nullptr;
+    for (int i = 0; i < DISCORD_EVENT_COUNT; i++) {
+        _eventHandlers[i] = nullptr;
+    }
     _lastReconnectAttempt = 0;
     _reconnectAttempts = 0;
     _maxReconnectAttempts = 5;
     _reconnectDelay = 5000; // Start with 5 seconds
     _lastHeartbeatAck = 0;
+    _heartbeatUnacked = 0;
+    _lastPoll = 0;
+    _pollingSince = 0;
     _connectionStartTime = 0;
     _heartbeatMissedCount = 0;
     _maxHeartbeatMissed = 3;
     _gatewayIntents = DISCORD_INTENT_DEFAULT;
+    _gatewayCompression = false;
+    _gatewayEncoding = GATEWAY_ENCODING_JSON;
+    _eventFilterCount = 0;
+    _eventFiltersEnabled = true;
+    _initEventFilters();
+    _guildStreaming = false;
+    _onGuildChannel = nullptr;
+    _onGuildRole = nullptr;
+    _onGuildMember = nullptr;
+    _dispatchDepth = 0;
+    // Responses can be large and go by size; bodies and payloads are small
+    // and built often
+    _inboundDocuments.begin(DISCORD_INBOUND_DOCUMENTS, DISCORD_INBOUND_DOCUMENT_SIZE,
+                            DISCORD_INBOUND_DOCUMENT_MAX_SIZE, DISCORD_MEMORY_AUTO);
+    _outboundDocuments.begin(DISCORD_OUTBOUND_DOCUMENTS, DISCORD_OUTBOUND_DOCUMENT_SIZE,
+                             DISCORD_OUTBOUND_DOCUMENT_MAX_SIZE, DISCORD_MEMORY_INTERNAL);
     
     // Configure SSL for HTTPS requests
     _wifiClient.setInsecure(); // Skip certificate verification for now
+    _restKeepAlive = true;
+    _restIdleTimeout = DISCORD_REST_IDLE_TIMEOUT;
+    _restLastUsed = 0;
+    memset(&_restStats, 0, sizeof(_restStats));
+    _httpClient.setReuse(true);
+    _restMutex = xSemaphoreCreateMutex();
+    _restQueue = nullptr;
+    _restDone = nullptr;
+    _restLog = nullptr;
+    _restLogDropped = 0;
+    _restWorkerExit = nullptr;
+    _restTask = nullptr;
+    _restNextId = 1;
+    _restPending = 0;
+    _coalesceWindow = 0;
     
     // Test debug log in constructor
     _debugLog("DiscordAPI constructor called", DEBUG_LEVEL_INFO);
 }
 
+static void deleteQueuedJobs(QueueHandle_t queue) {
+    DiscordRestJob* job = nullptr;
+    while (xQueueReceive(queue, &job, 0) == pdTRUE) {
+        delete job;
+    }
+}
+
+// A debug line from the REST worker, waiting in _restLog for loop()
+struct DiscordRestLogLine {
+    String message;
+    int level;
+};
+
+static void deleteQueuedLogLines(QueueHandle_t queue) {
+    DiscordRestLogLine* line = nullptr;
+    while (xQueueReceive(queue, &line, 0) == pdTRUE) {
+        delete line;
+    }
+}
+
 // Destructor
 DiscordAPI::~DiscordAPI() {
+    // The heartbeat task goes first; it uses the socket
+    if (_heartbeatTask != nullptr) {
+        _heartbeatStop = true;
+        xSemaphoreGive(_heartbeatWake);
+        xSemaphoreTake(_heartbeatExit, portMAX_DELAY);
+        vSemaphoreDelete(_heartbeatWake);
+        vSemaphoreDelete(_heartbeatExit);
+    }
+
     // Cleanup WebSocket connection
     if (_wsConnected) {
         _webSocket.disconnect();
     }
+
+    // Stop the REST worker after its current request; undelivered
+    // completions are dropped, and drained while waiting so the worker
+    // never waits on a full done queue
+    if (_restTask != nullptr) {
+        DiscordRestJob* stop = nullptr;
+        while (xQueueSendToFront(_restQueue, &stop, pdMS_TO_TICKS(10)) != pdTRUE) {
+            deleteQueuedJobs(_restDone);
+        }
+        while (xSemaphoreTake(_restWorkerExit, pdMS_TO_TICKS(10)) != pdTRUE) {
+            deleteQueuedJobs(_restDone);
+        }
+        deleteQueuedJobs(_restQueue);
+        deleteQueuedJobs(_restDone);
+        deleteQueuedLogLines(_restLog);
+        vQueueDelete(_restQueue);
+        vQueueDelete(_restDone);
+        vQueueDelete(_restLog);
+        vSemaphoreDelete(_restWorkerExit);
+    }
+    vSemaphoreDelete(_restMutex);
+    vSemaphoreDelete(_socketMutex);
     
     // Clear callbacks
     _onReady = nullptr;
     _onMessage = nullptr;
+    _onMessageView = nullptr;
     _onGuildCreate = nullptr;
+    _onGuildCreateView = nullptr;
     _onError = nullptr;
     _onDebug = nullptr;
     _onRaw = nullptr;
+    _onRawPayload = nullptr;
+    for (int i = 0; i < DISCORD_EVENT_COUNT; i++) {
+        _eventHandlers[i] = nullptr;
+    }
+    _onGuildChannel = nullptr;
+    _onGuildRole = nullptr;
+    _onGuildMember = nullptr;
 }
 
 // Authentication methods
@@ -108,15 +393,19 @@ String DiscordAPI::exchangeCodeForToken(String code) {
                   "&grant_type=authorization_code&code=" + code + 
                   "&redirect_uri=" + _redirectUri;
     
+    xSemaphoreTake(_restMutex, portMAX_DELAY);
     _httpClient.begin(_wifiClient, url);
     _httpClient.addHeader("Content-Type", "application/x-www-form-urlencoded");
     
     int httpResponseCode = _httpClient.POST(body);
     String response = _httpClient.getString();
     _httpClient.end();
+    _restLastUsed = millis();
+    xSemaphoreGive(_restMutex);
     
     if (httpResponseCode == 200) {
-        JsonDocument doc;
+        DiscordPooledDocument lease(_inboundDocuments);
+        JsonDocument& doc = *lease;
         deserializeJson(doc, response);
         return doc["access_token"].as<String>();
     }
@@ -161,26 +450,263 @@ String DiscordAPI::_getAuthHeader() {
     return "";
 }
 
-DiscordResponse DiscordAPI::_makeRequest(String method, String endpoint, String body) {
+// Response headers read by _updateRateLimit() and _performRequest()
+static const char* REST_RESPONSE_HEADERS[] = {
+    "X-RateLimit-Bucket",
+    "X-RateLimit-Remaining",
+    "X-RateLimit-Reset-After",
+    "X-RateLimit-Global",
+    "Retry-After",
+    "Transfer-Encoding"
+};
+
+static uint32_t fnv1a(uint32_t hash, const char* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Hashes the rate limit route of a request: the method and the path with
+// every id replaced by a placeholder except the major parameter (the id
+// after channels/, guilds/ or webhooks/), whose hash is returned separately
+// so routes of one bucket can be matched per channel or guild.
+static void rateLimitRoute(const char* method, const char* endpoint, uint32_t& route, uint32_t& major) {
+    route = fnv1a(2166136261u, method, strlen(method));
+    major = 2166136261u;
+    bool majorSeen = false;
+    const char* previous = "";
+    size_t previousLength = 0;
+    const char* p = endpoint;
+    while (*p != '\0' && *p != '?') {
+        if (*p == '/') {
+            p++;
+            continue;
+        }
+        const char* segment = p;
+        bool numeric = true;
+        while (*p != '\0' && *p != '/' && *p != '?') {
+            numeric = numeric && *p >= '0' && *p <= '9';
+            p++;
+        }
+        size_t length = p - segment;
+
+        bool majorParent = (previousLength == 8 && memcmp(previous, "channels", 8) == 0) ||
+                           (previousLength == 6 && memcmp(previous, "guilds", 6) == 0) ||
+                           (previousLength == 8 && memcmp(previous, "webhooks", 8) == 0);
+        route = fnv1a(route, "/", 1);
+        if (numeric && majorParent && !majorSeen) {
+            majorSeen = true;
+            major = fnv1a(major, segment, length);
+            route = fnv1a(route, segment, length);
+        } else if (numeric) {
+            route = fnv1a(route, ":id", 3);
+        } else if (previousLength == 9 && memcmp(previous, "reactions", 9) == 0) {
+            route = fnv1a(route, ":emoji", 6);
+        } else {
+            route = fnv1a(route, segment, length);
+        }
+        previous = segment;
+        previousLength = length;
+    }
+    // 0 marks an unused bucket slot
+    if (route == 0) {
+        route = 1;
+    }
+}
+
+// Milliseconds until a request to `endpoint` can be sent without a 429.
+// Bucket state belongs to _restMutex, which the caller holds.
+unsigned long DiscordAPI::_requestWait(const char* method, const char* endpoint) {
+    uint32_t route;
+    uint32_t major;
+    rateLimitRoute(method, endpoint, route, major);
+    return _rateLimitWait(route, millis());
+}
+
+// Not sent: the route's bucket would not refill in time
+static DiscordResponse rateLimitedResponse(unsigned long wait) {
+    DiscordResponse response;
+    response.success = false;
+    response.statusCode = 0;
+    response.error = "Rate limited. Try again in " + String(wait) + " ms.";
+    response.retryAfter = 0;
+    return response;
+}
+
+// Blocking calls and the REST worker share one HTTP client; only one of
+// them uses it at a time. Waits for a bucket to refill and 429 retries
+// (only with setRateLimitRetry(true)) happen with the client released, so
+// other routes and the worker carry on meanwhile.
+DiscordResponse DiscordAPI::_makeRequest(const char* method, const char* endpoint, const String& body,
+                                         JsonDocument* doc, JsonVariantConst filter) {
+    unsigned long started = millis();
+    unsigned long waited = 0;
+    for (int attempts = 0;; attempts++) {
+        // The wait is checked and the request sent under one lock, so no
+        // other request can take the bucket in between
+        xSemaphoreTake(_restMutex, portMAX_DELAY);
+        unsigned long wait = _requestWait(method, endpoint);
+        DiscordResponse response;
+        if (wait == 0) {
+            response = _performRequest(method, endpoint, body, doc, filter);
+        }
+        xSemaphoreGive(_restMutex);
+
+        if (wait > 0) {
+            waited += wait;
+            if (waited > DISCORD_RATE_LIMIT_MAX_WAIT) {
+                _debugLog("Request rate limited: " + String(endpoint), DEBUG_LEVEL_WARNING);
+                return rateLimitedResponse(wait);
+            }
+            _debugLog("Waiting " + String(wait) + " ms for rate limit: " + endpoint, DEBUG_LEVEL_VERBOSE);
+            delay(wait);
+            attempts--;
+            continue;
+        }
+
+        unsigned long retry = _blockingRateLimitRetry ? _rateLimitRetry(response, attempts, started) : 0;
+        if (retry == 0) {
+            return response;
+        }
+        _debugLog("Retrying " + String(endpoint) + " in " + String(retry) + " ms", DEBUG_LEVEL_INFO);
+        delay(retry);
+    }
+}
+
+DiscordResponse DiscordAPI::_performRequest(const char* method, const char* endpoint, const String& body,
+                                            JsonDocument* doc, JsonVariantConst filter) {
     DiscordResponse response;
     response.success = false;
     response.statusCode = 0;
     response.body = "";
     response.error = "";
+    response.retryAfter = 0;
     
-    _debugLog("Sending request: " + method + " " + endpoint, DEBUG_LEVEL_VERBOSE);
-    
-    // Check rate limiting
-    if (isRateLimited()) {
-        response.error = "Rate limited. Try again later.";
-        _debugLog("Request rate limited: " + endpoint, DEBUG_LEVEL_WARNING);
-        return response;
+    if (_onDebug) {
+        _debugLog("Sending request: " + String(method) + " " + endpoint, DEBUG_LEVEL_VERBOSE);
     }
     
-    String url = DISCORD_API_BASE + endpoint;
+    // Callers have waited for the route's bucket (_requestWait)
+    uint32_t route;
+    uint32_t major;
+    rateLimitRoute(method, endpoint, route, major);
+    
+    String url;
+    url.reserve(sizeof(DISCORD_API_BASE) + strlen(endpoint));
+    url = DISCORD_API_BASE;
+    url += endpoint;
     _debugLog("Full URL: " + url, DEBUG_LEVEL_VERBOSE);
     
+    unsigned long requestStart = millis();
+    if (requestStart - _lastRequestTime >= 1000) {
+        _lastRequestTime = requestStart;
+        _requestCount = 0;
+    }
+    _requestCount++;
+    _closeIdleRestConnection(requestStart);
+    bool reused = _restKeepAlive && _wifiClient.connected();
+    int httpResponseCode = _sendRestRequest(method, url, body);
+
+    // A kept-alive connection the server has already closed fails before
+    // any response arrives; resend once on a new connection. POST is not
+    // idempotent, so it is only resent when the request was never written.
+    if (reused && (httpResponseCode == HTTPC_ERROR_SEND_HEADER_FAILED ||
+                   httpResponseCode == HTTPC_ERROR_SEND_PAYLOAD_FAILED ||
+                   (httpResponseCode == HTTPC_ERROR_CONNECTION_LOST && strcmp(method, "POST") != 0))) {
+        _debugLog("REST connection closed by the server, reconnecting", DEBUG_LEVEL_VERBOSE);
+        _httpClient.end();
+        _wifiClient.stop();
+        _restStats.retries++;
+        reused = false;
+        httpResponseCode = _sendRestRequest(method, url, body);
+    }
+    _restStats.requests++;
+    if (reused) {
+        _restStats.reused++;
+    } else {
+        _restStats.connects++;
+    }
+    
+    _debugLog("HTTP Response Code: " + String(httpResponseCode), DEBUG_LEVEL_VERBOSE);
+    
+    response.statusCode = httpResponseCode;
+    bool parsed = true;
+    if (doc != nullptr && httpResponseCode >= 200 && httpResponseCode < 300) {
+        // Parse from the connection; a 100-message history is hundreds of KB
+        // that would otherwise sit in a String next to the document
+        DiscordBodyStream stream(_httpClient.getStream(), _httpClient.getSize(),
+                                 _httpClient.header("Transfer-Encoding").equalsIgnoreCase("chunked"));
+        DeserializationError error = filter.isNull()
+            ? deserializeJson(*doc, stream)
+            : deserializeJson(*doc, stream, DeserializationOption::Filter(filter));
+        if (!stream.drain()) {
+            // Whatever is left would be read as the next response
+            _debugLog("REST response body ended early, closing connection", DEBUG_LEVEL_WARNING);
+            _wifiClient.stop();
+        }
+        if (error) {
+            parsed = false;
+            response.error = "JSON parse error: " + String(error.c_str());
+        }
+    } else {
+        response.body = _httpClient.getString();
+    }
+    // Headers are only readable until end()
+    _updateRateLimit(route, major, httpResponseCode, millis());
+    if (httpResponseCode == 429) {
+        // The body's retry_after also covers limits the bucket headers
+        // don't describe; Retry-After is the fallback
+        DiscordPooledDocument lease(_inboundDocuments);
+        JsonDocument& retryDoc = *lease;
+        float retryAfter = 0;
+        if (!deserializeJson(retryDoc, response.body)) {
+            retryAfter = retryDoc["retry_after"] | 0.0f;
+        }
+        if (retryAfter <= 0) {
+            retryAfter = _httpClient.header("Retry-After").toFloat();
+        }
+        response.retryAfter = retryAfter > 0 ? (unsigned long)(retryAfter * 1000.0f + 0.999f) : 1000;
+        // _updateRateLimit() already paused every route if the response
+        // had the X-RateLimit-Global header; the body's flag is only the
+        // fallback for responses without it
+        if ((retryDoc["global"] | false) && !_httpClient.header("X-RateLimit-Global").equalsIgnoreCase("true")) {
+            unsigned long until = millis() + response.retryAfter;
+            if (_rateLimitReset == 0 || (long)(until - _rateLimitReset) > 0) {
+                _rateLimitReset = until;
+            }
+        }
+    }
+    // Keeps the connection open unless keep-alive is off or the server
+    // answered with "Connection: close"
+    _httpClient.end();
+    _restLastUsed = millis();
+    if (reused) {
+        _restStats.reusedMillis += _restLastUsed - requestStart;
+    } else {
+        _restStats.connectMillis += _restLastUsed - requestStart;
+    }
+    
+    _debugLog("Response body length: " + String(response.body.length()), DEBUG_LEVEL_VERBOSE);
+    
+    if (httpResponseCode >= 200 && httpResponseCode < 300 && !parsed) {
+        response.success = false;
+        _debugLog("Request failed: " + response.error, DEBUG_LEVEL_ERROR);
+    } else if (httpResponseCode >= 200 && httpResponseCode < 300) {
+        response.success = true;
+        _debugLog("Request successful: " + String(httpResponseCode), DEBUG_LEVEL_VERBOSE);
+    } else {
+        response.success = false;
+        response.error = "HTTP " + String(httpResponseCode) + ": " + response.body;
+        _debugLog("Request failed: " + response.error, DEBUG_LEVEL_ERROR);
+    }
+    
+    return response;
+}
+
+int DiscordAPI::_sendRestRequest(const char* method, const String& url, const String& body) {
     _httpClient.begin(_wifiClient, url);
+    _httpClient.collectHeaders(REST_RESPONSE_HEADERS, sizeof(REST_RESPONSE_HEADERS) / sizeof(REST_RESPONSE_HEADERS[0]));
     
     String authHeader = _getAuthHeader();
     _debugLog("Auth header: " + authHeader, DEBUG_LEVEL_VERBOSE);
@@ -194,214 +720,1027 @@ DiscordResponse DiscordAPI::_makeRequest(String method, String endpoint, String
     _debugLog("HTTP Headers set", DEBUG_LEVEL_VERBOSE);
     
     int httpResponseCode = 0;
-    if (method == "GET") {
+    if (strcmp(method, "GET") == 0) {
         _debugLog("Sending GET request...", DEBUG_LEVEL_VERBOSE);
         httpResponseCode = _httpClient.GET();
-    } else if (method == "POST") {
+    } else if (strcmp(method, "POST") == 0) {
         _debugLog("Sending POST request...", DEBUG_LEVEL_VERBOSE);
         httpResponseCode = _httpClient.POST(body);
-    } else if (method == "PUT") {
+    } else if (strcmp(method, "PUT") == 0) {
         _debugLog("Sending PUT request...", DEBUG_LEVEL_VERBOSE);
         httpResponseCode = _httpClient.PUT(body);
-    } else if (method == "PATCH") {
+    } else if (strcmp(method, "PATCH") == 0) {
         _debugLog("Sending PATCH request...", DEBUG_LEVEL_VERBOSE);
         httpResponseCode = _httpClient.PATCH(body);
-    } else if (method == "DELETE") {
+    } else if (strcmp(method, "DELETE") == 0) {
         _debugLog("Sending DELETE request...", DEBUG_LEVEL_VERBOSE);
         httpResponseCode = _httpClient.sendRequest("DELETE");
     }
-    
-    _debugLog("HTTP Response Code: " + String(httpResponseCode), DEBUG_LEVEL_VERBOSE);
-    
-    response.statusCode = httpResponseCode;
-    response.body = _httpClient.getString();
-    _httpClient.end();
-    
-    _debugLog("Response body length: " + String(response.body.length()), DEBUG_LEVEL_VERBOSE);
-    
-    // Update rate limiting
-    _lastRequestTime = millis();
-    _requestCount++;
-    
-    if (httpResponseCode >= 200 && httpResponseCode < 300) {
-        response.success = true;
-        _debugLog("Request successful: " + String(httpResponseCode), DEBUG_LEVEL_VERBOSE);
-    } else {
-        response.success = false;
-        response.error = "HTTP " + String(httpResponseCode) + ": " + response.body;
-        _debugLog("Request failed: " + response.error, DEBUG_LEVEL_ERROR);
+    return httpResponseCode;
+}
+
+// Closing an idle connection ourselves frees the TLS buffers and avoids
+// finding out on the next request that the server already dropped it
+void DiscordAPI::_closeIdleRestConnection(unsigned long now) {
+    if (_restLastUsed == 0 || _restIdleTimeout == 0 || now - _restLastUsed < _restIdleTimeout) {
+        return;
     }
-    
-    return response;
+    _restLastUsed = 0;
+    if (_wifiClient.connected()) {
+        _debugLog("Closing idle REST connection", DEBUG_LEVEL_VERBOSE);
+        _wifiClient.stop();
+    }
+}
+
+DiscordRateLimitBucket* DiscordAPI::_rateLimitBucket(uint32_t route, unsigned long now, bool create) {
+    DiscordRateLimitBucket* victim = &_rateLimitBuckets[0];
+    for (int i = 0; i < DISCORD_RATE_LIMIT_BUCKETS; i++) {
+        DiscordRateLimitBucket& entry = _rateLimitBuckets[i];
+        if (entry.route == route) {
+            entry.lastUsed = now;
+            return &entry;
+        }
+        if (victim->route != 0 && (entry.route == 0 || now - entry.lastUsed > now - victim->lastUsed)) {
+            victim = &entry;
+        }
+    }
+    if (!create) {
+        return nullptr;
+    }
+    memset(victim, 0, sizeof(DiscordRateLimitBucket));
+    victim->route = route;
+    victim->lastUsed = now;
+    return victim;
+}
+
+// Delay before retrying a request answered with a 429, or 0 when it is not
+// retried: another status, out of attempts, or past the retry deadline.
+// The jitter keeps boards that were limited together from retrying in step.
+unsigned long DiscordAPI::_rateLimitRetry(const DiscordResponse& response, int attempts, unsigned long started) {
+    if (response.statusCode != 429 || _rateLimitRetryDeadline == 0 || attempts >= DISCORD_RATE_LIMIT_MAX_RETRIES) {
+        return 0;
+    }
+    unsigned long retry = response.retryAfter + random(DISCORD_RATE_LIMIT_JITTER + 1);
+    if (millis() - started + retry > _rateLimitRetryDeadline) {
+        return 0;
+    }
+    return retry;
+}
+
+// Milliseconds until a request on `route` can be sent without a 429
+unsigned long DiscordAPI::_rateLimitWait(uint32_t route, unsigned long now) {
+    unsigned long wait = 0;
+    if (_rateLimitReset != 0) {
+        if ((long)(_rateLimitReset - now) > 0) {
+            wait = _rateLimitReset - now;
+        } else {
+            _rateLimitReset = 0;
+        }
+    }
+    if (_globalRateLimit > 0 && _requestCount >= _globalRateLimit && now - _lastRequestTime < 1000) {
+        unsigned long windowWait = 1000 - (now - _lastRequestTime);
+        if (windowWait > wait) {
+            wait = windowWait;
+        }
+    }
+    DiscordRateLimitBucket* entry = _rateLimitBucket(route, now, false);
+    if (entry != nullptr && entry->remaining <= 0 && (long)(entry->resetAt - now) > 0) {
+        if (entry->resetAt - now > wait) {
+            wait = entry->resetAt - now;
+        }
+    }
+    return wait;
+}
+
+void DiscordAPI::_updateRateLimit(uint32_t route, uint32_t major, int statusCode, unsigned long now) {
+    if (statusCode == 429 && _httpClient.header("X-RateLimit-Global").equalsIgnoreCase("true")) {
+        unsigned long retryAfter = (unsigned long)(_httpClient.header("Retry-After").toFloat() * 1000.0f);
+        _rateLimitReset = now + (retryAfter > 0 ? retryAfter : 1000);
+        _debugLog("Global rate limit hit, retry in " + String(retryAfter) + " ms", DEBUG_LEVEL_WARNING);
+        return;
+    }
+
+    // Routes without a limit send no bucket
+    String bucketId = _httpClient.header("X-RateLimit-Bucket");
+    if (bucketId.length() == 0) {
+        return;
+    }
+    int remaining = _httpClient.header("X-RateLimit-Remaining").toInt();
+    // Seconds with millisecond precision; rounded up so the wait never ends early
+    unsigned long resetAfter = (unsigned long)(_httpClient.header("X-RateLimit-Reset-After").toFloat() * 1000.0f + 0.999f);
+    uint32_t bucket = fnv1a(fnv1a(2166136261u, bucketId.c_str(), bucketId.length()), (const char*)&major, sizeof(major));
+
+    DiscordRateLimitBucket* entry = _rateLimitBucket(route, now, true);
+    entry->bucket = bucket;
+    entry->remaining = remaining;
+    entry->resetAt = now + resetAfter;
+    for (int i = 0; i < DISCORD_RATE_LIMIT_BUCKETS; i++) {
+        DiscordRateLimitBucket& other = _rateLimitBuckets[i];
+        if (other.route != 0 && other.bucket == bucket) {
+            other.remaining = remaining;
+            other.resetAt = entry->resetAt;
+        }
+    }
+
+    if (statusCode == 429) {
+        _debugLog("Rate limited on bucket " + bucketId + ", resets in " + String(resetAfter) + " ms", DEBUG_LEVEL_WARNING);
+    }
+}
+
+void DiscordAPI::setRestKeepAlive(bool enabled) {
+    xSemaphoreTake(_restMutex, portMAX_DELAY);
+    _restKeepAlive = enabled;
+    _httpClient.setReuse(enabled);
+    if (!enabled && _wifiClient.connected()) {
+        _wifiClient.stop();
+    }
+    xSemaphoreGive(_restMutex);
+}
+
+void DiscordAPI::setRestIdleTimeout(unsigned long timeoutMs) {
+    _restIdleTimeout = timeoutMs;
+}
+
+DiscordRestStats DiscordAPI::getRestStats() const {
+    return _restStats;
 }
 
 // REST API methods
+// Fields the _parse*() functions read, shared by the gateway event filters
+// and the REST getters
+static void messageFilter(JsonObject filter) {
+    static const char* const messageFields[] = {
+        "id", "channel_id", "guild_id", "content", "timestamp", "edited_timestamp",
+        "tts", "mention_everyone", "nonce", "pinned", "webhook_id", "type",
+        "application_id", "flags", "position", "author"
+    };
+    for (size_t i = 0; i < sizeof(messageFields) / sizeof(messageFields[0]); i++) {
+        filter[messageFields[i]] = true;
+    }
+    filter["mentions"][0]["id"] = true;
+    filter["mention_roles"] = true;
+}
+
+static void guildFilter(JsonObject filter) {
+    static const char* const guildFields[] = {
+        "id", "name", "icon", "icon_hash", "splash", "discovery_splash", "owner",
+        "owner_id", "permissions", "region", "afk_channel_id", "afk_timeout",
+        "widget_enabled", "widget_channel_id", "verification_level",
+        "default_message_notifications", "explicit_content_filter", "mfa_level",
+        "application_id", "system_channel_id", "system_channel_flags",
+        "rules_channel_id", "max_presences", "max_members", "vanity_url_code",
+        "description", "banner", "premium_tier", "premium_subscription_count",
+        "preferred_locale", "public_updates_channel_id", "max_video_channel_users",
+        "max_stage_video_channel_users", "nsfw_level", "premium_progress_bar_enabled",
+        "safety_alerts_channel_id", "member_count", "unavailable"
+    };
+    for (size_t i = 0; i < sizeof(guildFields) / sizeof(guildFields[0]); i++) {
+        filter[guildFields[i]] = true;
+    }
+}
+
 DiscordUser DiscordAPI::getCurrentUser() {
     DiscordUser user;
-    DiscordResponse response = _makeRequest("GET", "/users/@me");
+    DiscordPooledDocument lease(_inboundDocuments);
+    JsonDocument& doc = *lease;
+    DiscordResponse response = _makeRequest("GET", "/users/@me", "", &doc);
     
     if (response.success) {
-        JsonDocument doc;
-        deserializeJson(doc, response.body);
         _parseUser(doc.as<JsonObject>(), user);
     }
     
     return user;
 }
 
-DiscordUser DiscordAPI::getUser(String userId) {
+DiscordUser DiscordAPI::getUser(Snowflake userId) {
     DiscordUser user;
-    DiscordResponse response = _makeRequest("GET", "/users/" + userId);
+    if (_userCache.get(userId, user)) {
+        return user;
+    }
+    DiscordPath path;
+    path << "/users/" << userId;
+    DiscordPooledDocument lease(_inboundDocuments);
+    JsonDocument& doc = *lease;
+    DiscordResponse response = _makeRequest("GET", path.c_str(), "", &doc);
     
     if (response.success) {
-        JsonDocument doc;
-        deserializeJson(doc, response.body);
         _parseUser(doc.as<JsonObject>(), user);
+        _userCache.put(user.id, user);
     }
     
     return user;
 }
 
-DiscordGuild DiscordAPI::getGuild(String guildId) {
+DiscordGuild DiscordAPI::getGuild(Snowflake guildId) {
     DiscordGuild guild;
-    DiscordResponse response = _makeRequest("GET", "/guilds/" + guildId);
+    if (_guildCache.get(guildId, guild)) {
+        return guild;
+    }
+    DiscordPath path;
+    path << "/guilds/" << guildId;
+    JsonDocument filter;
+    guildFilter(filter.to<JsonObject>());
+    DiscordPooledDocument lease(_inboundDocuments);
+    JsonDocument& doc = *lease;
+    DiscordResponse response = _makeRequest("GET", path.c_str(), "", &doc, filter.as<JsonVariantConst>());
     
     if (response.success) {
-        JsonDocument doc;
-        deserializeJson(doc, response.body);
         _parseGuild(doc.as<JsonObject>(), guild);
+        _guildCache.put(guild.id, guild);
     }
     
     return guild;
 }
 
-DiscordChannel DiscordAPI::getChannel(String channelId) {
+DiscordChannel DiscordAPI::getChannel(Snowflake channelId) {
     DiscordChannel channel;
-    DiscordResponse response = _makeRequest("GET", "/channels/" + channelId);
+    if (_channelCache.get(channelId, channel)) {
+        return channel;
+    }
+    DiscordPath path;
+    path << "/channels/" << channelId;
+    DiscordPooledDocument lease(_inboundDocuments);
+    JsonDocument& doc = *lease;
+    DiscordResponse response = _makeRequest("GET", path.c_str(), "", &doc);
     
     if (response.success) {
-        JsonDocument doc;
-        deserializeJson(doc, response.body);
         _parseChannel(doc.as<JsonObject>(), channel);
+        _channelCache.put(channel.id, channel);
     }
     
     return channel;
 }
 
-DiscordMessage DiscordAPI::getMessage(String channelId, String messageId) {
+bool DiscordAPI::setUserCache(size_t capacity, unsigned long ttlMs, bool psram) {
+    if (!_userCache.begin(capacity, ttlMs, psram)) {
+        _debugLog("Failed to allocate user cache", DEBUG_LEVEL_ERROR);
+        return false;
+    }
+    return true;
+}
+
+bool DiscordAPI::setChannelCache(size_t capacity, unsigned long ttlMs, bool psram) {
+    if (!_channelCache.begin(capacity, ttlMs, psram)) {
+        _debugLog("Failed to allocate channel cache", DEBUG_LEVEL_ERROR);
+        return false;
+    }
+    return true;
+}
+
+bool DiscordAPI::setGuildCache(size_t capacity, unsigned long ttlMs, bool psram) {
+    if (!_guildCache.begin(capacity, ttlMs, psram)) {
+        _debugLog("Failed to allocate guild cache", DEBUG_LEVEL_ERROR);
+        return false;
+    }
+    return true;
+}
+
+DiscordCacheStats DiscordAPI::getUserCacheStats() const {
+    return _userCache.stats();
+}
+
+DiscordCacheStats DiscordAPI::getChannelCacheStats() const {
+    return _channelCache.stats();
+}
+
+DiscordCacheStats DiscordAPI::getGuildCacheStats() const {
+    return _guildCache.stats();
+}
+
+void DiscordAPI::clearCaches() {
+    _userCache.clear();
+    _channelCache.clear();
+    _guildCache.clear();
+}
+
+void DiscordAPI::setGuildState(size_t budgetBytes, uint32_t fields) {
+    _state.begin(budgetBytes, fields);
+
+    // The default GUILD_CREATE filter drops the arrays the store is built
+    // from, so widen it only while the store is on and go back to the
+    // default when it is turned off
+    JsonObject filter = eventFilter(EVENT_GUILD_CREATE)["d"].to<JsonObject>();
+    guildFilter(filter);
+    if (_state.enabled()) {
+        DiscordState::addFilter(filter, fields);
+    }
+    if (_state.enabled() && _wsAuthenticated) {
+        _debugLog("Guild state fills from the next GUILD_CREATE of each guild", DEBUG_LEVEL_INFO);
+    }
+}
+
+const DiscordState& DiscordAPI::getGuildState() const {
+    return _state;
+}
+
+DiscordMessage DiscordAPI::getMessage(Snowflake channelId, Snowflake messageId) {
     DiscordMessage message;
-    DiscordResponse response = _makeRequest("GET", "/channels/" + channelId + "/messages/" + messageId);
+    DiscordPath path;
+    path << "/channels/" << channelId << "/messages/" << messageId;
+    DiscordPooledDocument lease(_inboundDocuments);
+    JsonDocument& doc = *lease;
+    DiscordResponse response = _makeRequest("GET", path.c_str(), "", &doc);
     
     if (response.success) {
-        JsonDocument doc;
-        deserializeJson(doc, response.body);
         _parseMessage(doc.as<JsonObject>(), message);
     }
     
     return message;
 }
 
-DiscordMessage* DiscordAPI::getChannelMessages(String channelId, int limit, String before, String after, String around) {
-    String endpoint = "/channels/" + channelId + "/messages?limit=" + String(limit);
-    
-    if (before.length() > 0) {
-        endpoint += "&before=" + before;
+DiscordMessage* DiscordAPI::getChannelMessages(Snowflake channelId, int limit, Snowflake before, Snowflake after, Snowflake around) {
+    DiscordPath path;
+    path << "/channels/" << channelId << "/messages?limit=" << limit;
+    
+    if (before.isValid()) {
+        path << "&before=" << before;
+    }
+    if (after.isValid()) {
+        path << "&after=" << after;
+    }
+    if (around.isValid()) {
+        path << "&around=" << around;
+    }
+    
+    // Only the fields _parseMessage() reads; embeds, attachments and
+    // components are most of a history response
+    JsonDocument filter;
+    messageFilter(filter.add<JsonObject>());
+    DiscordPooledDocument lease(_inboundDocuments);
+    JsonDocument& doc = *lease;
+    DiscordResponse response = _makeRequest("GET", path.c_str(), "", &doc, filter.as<JsonVariantConst>());
+    
+    if (response.success) {
+        if (doc.is<JsonArray>()) {
+            JsonArray messages = doc.as<JsonArray>();
+            int messageCount = messages.size();
+            
+            if (messageCount > 0) {
+                DiscordMessage* messageArray = new (std::nothrow) DiscordMessage[messageCount];
+                if (messageArray == nullptr) {
+                    _debugLog("Failed to allocate memory for messages", DEBUG_LEVEL_ERROR);
+                    return nullptr;
+                }
+                
+                for (int i = 0; i < messageCount; i++) {
+                    if (messages[i].is<JsonObject>()) {
+                        _parseMessage(messages[i].as<JsonObject>(), messageArray[i]);
+                    }
+                }
+                
+                return messageArray;
+            }
+        }
+    }
+    
+    return nullptr;
+}
+
+int DiscordAPI::forEachChannelMessage(Snowflake channelId, DiscordHistoryCallback callback, void* context,
+                                      int maxMessages, Snowflake before, Snowflake after) {
+    if (callback == nullptr) {
+        return 0;
+    }
+    JsonDocument filter;
+    messageFilter(filter.add<JsonObject>());
+    // Reused for every page; clearing the lease gives its whole slot back
+    DiscordPooledDocument lease(_inboundDocuments);
+    JsonDocument& page = *lease;
+
+    bool forward = after.isValid();
+    Snowflake cursor = forward ? after : before;
+    int visited = 0;
+    while (maxMessages <= 0 || visited < maxMessages) {
+        int limit = DISCORD_HISTORY_PAGE_SIZE;
+        if (maxMessages > 0 && maxMessages - visited < limit) {
+            limit = maxMessages - visited;
+        }
+        DiscordPath path;
+        path << "/channels/" << channelId << "/messages?limit=" << limit;
+        if (cursor.isValid()) {
+            path << (forward ? "&after=" : "&before=") << cursor;
+        }
+
+        lease.clear();
+        DiscordResponse response = _makeRequest("GET", path.c_str(), "", &page, filter.as<JsonVariantConst>());
+        if (!response.success || !page.is<JsonArray>()) {
+            _debugLog("Channel history walk stopped after " + String(visited) + " messages", DEBUG_LEVEL_ERROR);
+            return -1;
+        }
+
+        // Pages come newest first; walking forward visits them reversed
+        JsonArray messages = page.as<JsonArray>();
+        size_t count = messages.size();
+        Snowflake previous = cursor;
+        bool reverse = count > 1 && forward == (messages[0]["id"].as<Snowflake>() > messages[count - 1]["id"].as<Snowflake>());
+        for (size_t i = 0; i < count; i++) {
+            JsonObject message = messages[reverse ? count - 1 - i : i];
+            Snowflake id = message["id"].as<Snowflake>();
+            if (forward ? id > cursor : (!cursor.isValid() || id < cursor)) {
+                cursor = id;
+            }
+            visited++;
+            if (!callback(MessageView(message, this), context) || visited == maxMessages) {
+                return visited;
+            }
+        }
+        // A short page is the end of the history; a page that didn't move
+        // the cursor would be fetched again forever
+        if ((int)count < limit || cursor == previous) {
+            break;
+        }
+    }
+    return visited;
+}
+
+static String messageBody(DiscordDocumentPool& pool, const String& content, bool tts) {
+    DiscordPooledDocument lease(pool);
+    JsonDocument& doc = *lease;
+    doc["content"] = content;
+    doc["tts"] = tts;
+    
+    String body;
+    serializeJson(doc, body);
+    return body;
+}
+
+static String editBody(DiscordDocumentPool& pool, const String& content) {
+    DiscordPooledDocument lease(pool);
+    JsonDocument& doc = *lease;
+    doc["content"] = content;
+    
+    String body;
+    serializeJson(doc, body);
+    return body;
+}
+
+DiscordResponse DiscordAPI::sendMessage(Snowflake channelId, String content, bool tts) {
+    if (content.length() > DISCORD_MAX_MESSAGE_LENGTH) {
+        DiscordResponse response;
+        response.success = false;
+        response.error = "Message too long. Maximum length is " + String(DISCORD_MAX_MESSAGE_LENGTH) + " characters.";
+        return response;
+    }
+    
+    DiscordPath path;
+    path << "/channels/" << channelId << "/messages";
+    return _makeRequest("POST", path.c_str(), messageBody(_outboundDocuments, content, tts));
+}
+
+DiscordResponse DiscordAPI::editMessage(Snowflake channelId, Snowflake messageId, String content) {
+    if (content.length() > DISCORD_MAX_MESSAGE_LENGTH) {
+        DiscordResponse response;
+        response.success = false;
+        response.error = "Message too long. Maximum length is " + String(DISCORD_MAX_MESSAGE_LENGTH) + " characters.";
+        return response;
+    }
+    
+    DiscordPath path;
+    path << "/channels/" << channelId << "/messages/" << messageId;
+    return _makeRequest("PATCH", path.c_str(), editBody(_outboundDocuments, content));
+}
+
+DiscordResponse DiscordAPI::deleteMessage(Snowflake channelId, Snowflake messageId) {
+    DiscordPath path;
+    path << "/channels/" << channelId << "/messages/" << messageId;
+    return _makeRequest("DELETE", path.c_str());
+}
+
+// Keeps the first failure, otherwise the latest response
+static void mergeResponse(DiscordResponse& result, const DiscordResponse& response) {
+    if (result.success) {
+        result = response;
+    }
+}
+
+DiscordResponse DiscordAPI::deleteMessages(Snowflake channelId, const Snowflake* messageIds, size_t count) {
+    DiscordResponse result;
+    result.success = true;
+    result.statusCode = 0;
+    result.body = "";
+    result.error = "";
+    result.retryAfter = 0;
+
+    Snowflake newest;
+    for (size_t i = 0; i < count; i++) {
+        if (messageIds[i] > newest) {
+            newest = messageIds[i];
+        }
+    }
+    uint64_t now = (uint64_t)time(nullptr) * 1000;
+    bool clockSet = now >= DISCORD_EPOCH;
+    if (!clockSet) {
+        now = newest.timestamp();
+    }
+    Snowflake cutoff = Snowflake::fromTimestamp(now - DISCORD_BULK_DELETE_MAX_AGE);
+
+    DiscordPath bulkPath;
+    bulkPath << "/channels/" << channelId << "/messages/bulk-delete";
+    Snowflake chunk[DISCORD_BULK_DELETE_MAX];
+    size_t chunkSize = 0;
+
+    for (size_t i = 0; i <= count; i++) {
+        if (i < count) {
+            Snowflake id = messageIds[i];
+            if (!id.isValid()) {
+                continue;
+            }
+            if (id < cutoff) {
+                mergeResponse(result, deleteMessage(channelId, id));
+                continue;
+            }
+            // Duplicates fail the whole request
+            bool duplicate = false;
+            for (size_t j = 0; j < chunkSize && !duplicate; j++) {
+                duplicate = chunk[j] == id;
+            }
+            if (!duplicate) {
+                chunk[chunkSize++] = id;
+            }
+            if (chunkSize < DISCORD_BULK_DELETE_MAX) {
+                continue;
+            }
+        }
+
+        if (chunkSize == 1) {
+            mergeResponse(result, deleteMessage(channelId, chunk[0]));
+        } else if (chunkSize > 1) {
+            DiscordPooledDocument lease(_outboundDocuments);
+            JsonDocument& doc = *lease;
+            JsonArray ids = doc["messages"].to<JsonArray>();
+            for (size_t j = 0; j < chunkSize; j++) {
+                ids.add(chunk[j]);
+            }
+            String body;
+            serializeJson(doc, body);
+            _debugLog("Bulk deleting " + String((int)chunkSize) + " messages", DEBUG_LEVEL_VERBOSE);
+            DiscordResponse response = _makeRequest("POST", bulkPath.c_str(), body);
+            // Without a clock the ages are only relative to the newest
+            // message, so a list that is all too old is only found out here
+            if (!clockSet && response.statusCode == 400) {
+                _debugLog("Bulk delete rejected, deleting " + String((int)chunkSize) + " messages one by one", DEBUG_LEVEL_INFO);
+                for (size_t j = 0; j < chunkSize; j++) {
+                    mergeResponse(result, deleteMessage(channelId, chunk[j]));
+                }
+            } else {
+                mergeResponse(result, response);
+            }
+        }
+        chunkSize = 0;
+    }
+    return result;
+}
+
+DiscordResponse DiscordAPI::addReaction(Snowflake channelId, Snowflake messageId, String emoji) {
+    DiscordPath path;
+    path << "/channels/" << channelId << "/messages/" << messageId << "/reactions/" << emoji << "/@me";
+    return _makeRequest("PUT", path.c_str());
+}
+
+DiscordResponse DiscordAPI::removeReaction(Snowflake channelId, Snowflake messageId, String emoji, Snowflake userId) {
+    DiscordPath path;
+    path << "/channels/" << channelId << "/messages/" << messageId << "/reactions/" << emoji << "/";
+    if (userId.isValid()) {
+        path << userId;
+    } else {
+        path << "@me";
+    }
+    return _makeRequest("DELETE", path.c_str());
+}
+
+DiscordResponse DiscordAPI::removeAllReactions(Snowflake channelId, Snowflake messageId) {
+    DiscordPath path;
+    path << "/channels/" << channelId << "/messages/" << messageId << "/reactions";
+    return _makeRequest("DELETE", path.c_str());
+}
+
+DiscordResponse DiscordAPI::removeAllReactionsForEmoji(Snowflake channelId, Snowflake messageId, String emoji) {
+    DiscordPath path;
+    path << "/channels/" << channelId << "/messages/" << messageId << "/reactions/" << emoji;
+    return _makeRequest("DELETE", path.c_str());
+}
+
+DiscordResponse DiscordAPI::requestJson(const char* method, const char* endpoint, JsonDocument& doc,
+                                        JsonVariantConst filter, const String& body) {
+    return _makeRequest(method, endpoint, body, &doc, filter);
+}
+
+// Asynchronous REST
+static const char* restMethod(const char* method) {
+    static const char* const METHODS[] = {"GET", "POST", "PUT", "PATCH", "DELETE"};
+    for (size_t i = 0; i < sizeof(METHODS) / sizeof(METHODS[0]); i++) {
+        if (strcmp(method, METHODS[i]) == 0) {
+            return METHODS[i];
+        }
+    }
+    return nullptr;
+}
+
+bool DiscordAPI::_startRestWorker() {
+    if (_restTask != nullptr) {
+        return true;
+    }
+    _restQueue = xQueueCreate(DISCORD_REST_QUEUE_LENGTH, sizeof(DiscordRestJob*));
+    // Room for every job the worker can hold: queued, parked and running
+    _restDone = xQueueCreate(DISCORD_REST_QUEUE_LENGTH * 2 + 1, sizeof(DiscordRestJob*));
+    _restLog = xQueueCreate(DISCORD_REST_LOG_QUEUE_LENGTH, sizeof(DiscordRestLogLine*));
+    _restWorkerExit = xSemaphoreCreateBinary();
+    if (_restQueue == nullptr || _restDone == nullptr || _restLog == nullptr || _restWorkerExit == nullptr ||
+        xTaskCreatePinnedToCore(_restWorkerTask, "discord_rest", DISCORD_REST_TASK_STACK, this,
+                                DISCORD_REST_TASK_PRIORITY, &_restTask, DISCORD_REST_TASK_CORE) != pdPASS) {
+        _debugLog("Failed to start REST worker", DEBUG_LEVEL_ERROR);
+        if (_restQueue != nullptr) vQueueDelete(_restQueue);
+        if (_restDone != nullptr) vQueueDelete(_restDone);
+        if (_restLog != nullptr) vQueueDelete(_restLog);
+        if (_restWorkerExit != nullptr) vSemaphoreDelete(_restWorkerExit);
+        _restQueue = nullptr;
+        _restDone = nullptr;
+        _restLog = nullptr;
+        _restWorkerExit = nullptr;
+        _restTask = nullptr;
+        return false;
+    }
+    return true;
+}
+
+// Finished jobs are kept in order until loop() makes room in _restDone;
+// the worker never blocks on it
+static void appendFinishedJob(DiscordRestJob**& tail, DiscordRestJob* job) {
+    job->next = nullptr;
+    *tail = job;
+    tail = &job->next;
+}
+
+// Requests answered with a 429 are parked until their retry is due, so
+// the worker carries on with requests on other routes meanwhile
+void DiscordAPI::_restWorkerTask(void* param) {
+    DiscordAPI* api = (DiscordAPI*)param;
+    DiscordRestJob* parked[DISCORD_REST_QUEUE_LENGTH];
+    int parkedCount = 0;
+    DiscordRestJob* finished = nullptr;
+    DiscordRestJob** finishedTail = &finished;
+
+    while (true) {
+        // A job handed over may be delivered and deleted at once, so its
+        // successor is read first
+        while (finished != nullptr) {
+            DiscordRestJob* next = finished->next;
+            if (xQueueSend(api->_restDone, &finished, 0) != pdTRUE) {
+                break;
+            }
+            finished = next;
+        }
+        if (finished == nullptr) {
+            finishedTail = &finished;
+        }
+
+        unsigned long now = millis();
+        TickType_t timeout = portMAX_DELAY;
+        for (int i = 0; i < parkedCount; i++) {
+            long due = (long)(parked[i]->dueAt - now);
+            TickType_t ticks = due > 0 ? pdMS_TO_TICKS(due) : 0;
+            if (ticks < timeout) {
+                timeout = ticks;
+            }
+        }
+        // Checks back for room while completions are waiting
+        if (finished != nullptr && timeout > pdMS_TO_TICKS(10)) {
+            timeout = pdMS_TO_TICKS(10);
+        }
+
+        DiscordRestJob* job = nullptr;
+        if (xQueueReceive(api->_restQueue, &job, timeout) == pdTRUE) {
+            // A null job is the destructor asking the worker to stop
+            if (job == nullptr) {
+                break;
+            }
+            if (api->_runRestJob(job, parked, parkedCount)) {
+                appendFinishedJob(finishedTail, job);
+            }
+        }
+
+        now = millis();
+        for (int i = 0; i < parkedCount;) {
+            if ((long)(parked[i]->dueAt - now) > 0) {
+                i++;
+                continue;
+            }
+            job = parked[i];
+            parked[i] = parked[--parkedCount];
+            if (api->_runRestJob(job, parked, parkedCount)) {
+                appendFinishedJob(finishedTail, job);
+            }
+        }
+    }
+
+    for (int i = 0; i < parkedCount; i++) {
+        delete parked[i];
+    }
+    while (finished != nullptr) {
+        DiscordRestJob* next = finished->next;
+        delete finished;
+        finished = next;
+    }
+    xSemaphoreGive(api->_restWorkerExit);
+    vTaskDelete(nullptr);
+}
+
+// True when the job is finished; false when it was parked for a retry
+bool DiscordAPI::_runRestJob(DiscordRestJob* job, DiscordRestJob** parked, int& parkedCount) {
+    for (;;) {
+        xSemaphoreTake(_restMutex, portMAX_DELAY);
+        unsigned long wait = _requestWait(job->method, job->path.c_str());
+        if (wait == 0) {
+            job->response = _performRequest(job->method, job->path.c_str(), job->body);
+        }
+        xSemaphoreGive(_restMutex);
+        if (wait == 0) {
+            break;
+        }
+        if (wait > DISCORD_RATE_LIMIT_MAX_WAIT) {
+            _debugLog("Request rate limited: " + String(job->path.c_str()), DEBUG_LEVEL_WARNING);
+            job->response = rateLimitedResponse(wait);
+            return true;
+        }
+        // Parked like a 429 retry; the worker moves on to other routes
+        if (parkedCount < DISCORD_REST_QUEUE_LENGTH) {
+            job->dueAt = millis() + wait;
+            parked[parkedCount++] = job;
+            return false;
+        }
+        delay(wait);
+    }
+
+    unsigned long retry = _rateLimitRetry(job->response, job->attempts, job->queuedAt);
+    if (retry > 0 && parkedCount < DISCORD_REST_QUEUE_LENGTH) {
+        _debugLog("Retrying " + String(job->path.c_str()) + " in " + String(retry) + " ms", DEBUG_LEVEL_INFO);
+        job->attempts++;
+        job->dueAt = millis() + retry;
+        parked[parkedCount++] = job;
+        return false;
+    }
+    return true;
+}
+
+// Runs on the worker; never blocks, a full queue drops the line
+void DiscordAPI::_queueRestLog(const String& message, int level) {
+    DiscordRestLogLine* line = new (std::nothrow) DiscordRestLogLine();
+    if (line != nullptr) {
+        line->message = message;
+        line->level = level;
+        if (xQueueSend(_restLog, &line, 0) == pdTRUE) {
+            return;
+        }
+        delete line;
+    }
+    _restLogDropped++;
+}
+
+void DiscordAPI::_logRestWorker() {
+    if (_restLog == nullptr) {
+        return;
+    }
+    DiscordRestLogLine* line = nullptr;
+    while (xQueueReceive(_restLog, &line, 0) == pdTRUE) {
+        _debugLog(line->message, line->level);
+        delete line;
+    }
+    int dropped = _restLogDropped.exchange(0);
+    if (dropped > 0) {
+        _debugLog("Dropped " + String(dropped) + " REST worker debug messages", DEBUG_LEVEL_WARNING);
+    }
+}
+
+// Completion callbacks run here, on the caller's task, so they can use the
+// rest of the API like any other callback
+void DiscordAPI::_deliverRestCompletions() {
+    if (_restDone == nullptr) {
+        return;
+    }
+    DiscordRestJob* job = nullptr;
+    while (xQueueReceive(_restDone, &job, 0) == pdTRUE) {
+        if (job->waiters.empty()) {
+            _restPending--;
+            if (job->callback) {
+                job->callback(job->id, job->response, job->context);
+            }
+        }
+        for (size_t i = 0; i < job->waiters.size(); i++) {
+            const DiscordRestWaiter& waiter = job->waiters[i];
+            _restPending--;
+            if (waiter.callback) {
+                waiter.callback(waiter.id, job->response, waiter.context);
+            }
+        }
+        delete job;
+    }
+}
+
+DiscordRestJob* DiscordAPI::_newRestJob(const char* method, const char* endpoint, const String& body) {
+    const char* verb = restMethod(method);
+    if (verb == nullptr) {
+        _debugLog("Unsupported REST method: " + String(method), DEBUG_LEVEL_ERROR);
+        return nullptr;
+    }
+    if (!_startRestWorker()) {
+        return nullptr;
+    }
+
+    DiscordRestJob* job = new (std::nothrow) DiscordRestJob();
+    if (job == nullptr) {
+        _debugLog("Out of memory queueing REST request", DEBUG_LEVEL_ERROR);
+        return nullptr;
+    }
+    job->id = _restNextId++;
+    if (_restNextId == 0) {
+        _restNextId = 1;
+    }
+    job->method = verb;
+    job->path << endpoint;
+    if (job->path.overflowed()) {
+        _debugLog("REST endpoint too long: " + String(endpoint), DEBUG_LEVEL_ERROR);
+        delete job;
+        return nullptr;
+    }
+    job->body = body;
+    job->callback = nullptr;
+    job->context = nullptr;
+    job->attempts = 0;
+    job->queuedAt = millis();
+    job->dueAt = 0;
+    job->next = nullptr;
+    return job;
+}
+
+// On failure the job still belongs to the caller
+bool DiscordAPI::_queueRestJob(DiscordRestJob* job) {
+    if (xQueueSend(_restQueue, &job, 0) != pdTRUE) {
+        _debugLog("REST queue full, dropping " + String(job->method) + " " + job->path.c_str(), DEBUG_LEVEL_WARNING);
+        return false;
+    }
+    return true;
+}
+
+uint32_t DiscordAPI::requestAsync(const char* method, const char* endpoint, const String& body,
+                                  DiscordRestCallback callback, void* context) {
+    DiscordRestJob* job = _newRestJob(method, endpoint, body);
+    if (job == nullptr) {
+        return 0;
+    }
+    job->callback = callback;
+    job->context = context;
+    uint32_t id = job->id;
+    if (!_queueRestJob(job)) {
+        delete job;
+        return 0;
+    }
+    _restPending++;
+    return id;
+}
+
+// Message coalescing. Batches live on the caller's task only: they are
+// filled by sendMessageAsync() and flushed from loop().
+uint32_t DiscordAPI::_coalesceMessage(Snowflake channelId, const String& content, DiscordRestCallback callback, void* context) {
+    DiscordMessageBatch* batch = nullptr;
+    DiscordMessageBatch* oldest = &_messageBatches[0];
+    for (int i = 0; i < DISCORD_COALESCE_CHANNELS; i++) {
+        DiscordMessageBatch& slot = _messageBatches[i];
+        if (slot.channelId == channelId) {
+            batch = &slot;
+            break;
+        }
+        if (!slot.channelId.isValid()) {
+            oldest = &slot;
+        } else if (oldest->channelId.isValid() && (long)(slot.openedAt - oldest->openedAt) < 0) {
+            oldest = &slot;
+        }
+    }
+
+    // Merged messages are split between calls, so always on a line boundary
+    if (batch != nullptr && batch->content.length() + 1 + content.length() > DISCORD_MAX_MESSAGE_LENGTH) {
+        _flushMessageBatch(*batch);
+        batch = nullptr;
     }
-    if (after.length() > 0) {
-        endpoint += "&after=" + after;
+    if (batch == nullptr) {
+        batch = oldest;
+        if (batch->channelId.isValid()) {
+            _flushMessageBatch(*batch);
+        }
+        batch->channelId = channelId;
+        batch->openedAt = millis();
     }
-    if (around.length() > 0) {
-        endpoint += "&around=" + around;
+
+    DiscordRestWaiter waiter;
+    waiter.id = _restNextId++;
+    if (_restNextId == 0) {
+        _restNextId = 1;
     }
-    
-    DiscordResponse response = _makeRequest("GET", endpoint);
-    
-    if (response.success) {
-        JsonDocument doc;
-        DeserializationError error = deserializeJson(doc, response.body);
-        if (error) {
-            _debugLog("JSON parse error in getChannelMessages: " + String(error.c_str()), DEBUG_LEVEL_ERROR);
-            return nullptr;
+    waiter.callback = callback;
+    waiter.context = context;
+    if (!batch->waiters.push_back(waiter)) {
+        _debugLog("Out of memory coalescing message", DEBUG_LEVEL_ERROR);
+        if (batch->waiters.empty()) {
+            batch->channelId = Snowflake();
         }
-        
-        if (doc.is<JsonArray>()) {
-            JsonArray messages = doc.as<JsonArray>();
-            int messageCount = messages.size();
-            
-            if (messageCount > 0) {
-                DiscordMessage* messageArray = new (std::nothrow) DiscordMessage[messageCount];
-                if (messageArray == nullptr) {
-                    _debugLog("Failed to allocate memory for messages", DEBUG_LEVEL_ERROR);
-                    return nullptr;
-                }
-                
-                for (int i = 0; i < messageCount; i++) {
-                    if (messages[i].is<JsonObject>()) {
-                        _parseMessage(messages[i].as<JsonObject>(), messageArray[i]);
-                    }
-                }
-                
-                return messageArray;
-            }
+        return 0;
+    }
+    if (batch->content.length() > 0) {
+        batch->content += '\n';
+    }
+    batch->content += content;
+    _restPending++;
+    return waiter.id;
+}
+
+void DiscordAPI::_flushMessageBatch(DiscordMessageBatch& batch) {
+    DiscordPath path;
+    path << "/channels/" << batch.channelId << "/messages";
+    DiscordRestJob* job = _newRestJob("POST", path.c_str(), messageBody(_outboundDocuments, batch.content, false));
+    if (job != nullptr) {
+        job->waiters = static_cast<DiscordRestWaiters&&>(batch.waiters);
+        if (!_queueRestJob(job)) {
+            batch.waiters = static_cast<DiscordRestWaiters&&>(job->waiters);
+            delete job;
+            job = nullptr;
         }
     }
-    
-    return nullptr;
-}
 
-DiscordResponse DiscordAPI::sendMessage(String channelId, String content, bool tts) {
-    if (content.length() > DISCORD_MAX_MESSAGE_LENGTH) {
+    // The callers already hold request ids, so they are told here
+    if (job == nullptr) {
         DiscordResponse response;
+        response.statusCode = 0;
         response.success = false;
-        response.error = "Message too long. Maximum length is " + String(DISCORD_MAX_MESSAGE_LENGTH) + " characters.";
-        return response;
+        response.error = "Could not queue coalesced message";
+        response.retryAfter = 0;
+        for (size_t i = 0; i < batch.waiters.size(); i++) {
+            const DiscordRestWaiter& waiter = batch.waiters[i];
+            _restPending--;
+            if (waiter.callback) {
+                waiter.callback(waiter.id, response, waiter.context);
+            }
+        }
     }
-    
-    JsonDocument doc;
-    doc["content"] = content;
-    doc["tts"] = tts;
-    
-    String body;
-    serializeJson(doc, body);
-    
-    return _makeRequest("POST", "/channels/" + channelId + "/messages", body);
+
+    batch.channelId = Snowflake();
+    batch.content = "";
+    batch.waiters.clear();
 }
 
-DiscordResponse DiscordAPI::editMessage(String channelId, String messageId, String content) {
-    if (content.length() > DISCORD_MAX_MESSAGE_LENGTH) {
-        DiscordResponse response;
-        response.success = false;
-        response.error = "Message too long. Maximum length is " + String(DISCORD_MAX_MESSAGE_LENGTH) + " characters.";
-        return response;
+void DiscordAPI::_flushMessageBatches(unsigned long now) {
+    for (int i = 0; i < DISCORD_COALESCE_CHANNELS; i++) {
+        DiscordMessageBatch& batch = _messageBatches[i];
+        if (batch.channelId.isValid() && now - batch.openedAt >= _coalesceWindow) {
+            _flushMessageBatch(batch);
+        }
+    }
+}
+
+void DiscordAPI::setMessageCoalescing(unsigned long windowMs) {
+    _coalesceWindow = windowMs;
+    if (windowMs == 0) {
+        _flushMessageBatches(millis());
     }
-    
-    JsonDocument doc;
-    doc["content"] = content;
-    
-    String body;
-    serializeJson(doc, body);
-    
-    return _makeRequest("PATCH", "/channels/" + channelId + "/messages/" + messageId, body);
 }
 
-DiscordResponse DiscordAPI::deleteMessage(String channelId, String messageId) {
-    return _makeRequest("DELETE", "/channels/" + channelId + "/messages/" + messageId);
+uint32_t DiscordAPI::sendMessageAsync(Snowflake channelId, String content, DiscordRestCallback callback, void* context) {
+    if (content.length() > DISCORD_MAX_MESSAGE_LENGTH) {
+        _debugLog("Message too long. Maximum length is " + String(DISCORD_MAX_MESSAGE_LENGTH) + " characters.", DEBUG_LEVEL_ERROR);
+        return 0;
+    }
+    if (_coalesceWindow > 0) {
+        return _coalesceMessage(channelId, content, callback, context);
+    }
+    DiscordPath path;
+    path << "/channels/" << channelId << "/messages";
+    return requestAsync("POST", path.c_str(), messageBody(_outboundDocuments, content, false), callback, context);
 }
 
-DiscordResponse DiscordAPI::addReaction(String channelId, String messageId, String emoji) {
-    return _makeRequest("PUT", "/channels/" + channelId + "/messages/" + messageId + "/reactions/" + emoji + "/@me");
+uint32_t DiscordAPI::editMessageAsync(Snowflake channelId, Snowflake messageId, String content,
+                                      DiscordRestCallback callback, void* context) {
+    if (content.length() > DISCORD_MAX_MESSAGE_LENGTH) {
+        _debugLog("Message too long. Maximum length is " + String(DISCORD_MAX_MESSAGE_LENGTH) + " characters.", DEBUG_LEVEL_ERROR);
+        return 0;
+    }
+    DiscordPath path;
+    path << "/channels/" << channelId << "/messages/" << messageId;
+    return requestAsync("PATCH", path.c_str(), editBody(_outboundDocuments, content), callback, context);
 }
 
-DiscordResponse DiscordAPI::removeReaction(String channelId, String messageId, String emoji, String userId) {
-    return _makeRequest("DELETE", "/channels/" + channelId + "/messages/" + messageId + "/reactions/" + emoji + "/" + userId);
+uint32_t DiscordAPI::deleteMessageAsync(Snowflake channelId, Snowflake messageId, DiscordRestCallback callback, void* context) {
+    DiscordPath path;
+    path << "/channels/" << channelId << "/messages/" << messageId;
+    return requestAsync("DELETE", path.c_str(), "", callback, context);
 }
 
-DiscordResponse DiscordAPI::removeAllReactions(String channelId, String messageId) {
-    return _makeRequest("DELETE", "/channels/" + channelId + "/messages/" + messageId + "/reactions");
+uint32_t DiscordAPI::addReactionAsync(Snowflake channelId, Snowflake messageId, String emoji,
+                                      DiscordRestCallback callback, void* context) {
+    DiscordPath path;
+    path << "/channels/" << channelId << "/messages/" << messageId << "/reactions/" << emoji << "/@me";
+    return requestAsync("PUT", path.c_str(), "", callback, context);
 }
 
-DiscordResponse DiscordAPI::removeAllReactionsForEmoji(String channelId, String messageId, String emoji) {
-    return _makeRequest("DELETE", "/channels/" + channelId + "/messages/" + messageId + "/reactions/" + emoji);
+int DiscordAPI::getPendingRestRequests() const {
+    return _restPending;
 }
 
 // WebSocket methods
@@ -416,7 +1755,7 @@ bool DiscordAPI::connectWebSocket() {
     
     // Determine gateway host and path
     const char* defaultGatewayHost = "gateway.discord.gg";
-    const char* defaultGatewayPath = "/?v=10&encoding=json";
+    String defaultGatewayPath = _gatewayQuery();
     String gatewayHost = defaultGatewayHost;
     String gatewayPath = defaultGatewayPath;
 
@@ -441,15 +1780,33 @@ bool DiscordAPI::connectWebSocket() {
     _debugLog("Using gateway path: " + gatewayPath, DEBUG_LEVEL_VERBOSE);
     _debugLog("Using gateway intents mask: " + String((unsigned long)_gatewayIntents), DEBUG_LEVEL_VERBOSE);
 
+    // Each connection is a new zlib stream
+    _inflate.reset();
+
+    // Nothing is sent on the old connection once the new one is set up;
+    // HELLO starts the heartbeat again
+    _heartbeatInterval = 0;
+    xSemaphoreTake(_socketMutex, portMAX_DELAY);
+
     // Try different WebSocket configuration
     _webSocket.beginSSL(gatewayHost.c_str(), 443, gatewayPath.c_str());
     _webSocket.setAuthorization("", _botToken.c_str());
     _webSocket.setReconnectInterval(5000);
     _webSocket.onEvent([this](WStype_t type, uint8_t* payload, size_t length) {
+        // Events raised by _webSocket.loop() come with the socket locked.
+        // The client is idle until this returns, so the lock is handed to
+        // the heartbeat task meanwhile; handlers that send take it back.
+        bool polling = _socketPolling;
+        if (polling) {
+            _socketPolling = false;
+            xSemaphoreGive(_socketMutex);
+        }
+
         switch (type) {
             case WStype_DISCONNECTED: {
                 _wsConnected = false;
                 _wsAuthenticated = false;
+                _heartbeatInterval = 0;
                 _debugLog("WebSocket disconnected", DEBUG_LEVEL_WARNING);
                 uint16_t closeCode = 0;
                 if (payload != nullptr && length >= sizeof(uint16_t)) {
@@ -543,6 +1900,7 @@ bool DiscordAPI::connectWebSocket() {
                 }
                 // Reset heartbeat state on disconnect
                 _lastHeartbeatAck = 0;
+                _heartbeatUnacked = 0;
                 _heartbeatMissedCount = 0;
 
                 if (_resumeInProgress) {
@@ -555,68 +1913,98 @@ bool DiscordAPI::connectWebSocket() {
                 break;
             }
             case WStype_CONNECTED:
+                _inflate.reset();
                 _wsConnected = true;
                 _connectionStartTime = millis();
                 _lastHeartbeatAck = millis();
+                _heartbeatUnacked = 0;
                 _heartbeatMissedCount = 0;
                 _debugLog("WebSocket connected to Discord gateway", DEBUG_LEVEL_INFO);
                 break;
             case WStype_TEXT:
                 {
                     if (payload != nullptr && length > 0) {
-                        String message = String((char*)payload);
-                        _debugLog("Received WebSocket message: " + message.substring(0, min(100, (int)message.length())) + "...", DEBUG_LEVEL_VERBOSE);
-                        
-                        // Call onRaw callback for every WebSocket message
-                        if (_onRaw) {
-                            _onRaw(message);
-                        }
-                        
-                        JsonDocument doc;
-                        DeserializationError error = deserializeJson(doc, message);
-                        if (error) {
-                            _debugLog("JSON parse error: " + String(error.c_str()), DEBUG_LEVEL_ERROR);
-                            _debugLog("Raw message: " + message.substring(0, min(200, (int)message.length())), DEBUG_LEVEL_VERBOSE);
-                        } else {
-                            // Check if this is a HELLO message
-                            if (doc["op"].as<int>() == OPCODE_HELLO) {
-                                _debugLog("Received HELLO message from Discord!", DEBUG_LEVEL_INFO);
-                            }
-                            _handleWebSocketEvent(doc);
-                        }
+                        _handleTextFrame((const char*)payload, length);
                     } else {
                         _debugLog("Received empty WebSocket message", DEBUG_LEVEL_WARNING);
                     }
                 }
                 break;
+            case WStype_BIN:
+            case WStype_FRAGMENT_BIN_START:
+            case WStype_FRAGMENT:
+            case WStype_FRAGMENT_FIN:
+                if (_gatewayCompression) {
+                    _handleCompressedFrame(payload, length);
+                } else if (_gatewayEncoding == GATEWAY_ENCODING_ETF && type == WStype_BIN) {
+                    _handleEtfFrame(payload, length);
+                } else {
+                    _debugLog("Ignoring binary WebSocket message", DEBUG_LEVEL_WARNING);
+                }
+                break;
             case WStype_ERROR:
                 _debugLog("WebSocket error occurred", DEBUG_LEVEL_ERROR);
                 break;
             default:
                 break;
         }
+
+        if (polling) {
+            xSemaphoreTake(_socketMutex, portMAX_DELAY);
+            _socketPolling = true;
+        }
     });
+    xSemaphoreGive(_socketMutex);
     
     return true;
 }
 
 void DiscordAPI::disconnectWebSocket() {
-    _webSocket.disconnect();
+    _disconnectSocket();
     _wsConnected = false;
     _wsAuthenticated = false;
 }
 
+// The client raises WStype_DISCONNECTED from inside disconnect()
+void DiscordAPI::_disconnectSocket() {
+    xSemaphoreTake(_socketMutex, portMAX_DELAY);
+    _webSocket.disconnect();
+    xSemaphoreGive(_socketMutex);
+}
+
 void DiscordAPI::loop() {
+    // After a gap (a slow sketch or handler) ACKs may still be queued on
+    // the socket; _checkConnectionStability() waits for them to be read
+    unsigned long now = millis();
+    if (_lastPoll == 0 || now - _lastPoll > DISCORD_HEARTBEAT_ACK_GRACE) {
+        _pollingSince = now;
+    }
+    _lastPoll = now;
+
+    xSemaphoreTake(_socketMutex, portMAX_DELAY);
+    _socketPolling = true;
     _webSocket.loop();
+    _socketPolling = false;
+    xSemaphoreGive(_socketMutex);
 
-    unsigned long now = millis();
+    now = millis();
+    _flushMessageBatches(now);
+    _logRestWorker();
+    _deliverRestCompletions();
+    _logHeartbeats();
+    // Skipped while the REST worker holds the connection
+    if (_restLastUsed != 0 && xSemaphoreTake(_restMutex, 0) == pdTRUE) {
+        _closeIdleRestConnection(now);
+        xSemaphoreGive(_restMutex);
+    }
 
     if (!_wsConnected) {
         _handleReconnect();
         return;
     }
 
-    if (_heartbeatInterval > 0 && now - _lastHeartbeat >= _heartbeatInterval) {
+    // Only when the heartbeat task could not be started
+    if (_heartbeatTask == nullptr && _heartbeatInterval > 0 && (long)(now - _nextHeartbeat) >= 0) {
         _sendHeartbeat();
     }
 
@@ -654,6 +2042,7 @@ void DiscordAPI::resetReconnectionState() {
 
 void DiscordAPI::resetConnectionState() {
     _lastHeartbeatAck = millis();
+    _heartbeatUnacked = 0;
     _connectionStartTime = millis();
     _heartbeatMissedCount = 0;
     _resumeInProgress = false;
@@ -665,13 +2054,14 @@ void DiscordAPI::forceDisconnect() {
     _resumeInProgress = false;
     
     if (_wsConnected) {
-        _webSocket.disconnect();
+        _disconnectSocket();
         _wsConnected = false;
         _wsAuthenticated = false;
     }
     
     // Reset all connection states
     _lastHeartbeatAck = 0;
+    _heartbeatUnacked = 0;
     _connectionStartTime = 0;
     _heartbeatMissedCount = 0;
     _sequenceNumber = -1;
@@ -685,68 +2075,635 @@ void DiscordAPI::forceDisconnect() {
     _debugLog("Force disconnect complete", DEBUG_LEVEL_INFO);
 }
 
-void DiscordAPI::debugConnectionState() {
-    _debugLog("=== Connection State Debug ===", DEBUG_LEVEL_INFO);
-    _debugLog("WebSocket Connected: " + String(_wsConnected ? "Yes" : "No"), DEBUG_LEVEL_INFO);
-    _debugLog("WebSocket Authenticated: " + String(_wsAuthenticated ? "Yes" : "No"), DEBUG_LEVEL_INFO);
-    _debugLog("Heartbeat Interval: " + String(_heartbeatInterval) + "ms", DEBUG_LEVEL_INFO);
-    _debugLog("Last Heartbeat: " + String(millis() - _lastHeartbeat) + "ms ago", DEBUG_LEVEL_INFO);
-    _debugLog("Last Heartbeat ACK: " + String(millis() - _lastHeartbeatAck) + "ms ago", DEBUG_LEVEL_INFO);
-    _debugLog("Sequence Number: " + String(_sequenceNumber), DEBUG_LEVEL_INFO);
-    _debugLog("Session ID: " + _sessionId, DEBUG_LEVEL_INFO);
-    _debugLog("Resume Gateway URL: " + _resumeGatewayUrl, DEBUG_LEVEL_INFO);
-    _debugLog("Reconnect Attempts: " + String(_reconnectAttempts) + "/" + String(_maxReconnectAttempts), DEBUG_LEVEL_INFO);
-    _debugLog("Reconnect Delay: " + String(_reconnectDelay) + "ms", DEBUG_LEVEL_INFO);
-    _debugLog("Heartbeat Missed Count: " + String(_heartbeatMissedCount), DEBUG_LEVEL_INFO);
-    _debugLog("Connection Start Time: " + String(millis() - _connectionStartTime) + "ms ago", DEBUG_LEVEL_INFO);
-}
+void DiscordAPI::debugConnectionState() {
+    _debugLog("=== Connection State Debug ===", DEBUG_LEVEL_INFO);
+    _debugLog("WebSocket Connected: " + String(_wsConnected ? "Yes" : "No"), DEBUG_LEVEL_INFO);
+    _debugLog("WebSocket Authenticated: " + String(_wsAuthenticated ? "Yes" : "No"), DEBUG_LEVEL_INFO);
+    _debugLog("Heartbeat Interval: " + String(_heartbeatInterval) + "ms", DEBUG_LEVEL_INFO);
+    _debugLog("Last Heartbeat: " + String(millis() - _lastHeartbeat) + "ms ago", DEBUG_LEVEL_INFO);
+    _debugLog("Last Heartbeat ACK: " + String(millis() - _lastHeartbeatAck) + "ms ago", DEBUG_LEVEL_INFO);
+    _debugLog("Heartbeats Awaiting ACK: " + String(_heartbeatUnacked), DEBUG_LEVEL_INFO);
+    _debugLog("Heartbeat Task: " + String(_heartbeatTask != nullptr ? "Running" : "Not started"), DEBUG_LEVEL_INFO);
+    _debugLog("Sequence Number: " + String(_sequenceNumber), DEBUG_LEVEL_INFO);
+    _debugLog("Session ID: " + _sessionId, DEBUG_LEVEL_INFO);
+    _debugLog("Resume Gateway URL: " + _resumeGatewayUrl, DEBUG_LEVEL_INFO);
+    _debugLog("Reconnect Attempts: " + String(_reconnectAttempts) + "/" + String(_maxReconnectAttempts), DEBUG_LEVEL_INFO);
+    _debugLog("Reconnect Delay: " + String(_reconnectDelay) + "ms", DEBUG_LEVEL_INFO);
+    _debugLog("Heartbeat Missed Count: " + String(_heartbeatMissedCount), DEBUG_LEVEL_INFO);
+    _debugLog("Connection Start Time: " + String(millis() - _connectionStartTime) + "ms ago", DEBUG_LEVEL_INFO);
+}
+
+// Gateway intent configuration
+void DiscordAPI::setGatewayIntents(uint32_t intents) {
+    _gatewayIntents = intents;
+    _debugLog("Gateway intents set to " + String((unsigned long)_gatewayIntents), DEBUG_LEVEL_INFO);
+}
+
+void DiscordAPI::addGatewayIntent(uint32_t intent) {
+    _gatewayIntents |= intent;
+    _debugLog("Gateway intents updated (add) => " + String((unsigned long)_gatewayIntents), DEBUG_LEVEL_VERBOSE);
+}
+
+void DiscordAPI::removeGatewayIntent(uint32_t intent) {
+    _gatewayIntents &= ~intent;
+    _debugLog("Gateway intents updated (remove) => " + String((unsigned long)_gatewayIntents), DEBUG_LEVEL_VERBOSE);
+}
+
+uint32_t DiscordAPI::getGatewayIntents() const {
+    return _gatewayIntents;
+}
+
+void DiscordAPI::setGatewayCompression(bool enabled) {
+    _gatewayCompression = enabled;
+    if (_wsConnected) {
+        _debugLog("Gateway compression change applies on the next connection", DEBUG_LEVEL_INFO);
+    }
+}
+
+bool DiscordAPI::getGatewayCompression() const {
+    return _gatewayCompression;
+}
+
+uint64_t DiscordAPI::getGatewayBytesReceived() const {
+    return _inflate.compressedBytes();
+}
+
+uint64_t DiscordAPI::getGatewayBytesInflated() const {
+    return _inflate.inflatedBytes();
+}
+
+void DiscordAPI::setGatewayEncoding(int encoding) {
+    if (encoding != GATEWAY_ENCODING_JSON && encoding != GATEWAY_ENCODING_ETF) {
+        _debugLog("Unknown gateway encoding: " + String(encoding), DEBUG_LEVEL_ERROR);
+        return;
+    }
+    _gatewayEncoding = encoding;
+    if (_wsConnected) {
+        _debugLog("Gateway encoding change applies on the next connection", DEBUG_LEVEL_INFO);
+    }
+}
+
+int DiscordAPI::getGatewayEncoding() const {
+    return _gatewayEncoding;
+}
+
+// Gateway deserialization filters
+void DiscordAPI::_initEventFilters() {
+    JsonObject ready = eventFilter(EVENT_READY)["d"].to<JsonObject>();
+    ready["session_id"] = true;
+    ready["resume_gateway_url"] = true;
+    ready["user"] = true;
+
+    messageFilter(eventFilter(EVENT_MESSAGE_CREATE)["d"].to<JsonObject>());
+    guildFilter(eventFilter(EVENT_GUILD_CREATE)["d"].to<JsonObject>());
+}
+
+DiscordEventFilter* DiscordAPI::_findEventFilter(const char* eventType, size_t length) {
+    for (int i = 0; i < _eventFilterCount; i++) {
+        const String& name = _eventFilters[i].eventType;
+        if (name.length() == length && memcmp(name.c_str(), eventType, length) == 0) {
+            return &_eventFilters[i];
+        }
+    }
+    return nullptr;
+}
+
+bool DiscordAPI::addEventFilter(const char* eventType) {
+    if (_findEventFilter(eventType, strlen(eventType)) != nullptr) {
+        return true;
+    }
+    if (_eventFilterCount >= DISCORD_MAX_EVENT_FILTERS) {
+        _debugLog("Too many event filters, not filtering " + String(eventType), DEBUG_LEVEL_WARNING);
+        return false;
+    }
+
+    DiscordEventFilter* entry = &_eventFilters[_eventFilterCount++];
+    entry->eventType = eventType;
+    entry->filter.clear();
+    // The envelope is always needed for sequence tracking and dispatch
+    entry->filter["op"] = true;
+    entry->filter["t"] = true;
+    entry->filter["s"] = true;
+    return true;
+}
+
+JsonDocument& DiscordAPI::eventFilter(const char* eventType) {
+    if (!addEventFilter(eventType)) {
+        // Out of slots: writes go to a document no frame is filtered with
+        _eventFilterScratch.clear();
+        return _eventFilterScratch;
+    }
+    return _findEventFilter(eventType, strlen(eventType))->filter;
+}
+
+void DiscordAPI::removeEventFilter(const char* eventType) {
+    for (int i = 0; i < _eventFilterCount; i++) {
+        if (_eventFilters[i].eventType == eventType) {
+            for (int j = i; j < _eventFilterCount - 1; j++) {
+                _eventFilters[j].eventType = _eventFilters[j + 1].eventType;
+                _eventFilters[j].filter.set(_eventFilters[j + 1].filter);
+            }
+            _eventFilterCount--;
+            _eventFilters[_eventFilterCount].eventType = "";
+            _eventFilters[_eventFilterCount].filter.clear();
+            return;
+        }
+    }
+}
+
+void DiscordAPI::setGuildCreateStreaming(bool enabled) {
+    _guildStreaming = enabled;
+    _debugLog("GUILD_CREATE streaming " + String(enabled ? "enabled" : "disabled"), DEBUG_LEVEL_VERBOSE);
+}
+
+void DiscordAPI::onGuildChannel(void (*callback)(const DiscordChannel& channel)) {
+    _onGuildChannel = callback;
+}
+
+void DiscordAPI::onGuildRole(void (*callback)(Snowflake guildId, JsonObject role)) {
+    _onGuildRole = callback;
+}
+
+void DiscordAPI::onGuildMember(void (*callback)(Snowflake guildId, JsonObject member)) {
+    _onGuildMember = callback;
+}
+
+void DiscordAPI::setEventArenaSize(size_t bytes) {
+    if (_dispatchDepth > 0) {
+        _debugLog("Cannot resize the event arena from inside an event handler", DEBUG_LEVEL_WARNING);
+        return;
+    }
+    _eventArena.resize(bytes);
+}
+
+DiscordArenaStats DiscordAPI::getEventArenaStats() const {
+    return _eventArena.stats();
+}
+
+DiscordDocumentPoolStats DiscordAPI::getInboundDocumentStats() const {
+    return _inboundDocuments.stats();
+}
+
+DiscordDocumentPoolStats DiscordAPI::getOutboundDocumentStats() const {
+    return _outboundDocuments.stats();
+}
+
+void DiscordAPI::setPsramThreshold(size_t bytes) {
+    discordSetPsramThreshold(bytes);
+}
+
+DiscordMemoryStats DiscordAPI::getMemoryStats() const {
+    return discordMemoryStats();
+}
+
+void DiscordAPI::setEventFilteringEnabled(bool enabled) {
+    _eventFiltersEnabled = enabled;
+    _debugLog("Gateway event filtering " + String(enabled ? "enabled" : "disabled"), DEBUG_LEVEL_VERBOSE);
+}
+
+// Event handlers
+void DiscordAPI::onReady(void (*callback)(DiscordUser user)) {
+    _onReady = callback;
+}
+
+void DiscordAPI::onMessage(void (*callback)(DiscordMessage message)) {
+    _onMessage = callback;
+}
+
+void DiscordAPI::onGuildCreate(void (*callback)(DiscordGuild guild)) {
+    _onGuildCreate = callback;
+}
+
+void DiscordAPI::on(DiscordEventType type, void (*handler)(DiscordEventType type, JsonObject data)) {
+    if ((int)type < 0 || type >= DISCORD_EVENT_COUNT) {
+        _debugLog("Ignoring handler for invalid event type " + String((int)type), DEBUG_LEVEL_WARNING);
+        return;
+    }
+    _eventHandlers[type] = handler;
+}
+
+void DiscordAPI::onMessage(void (*callback)(const MessageView& message)) {
+    _onMessageView = callback;
+}
+
+void DiscordAPI::onGuildCreate(void (*callback)(const GuildView& guild)) {
+    _onGuildCreateView = callback;
+}
+
+void DiscordAPI::onError(void (*callback)(String error)) {
+    _onError = callback;
+}
+
+void DiscordAPI::onDebug(void (*callback)(String message, int level)) {
+    _onDebug = callback;
+}
+
+void DiscordAPI::onRaw(void (*callback)(String rawMessage)) {
+    _onRaw = callback;
+}
+
+void DiscordAPI::onRawPayload(void (*callback)(const char* payload, size_t length)) {
+    _onRawPayload = callback;
+}
+
+// WebSocket event handling
+// Finds a top-level string member of a JSON object without parsing the rest
+// of it, so the dispatch type can pick a filter before deserialization. Keys
+// nested inside "d" are skipped; the value is returned as a view into the
+// input (escape sequences are not decoded).
+static bool peekTopLevelString(const char* json, size_t length, const char* key, const char*& valueOut, size_t& valueLengthOut) {
+    size_t keyLength = strlen(key);
+    int depth = 0;
+    bool expectKey = false;
+
+    for (size_t i = 0; i < length; i++) {
+        char c = json[i];
+        if (c == '"') {
+            size_t start = ++i;
+            while (i < length && json[i] != '"') {
+                if (json[i] == '\\') i++;
+                i++;
+            }
+            if (i >= length) return false;
+            if (depth != 1 || !expectKey) continue;
+
+            expectKey = false;
+            bool match = (i - start == keyLength && memcmp(json + start, key, keyLength) == 0);
+            while (i < length && json[i] != ':') i++;
+            i++;
+            while (i < length && (json[i] == ' ' || json[i] == '\t' || json[i] == '\r' || json[i] == '\n')) i++;
+            if (i >= length) return false;
+            if (match) {
+                if (json[i] != '"') return false; // null or not a string
+                size_t valueStart = ++i;
+                while (i < length && json[i] != '"') {
+                    if (json[i] == '\\') i++;
+                    i++;
+                }
+                if (i >= length) return false;
+                valueOut = json + valueStart;
+                valueLengthOut = i - valueStart;
+                return true;
+            }
+            i--; // let the loop see the first character of the value
+            continue;
+        }
+        switch (c) {
+            case '{':
+            case '[':
+                depth++;
+                expectKey = (depth == 1 && c == '{');
+                break;
+            case '}':
+            case ']':
+                depth--;
+                break;
+            case ',':
+                expectKey = (depth == 1);
+                break;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+// Parses a gateway frame straight out of the WebSocket receive buffer. The
+// payload is never copied into a String; raw observers get the buffer itself
+// and onRaw() only pays for a copy when someone registered it.
+void DiscordAPI::_handleTextFrame(const char* payload, size_t length) {
+    if (_onDebug) {
+        _debugLog("Received WebSocket message: " + String(payload, min(length, (size_t)100)) + "...", DEBUG_LEVEL_VERBOSE);
+    }
+
+    if (_onRawPayload) {
+        _onRawPayload(payload, length);
+    }
+    if (_onRaw) {
+        _onRaw(String(payload, length));
+    }
+
+    const char* eventType = nullptr;
+    size_t eventTypeLength = 0;
+    bool hasEventType = peekTopLevelString(payload, length, "t", eventType, eventTypeLength);
+
+    if (hasEventType && _guildStreaming &&
+        discordEventType(eventType, eventTypeLength) == DISCORD_EVENT_GUILD_CREATE) {
+        _dispatchDepth++;
+        _streamGuildCreate(payload, length);
+        if (--_dispatchDepth == 0) {
+            _eventArena.reset();
+        }
+        return;
+    }
+
+    DiscordEventFilter* filter = nullptr;
+    if (hasEventType && _eventFiltersEnabled && _eventFilterCount > 0) {
+        filter = _findEventFilter(eventType, eventTypeLength);
+    }
+
+    // Nested dispatches (a callback pumping loop()) share the arena; it is
+    // only reset when the outermost one is done with it
+    _dispatchDepth++;
+    {
+        JsonDocument doc(&_eventArena);
+        DeserializationError error = filter != nullptr
+            ? deserializeJson(doc, payload, length, DeserializationOption::Filter(filter->filter))
+            : deserializeJson(doc, payload, length);
+        if (error) {
+            _debugLog("JSON parse error: " + String(error.c_str()), DEBUG_LEVEL_ERROR);
+            if (_onDebug) {
+                _debugLog("Raw message: " + String(payload, min(length, (size_t)200)), DEBUG_LEVEL_VERBOSE);
+            }
+        } else {
+            // Check if this is a HELLO message
+            if (doc["op"].as<int>() == OPCODE_HELLO) {
+                _debugLog("Received HELLO message from Discord!", DEBUG_LEVEL_INFO);
+            }
+            _handleWebSocketEvent(doc);
+        }
+    }
+    if (--_dispatchDepth == 0) {
+        _eventArena.reset();
+    }
+}
+
+// zlib-stream frames are inflated into the inflater's reusable buffer and
+// then take the same path as plain text frames. A message may span several
+// frames; nothing is dispatched until its sync-flush suffix arrives.
+void DiscordAPI::_handleCompressedFrame(const uint8_t* payload, size_t length) {
+    if (payload == nullptr || length == 0) {
+        return;
+    }
 
-// Gateway intent configuration
-void DiscordAPI::setGatewayIntents(uint32_t intents) {
-    _gatewayIntents = intents;
-    _debugLog("Gateway intents set to " + String((unsigned long)_gatewayIntents), DEBUG_LEVEL_INFO);
+    int result = _inflate.push(payload, length);
+    if (result == DISCORD_INFLATE_PENDING) {
+        return;
+    }
+    if (result == DISCORD_INFLATE_ERROR) {
+        // The stream state is lost; only a new connection can recover
+        _debugLog("Gateway decompression failed: " + String(_inflate.error()), DEBUG_LEVEL_ERROR);
+        if (_onError) _onError("Gateway decompression failed");
+        _disconnectSocket();
+        return;
+    }
+    if (_gatewayEncoding == GATEWAY_ENCODING_ETF) {
+        _handleEtfFrame((const uint8_t*)_inflate.data(), _inflate.length());
+    } else {
+        _handleTextFrame(_inflate.data(), _inflate.length());
+    }
 }
 
-void DiscordAPI::addGatewayIntent(uint32_t intent) {
-    _gatewayIntents |= intent;
-    _debugLog("Gateway intents updated (add) => " + String((unsigned long)_gatewayIntents), DEBUG_LEVEL_VERBOSE);
-}
+// ETF counterpart of _handleTextFrame: the frame is decoded into the same
+// kind of document (with the same per-event filters) and dispatched the
+// same way. Raw observers get the binary frame.
+void DiscordAPI::_handleEtfFrame(const uint8_t* payload, size_t length) {
+    if (payload == nullptr || length == 0) {
+        _debugLog("Received empty WebSocket message", DEBUG_LEVEL_WARNING);
+        return;
+    }
 
-void DiscordAPI::removeGatewayIntent(uint32_t intent) {
-    _gatewayIntents &= ~intent;
-    _debugLog("Gateway intents updated (remove) => " + String((unsigned long)_gatewayIntents), DEBUG_LEVEL_VERBOSE);
-}
+    if (_onRawPayload) {
+        _onRawPayload((const char*)payload, length);
+    }
+    if (_onRaw) {
+        _onRaw(String((const char*)payload, length));
+    }
 
-uint32_t DiscordAPI::getGatewayIntents() const {
-    return _gatewayIntents;
-}
+    DiscordEventFilter* filter = nullptr;
+    if (_eventFiltersEnabled && _eventFilterCount > 0) {
+        const char* eventType = nullptr;
+        size_t eventTypeLength = 0;
+        if (peekEtfString(payload, length, "t", eventType, eventTypeLength)) {
+            filter = _findEventFilter(eventType, eventTypeLength);
+        }
+    }
 
-// Event handlers
-void DiscordAPI::onReady(void (*callback)(DiscordUser user)) {
-    _onReady = callback;
+    _dispatchDepth++;
+    {
+        JsonDocument doc(&_eventArena);
+        DeserializationError error = filter != nullptr
+            ? deserializeEtf(doc, payload, length, filter->filter.as<JsonVariantConst>())
+            : deserializeEtf(doc, payload, length);
+        if (error) {
+            _debugLog("ETF decode error: " + String(error.c_str()), DEBUG_LEVEL_ERROR);
+        } else {
+            _handleWebSocketEvent(doc);
+        }
+    }
+    if (--_dispatchDepth == 0) {
+        _eventArena.reset();
+    }
 }
 
-void DiscordAPI::onMessage(void (*callback)(DiscordMessage message)) {
-    _onMessage = callback;
+// Outgoing payloads are built as JsonDocuments and encoded to match the
+// connection
+// `quiet` skips the debug log, for callers off the user task
+bool DiscordAPI::_sendGatewayPayload(JsonDocument& doc, bool quiet) {
+    if (_gatewayEncoding == GATEWAY_ENCODING_ETF) {
+        size_t length = measureEtf(doc.as<JsonVariantConst>());
+        uint8_t* buffer = (uint8_t*)malloc(length);
+        if (buffer == nullptr) {
+            if (!quiet) {
+                _debugLog("Out of memory encoding gateway payload", DEBUG_LEVEL_ERROR);
+            }
+            return false;
+        }
+        serializeEtf(doc.as<JsonVariantConst>(), buffer, length);
+        xSemaphoreTake(_socketMutex, portMAX_DELAY);
+        bool sent = _webSocket.sendBIN(buffer, length);
+        xSemaphoreGive(_socketMutex);
+        free(buffer);
+        return sent;
+    }
+
+    String message;
+    serializeJson(doc, message);
+    xSemaphoreTake(_socketMutex, portMAX_DELAY);
+    bool sent = _webSocket.sendTXT(message);
+    xSemaphoreGive(_socketMutex);
+    return sent;
 }
 
-void DiscordAPI::onGuildCreate(void (*callback)(DiscordGuild guild)) {
-    _onGuildCreate = callback;
+String DiscordAPI::_gatewayQuery() {
+    String query = _gatewayEncoding == GATEWAY_ENCODING_ETF ? "/?v=10&encoding=etf" : "/?v=10&encoding=json";
+    if (_gatewayCompression) {
+        query += "&compress=zlib-stream";
+    }
+    return query;
 }
 
-void DiscordAPI::onError(void (*callback)(String error)) {
-    _onError = callback;
+// Streaming GUILD_CREATE
+#define GUILD_ARRAY_CHANNELS 0
+#define GUILD_ARRAY_ROLES 1
+#define GUILD_ARRAY_MEMBERS 2
+
+static bool keyEquals(const char* key, size_t keyLength, const char* name) {
+    return strlen(name) == keyLength && memcmp(key, name, keyLength) == 0;
 }
 
-void DiscordAPI::onDebug(void (*callback)(String message, int level)) {
-    _onDebug = callback;
+void DiscordAPI::_streamGuildCreate(const char* payload, size_t length) {
+    DiscordJsonReader reader(payload, length);
+    const char* key = nullptr;
+    size_t keyLength = 0;
+
+    if (!reader.enterObject()) {
+        _debugLog("Invalid GUILD_CREATE frame", DEBUG_LEVEL_ERROR);
+        return;
+    }
+
+    while (reader.nextMember(key, keyLength)) {
+        if (keyEquals(key, keyLength, "s")) {
+            long sequence = 0;
+            if (reader.readInt(sequence)) {
+                _sequenceNumber = (int)sequence;
+            }
+        } else if (keyEquals(key, keyLength, "d") && reader.peek() == '{') {
+            _streamGuildObject(reader, payload + reader.position(), length - reader.position());
+        } else {
+            reader.skipValue();
+        }
+    }
+
+    if (reader.failed()) {
+        _debugLog("Malformed GUILD_CREATE payload near byte " + String((unsigned long)reader.position()), DEBUG_LEVEL_ERROR);
+    }
+}
+
+void DiscordAPI::_streamGuildObject(DiscordJsonReader& reader, const char* payload, size_t length) {
+    // Element callbacks need the guild id, which may come after the arrays
+    Snowflake guildId;
+    const char* idValue = nullptr;
+    size_t idLength = 0;
+    if (peekTopLevelString(payload, length, "id", idValue, idLength)) {
+        guildId = Snowflake::parse(idValue, idLength);
+    }
+    // The elements below rebuild the guild's stored state from scratch
+    _state.removeGuild(guildId);
+
+    // Scalar members are collected as raw JSON and parsed once at the end;
+    // the header is small and bounded however large the guild is
+    String header;
+    header.reserve(1024);
+    header = "{";
+
+    JsonDocument element(&_eventArena);
+    int channels = 0;
+    int roles = 0;
+    int members = 0;
+    const char* key = nullptr;
+    size_t keyLength = 0;
+
+    reader.enterObject();
+    while (reader.nextMember(key, keyLength)) {
+        char type = reader.peek();
+        if (type == '[') {
+            if ((_onGuildChannel || _channelCache.enabled() || _state.enabled()) &&
+                (keyEquals(key, keyLength, "channels") || keyEquals(key, keyLength, "threads"))) {
+                channels += _streamGuildArray(reader, element, guildId, GUILD_ARRAY_CHANNELS);
+            } else if ((_onGuildRole || (_state.fields() & DISCORD_STATE_ROLES)) && keyEquals(key, keyLength, "roles")) {
+                roles += _streamGuildArray(reader, element, guildId, GUILD_ARRAY_ROLES);
+            } else if (_onGuildMember && keyEquals(key, keyLength, "members")) {
+                members += _streamGuildArray(reader, element, guildId, GUILD_ARRAY_MEMBERS);
+            } else {
+                reader.skipValue();
+            }
+        } else if (type == '{') {
+            reader.skipValue();
+        } else {
+            const char* value = nullptr;
+            size_t valueLength = 0;
+            if (!reader.rawValue(value, valueLength)) {
+                break;
+            }
+            if (header.length() > 1) {
+                header += ",";
+            }
+            header += "\"";
+            header.concat(key, keyLength);
+            header += "\":";
+            header.concat(value, valueLength);
+        }
+    }
+    header += "}";
+
+    if (_onDebug) {
+        _debugLog("Streamed GUILD_CREATE " + guildId.toString() + ": " + String(channels) + " channels, " +
+                  String(roles) + " roles, " + String(members) + " members", DEBUG_LEVEL_VERBOSE);
+    }
+
+    if ((_onGuildCreate || _onGuildCreateView || _eventHandlers[DISCORD_EVENT_GUILD_CREATE] || _guildCache.enabled() ||
+         _state.enabled()) && !reader.failed()) {
+        JsonDocument doc(&_eventArena);
+        DeserializationError error = deserializeJson(doc, header);
+        if (error) {
+            _debugLog("GUILD_CREATE header parse error: " + String(error.c_str()), DEBUG_LEVEL_ERROR);
+            return;
+        }
+        _dispatchGuildCreate(doc.as<JsonObject>());
+        _updateCaches(DISCORD_EVENT_GUILD_CREATE, doc.as<JsonObject>());
+        if (!doc["unavailable"].as<bool>()) {
+            _state.putGuild(doc.as<JsonObject>());
+        }
+        _dispatchEvent(DISCORD_EVENT_GUILD_CREATE, doc.as<JsonObject>());
+    }
 }
 
-void DiscordAPI::onRaw(void (*callback)(String rawMessage)) {
-    _onRaw = callback;
+int DiscordAPI::_streamGuildArray(DiscordJsonReader& reader, JsonDocument& element, Snowflake guildId, int kind) {
+    int count = 0;
+    reader.enterArray();
+    while (reader.nextElement()) {
+        const char* value = nullptr;
+        size_t valueLength = 0;
+        if (!reader.rawValue(value, valueLength)) {
+            break;
+        }
+
+        DeserializationError error = deserializeJson(element, value, valueLength);
+        if (error || !element.is<JsonObject>()) {
+            _debugLog("Skipping unparseable GUILD_CREATE element", DEBUG_LEVEL_WARNING);
+            continue;
+        }
+
+        JsonObject obj = element.as<JsonObject>();
+        switch (kind) {
+            case GUILD_ARRAY_CHANNELS:
+                _state.putChannel(obj, guildId);
+                if (!_onGuildChannel && !_channelCache.enabled()) {
+                    break;
+                }
+                _parseChannel(obj, _eventChannel);
+                if (!_eventChannel.guild_id.isValid()) {
+                    _eventChannel.guild_id = guildId;
+                }
+                _channelCache.put(_eventChannel.id, _eventChannel);
+                if (_onGuildChannel) {
+                    _onGuildChannel(_eventChannel);
+                }
+                break;
+            case GUILD_ARRAY_ROLES:
+                _state.putRole(guildId, obj);
+                if (_onGuildRole) {
+                    _onGuildRole(guildId, obj);
+                }
+                break;
+            case GUILD_ARRAY_MEMBERS:
+                _onGuildMember(guildId, obj);
+                break;
+        }
+        count++;
+
+        // Elements are independent, so the arena can be recycled between
+        // them unless an outer dispatch still holds arena memory
+        element.clear();
+        if (_dispatchDepth == 1) {
+            _eventArena.reset();
+        }
+    }
+    element.clear();
+    return count;
 }
 
-// WebSocket event handling
 void DiscordAPI::_handleWebSocketEvent(JsonDocument& doc) {
     if (doc.isNull() || !doc.is<JsonObject>()) {
         _debugLog("Invalid JSON document received", DEBUG_LEVEL_ERROR);
@@ -758,22 +2715,31 @@ void DiscordAPI::_handleWebSocketEvent(JsonDocument& doc) {
     }
 
     int op = doc["op"].as<int>();
-    String eventType = doc["t"].as<String>();
-        
-    _debugLog("Processing WebSocket event: OP=" + String(op) + ", Type=" + eventType, DEBUG_LEVEL_VERBOSE);
+    JsonString eventName = doc["t"].as<JsonString>();
+    DiscordEventType eventType = discordEventType(eventName.c_str(), eventName.size());
+
+    if (_onDebug) {
+        _debugLog("Processing WebSocket event: OP=" + String(op) + ", Type=" + String(eventName.c_str()), DEBUG_LEVEL_VERBOSE);
+    }
     
     switch (op) {
         case OPCODE_HELLO:
             if (doc["d"].is<JsonObject>()) {
-                _heartbeatInterval = doc["d"]["heartbeat_interval"].as<int>();
-                unsigned long now = millis();
-                _lastHeartbeat = now;
-                _lastHeartbeatAck = now;
+                int interval = doc["d"]["heartbeat_interval"].as<int>();
+                _lastHeartbeatAck = millis();
+                _heartbeatUnacked = 0;
                 _heartbeatMissedCount = 0;
 
-                if (_heartbeatInterval > 0) {
-                    _lastHeartbeat = now - _heartbeatInterval;
-                    _debugLog("Scheduling immediate heartbeat after HELLO (interval: " + String(_heartbeatInterval) + "ms)", DEBUG_LEVEL_VERBOSE);
+                if (interval > 0) {
+                    // The first beat is jittered across the interval so
+                    // clients reconnecting together don't beat together
+                    unsigned long jitter = (unsigned long)random(interval);
+                    _heartbeatInterval = interval;
+                    _scheduleHeartbeat(jitter);
+                    _debugLog("Scheduling first heartbeat in " + String(jitter) + "ms (interval: " + String(interval) + "ms)", DEBUG_LEVEL_VERBOSE);
+                    if (!_startHeartbeatTask()) {
+                        _debugLog("Heartbeat task unavailable; heartbeats depend on loop()", DEBUG_LEVEL_WARNING);
+                    }
                 }
 
                 _debugLog("Received HELLO, heartbeat interval: " + String(_heartbeatInterval) + "ms", DEBUG_LEVEL_INFO);
@@ -802,6 +2768,7 @@ void DiscordAPI::_handleWebSocketEvent(JsonDocument& doc) {
             
         case OPCODE_HEARTBEAT_ACK:
             _lastHeartbeatAck = millis();
+            _heartbeatUnacked = 0;
             _heartbeatMissedCount = 0;
             _debugLog("Heartbeat ACK received", DEBUG_LEVEL_VERBOSE);
             break;
@@ -812,47 +2779,61 @@ void DiscordAPI::_handleWebSocketEvent(JsonDocument& doc) {
             break;
             
         case OPCODE_DISPATCH:
-            if (eventType == EVENT_READY) {
-                _debugLog("Received READY event from Discord", DEBUG_LEVEL_INFO);
-                if (doc["d"].is<JsonObject>()) {
-                    _wsAuthenticated = true;
-                    _resumeInProgress = false;
-                    _sessionId = doc["d"]["session_id"].as<String>();
-                    _resumeGatewayUrl = doc["d"]["resume_gateway_url"].as<String>();
-                    _debugLog("Bot ready! Session ID: " + _sessionId, DEBUG_LEVEL_INFO);
-                    _debugLog("Resume Gateway URL: " + _resumeGatewayUrl, DEBUG_LEVEL_VERBOSE);
-                    _debugLog("WebSocket authentication successful!", DEBUG_LEVEL_INFO);
+            switch (eventType) {
+                case DISCORD_EVENT_READY:
+                    _debugLog("Received READY event from Discord", DEBUG_LEVEL_INFO);
+                    if (doc["d"].is<JsonObject>()) {
+                        _wsAuthenticated = true;
+                        _resumeInProgress = false;
+                        _sessionId = doc["d"]["session_id"].as<String>();
+                        _resumeGatewayUrl = doc["d"]["resume_gateway_url"].as<String>();
+                        _debugLog("Bot ready! Session ID: " + _sessionId, DEBUG_LEVEL_INFO);
+                        _debugLog("Resume Gateway URL: " + _resumeGatewayUrl, DEBUG_LEVEL_VERBOSE);
+                        _debugLog("WebSocket authentication successful!", DEBUG_LEVEL_INFO);
                     
-                    // Reset connection state on successful authentication
-                    _lastHeartbeatAck = millis();
-                    _connectionStartTime = millis();
-                    _heartbeatMissedCount = 0;
-                    _reconnectAttempts = 0;
+                        // Reset connection state on successful authentication
+                        _lastHeartbeatAck = millis();
+                        _connectionStartTime = millis();
+                        _heartbeatMissedCount = 0;
+                        _reconnectAttempts = 0;
                     
-                    if (_onReady && doc["d"]["user"].is<JsonObject>()) {
-                        DiscordUser user;
-                        _parseUser(doc["d"]["user"], user);
-                        _onReady(user);
+                        if (_onReady && doc["d"]["user"].is<JsonObject>()) {
+                            DiscordUser user;
+                            _parseUser(doc["d"]["user"], user);
+                            _onReady(user);
+                        }
+                    } else {
+                        _debugLog("Invalid READY message format", DEBUG_LEVEL_ERROR);
+                        // Force disconnect and reconnect on invalid READY
+                        _wsAuthenticated = false;
+                        _disconnectSocket();
                     }
-                } else {
-                    _debugLog("Invalid READY message format", DEBUG_LEVEL_ERROR);
-                    // Force disconnect and reconnect on invalid READY
-                    _wsAuthenticated = false;
-                    _webSocket.disconnect();
-                }
-            } else if (eventType == EVENT_MESSAGE_CREATE) {
-                if (_onMessage && doc["d"].is<JsonObject>()) {
-                    DiscordMessage message;
-                    _parseMessage(doc["d"], message);
-                    _onMessage(message);
-                }
-            } else if (eventType == EVENT_GUILD_CREATE) {
-                if (_onGuildCreate && doc["d"].is<JsonObject>()) {
-                    DiscordGuild guild;
-                    _parseGuild(doc["d"], guild);
-                    _onGuildCreate(guild);
-                }
+                    break;
+
+                case DISCORD_EVENT_RESUMED:
+                    _handleResumed();
+                    break;
+
+                case DISCORD_EVENT_MESSAGE_CREATE:
+                    if (doc["d"].is<JsonObject>()) {
+                        _dispatchMessageCreate(doc["d"]);
+                    }
+                    break;
+
+                case DISCORD_EVENT_GUILD_CREATE:
+                    if (doc["d"].is<JsonObject>()) {
+                        _dispatchGuildCreate(doc["d"]);
+                    }
+                    break;
+
+                default:
+                    break;
             }
+            if (doc["d"].is<JsonObject>()) {
+                _updateCaches(eventType, doc["d"]);
+                _state.apply(eventType, doc["d"]);
+            }
+            _dispatchEvent(eventType, doc["d"]);
             break;
             
         case OPCODE_INVALID_SESSION:
@@ -874,12 +2855,7 @@ void DiscordAPI::_handleWebSocketEvent(JsonDocument& doc) {
             break;
             
         case OPCODE_RESUMED:
-            _debugLog("Connection resumed successfully", DEBUG_LEVEL_INFO);
-            _wsAuthenticated = true;
-            _resumeInProgress = false;
-            _connectionStartTime = millis();
-            _lastHeartbeatAck = millis();
-            _heartbeatMissedCount = 0;
+            _handleResumed();
             break;
             
         default:
@@ -894,37 +2870,220 @@ void DiscordAPI::_handleWebSocketEvent(JsonDocument& doc) {
 
 }
 
+void DiscordAPI::_dispatchMessageCreate(JsonObject messageObj) {
+    if (_onMessageView) {
+        MessageView view(messageObj, this);
+        _onMessageView(view);
+    }
+    if (_onMessage) {
+        _parseMessage(messageObj, _eventMessage);
+        _onMessage(_eventMessage);
+    }
+}
+
+void DiscordAPI::_dispatchGuildCreate(JsonObject guildObj) {
+    if (_onGuildCreateView) {
+        GuildView view(guildObj, this);
+        _onGuildCreateView(view);
+    }
+    if (_onGuildCreate) {
+        _parseGuild(guildObj, _eventGuild);
+        _onGuildCreate(_eventGuild);
+    }
+}
+
+// Keeps cached entities current from the events that carry them. A
+// streamed GUILD_CREATE comes here with its scalar header only; its
+// channels are cached as they are read.
+void DiscordAPI::_updateCaches(DiscordEventType type, JsonObject data) {
+    switch (type) {
+        case DISCORD_EVENT_READY:
+            if (_userCache.enabled() && data["user"].is<JsonObject>()) {
+                DiscordUser user;
+                _parseUser(data["user"], user);
+                _userCache.put(user.id, user);
+            }
+            break;
+
+        case DISCORD_EVENT_USER_UPDATE:
+            if (_userCache.enabled()) {
+                DiscordUser user;
+                _parseUser(data, user);
+                _userCache.put(user.id, user);
+            }
+            break;
+
+        case DISCORD_EVENT_MESSAGE_CREATE:
+            if (_userCache.enabled() && data["author"].is<JsonObject>() && data["webhook_id"].isNull()) {
+                DiscordUser user;
+                _parseUser(data["author"], user);
+                _userCache.put(user.id, user);
+            }
+            break;
+
+        case DISCORD_EVENT_CHANNEL_CREATE:
+        case DISCORD_EVENT_CHANNEL_UPDATE:
+            if (_channelCache.enabled()) {
+                DiscordChannel channel;
+                _parseChannel(data, channel);
+                _channelCache.put(channel.id, channel);
+            }
+            break;
+
+        case DISCORD_EVENT_CHANNEL_DELETE:
+            _channelCache.remove(data["id"].as<Snowflake>());
+            break;
+
+        case DISCORD_EVENT_GUILD_CREATE:
+        case DISCORD_EVENT_GUILD_UPDATE:
+            // An outage announces the guild without its fields
+            if (data["unavailable"].as<bool>()) {
+                break;
+            }
+            if (_guildCache.enabled()) {
+                DiscordGuild guild;
+                _parseGuild(data, guild);
+                _guildCache.put(guild.id, guild);
+            }
+            if (_channelCache.enabled() && data["channels"].is<JsonArray>()) {
+                Snowflake guildId = data["id"].as<Snowflake>();
+                for (JsonObject channelObj : data["channels"].as<JsonArray>()) {
+                    DiscordChannel channel;
+                    _parseChannel(channelObj, channel);
+                    if (!channel.guild_id.isValid()) {
+                        channel.guild_id = guildId;
+                    }
+                    _channelCache.put(channel.id, channel);
+                }
+            }
+            break;
+
+        case DISCORD_EVENT_GUILD_DELETE:
+            _guildCache.remove(data["id"].as<Snowflake>());
+            break;
+
+        default:
+            break;
+    }
+}
+
+void DiscordAPI::_dispatchEvent(DiscordEventType type, JsonObject data) {
+    if (_eventHandlers[type] && !data.isNull()) {
+        _eventHandlers[type](type, data);
+    }
+}
+
+void DiscordAPI::_handleResumed() {
+    _debugLog("Connection resumed successfully", DEBUG_LEVEL_INFO);
+    _wsAuthenticated = true;
+    _resumeInProgress = false;
+    _connectionStartTime = millis();
+    _lastHeartbeatAck = millis();
+    _heartbeatMissedCount = 0;
+}
+
+bool DiscordAPI::_startHeartbeatTask() {
+    if (_heartbeatTask != nullptr) {
+        return true;
+    }
+    _heartbeatWake = xSemaphoreCreateBinary();
+    _heartbeatExit = xSemaphoreCreateBinary();
+    if (_heartbeatWake == nullptr || _heartbeatExit == nullptr ||
+        xTaskCreatePinnedToCore(_heartbeatTaskLoop, "discord_heartbeat", DISCORD_HEARTBEAT_TASK_STACK, this,
+                                DISCORD_HEARTBEAT_TASK_PRIORITY, &_heartbeatTask, DISCORD_HEARTBEAT_TASK_CORE) != pdPASS) {
+        _debugLog("Failed to start heartbeat task", DEBUG_LEVEL_ERROR);
+        if (_heartbeatWake != nullptr) vSemaphoreDelete(_heartbeatWake);
+        if (_heartbeatExit != nullptr) vSemaphoreDelete(_heartbeatExit);
+        _heartbeatWake = nullptr;
+        _heartbeatExit = nullptr;
+        _heartbeatTask = nullptr;
+        return false;
+    }
+    return true;
+}
+
+// Sleeps until the next beat is due, or until HELLO reschedules it. While
+// there is no connection or interval it sleeps until woken.
+void DiscordAPI::_heartbeatTaskLoop(void* param) {
+    DiscordAPI* api = (DiscordAPI*)param;
+
+    while (!api->_heartbeatStop) {
+        TickType_t timeout = portMAX_DELAY;
+        if (api->_wsConnected && api->_heartbeatInterval > 0) {
+            long due = (long)(api->_nextHeartbeat - millis());
+            timeout = due > 0 ? pdMS_TO_TICKS(due) : 0;
+        }
+        if (xSemaphoreTake(api->_heartbeatWake, timeout) == pdTRUE) {
+            continue;
+        }
+        if (api->_wsConnected && api->_heartbeatInterval > 0 && (long)(api->_nextHeartbeat - millis()) <= 0) {
+            api->_sendHeartbeat();
+        }
+    }
+
+    xSemaphoreGive(api->_heartbeatExit);
+    vTaskDelete(nullptr);
+}
+
+void DiscordAPI::_scheduleHeartbeat(unsigned long delayMs) {
+    _nextHeartbeat = millis() + delayMs;
+    if (_heartbeatWake != nullptr) {
+        xSemaphoreGive(_heartbeatWake);
+    }
+}
+
+// Runs on the heartbeat task, and on loop() for heartbeats Discord asks for.
+// It only counts the result; loop() logs it in _logHeartbeats().
 void DiscordAPI::_sendHeartbeat() {
     if (!_wsConnected) {
-        _debugLog("Cannot send heartbeat: WebSocket not connected", DEBUG_LEVEL_WARNING);
+        _heartbeatSendFailures++;
         return;
     }
     
-    JsonDocument doc;
+    int sequence = _sequenceNumber;
+    DiscordPooledDocument lease(_outboundDocuments);
+    JsonDocument& doc = *lease;
     doc["op"] = OPCODE_HEARTBEAT;
-    if(_sequenceNumber >= 0) {
-        doc["d"] = _sequenceNumber;
+    if(sequence >= 0) {
+        doc["d"] = sequence;
     }else{
         doc["d"] = nullptr;
     }
     
-    String message;
-    serializeJson(doc, message);
-    
-    bool sent = _webSocket.sendTXT(message);
-    _lastHeartbeat = millis();
+    bool sent = _sendGatewayPayload(doc, true);
+    unsigned long now = millis();
+    _lastHeartbeat = now;
+    _nextHeartbeat = now + _heartbeatInterval;
     
     if (sent) {
-        _debugLog("Sent heartbeat, sequence: " + String(_sequenceNumber), DEBUG_LEVEL_VERBOSE);
+        _heartbeatUnacked++;
+        _heartbeatSentSequence = sequence;
+        _heartbeatsSent++;
     } else {
-        _debugLog("Failed to send heartbeat", DEBUG_LEVEL_ERROR);
         // Don't immediately disconnect on failed heartbeat, let the stability check handle it
+        _heartbeatSendFailures++;
+    }
+}
+
+void DiscordAPI::_logHeartbeats() {
+    int sent = _heartbeatsSent.exchange(0);
+    int failed = _heartbeatSendFailures.exchange(0);
+    if (sent > 0) {
+        _debugLog("Sent heartbeat, sequence: " + String(_heartbeatSentSequence.load()), DEBUG_LEVEL_VERBOSE);
+    }
+    if (failed > 0) {
+        String message = "Failed to send heartbeat";
+        if (failed > 1) {
+            message += " (" + String(failed) + " times)";
+        }
+        _debugLog(message, DEBUG_LEVEL_ERROR);
     }
 }
 
 void DiscordAPI::_identify() {
     _resumeInProgress = false;
-    JsonDocument doc;
+    DiscordPooledDocument lease(_outboundDocuments);
+    JsonDocument& doc = *lease;
     doc["op"] = OPCODE_IDENTIFY;
     
     JsonObject d = doc["d"].to<JsonObject>();
@@ -941,21 +3100,21 @@ void DiscordAPI::_identify() {
     // Add intents - configurable via setGatewayIntents()
     d["intents"] = _gatewayIntents;
 
-    String message = "";
-    serializeJson(doc, message);
-
-    bool sent = _webSocket.sendTXT(message);
+    bool sent = _sendGatewayPayload(doc);
 
     // Debug: Log the identify packet (without token for security)
-    String debugMessage = message;
-    int tokenStart = debugMessage.indexOf("\"token\":\"");
-    if (tokenStart != -1) {
-        int tokenEnd = debugMessage.indexOf("\"", tokenStart + 9);
-        if (tokenEnd != -1) {
-            debugMessage = debugMessage.substring(0, tokenStart + 9) + "***HIDDEN***" + debugMessage.substring(tokenEnd);
+    if (_onDebug) {
+        String debugMessage;
+        serializeJson(doc, debugMessage);
+        int tokenStart = debugMessage.indexOf("\"token\":\"");
+        if (tokenStart != -1) {
+            int tokenEnd = debugMessage.indexOf("\"", tokenStart + 9);
+            if (tokenEnd != -1) {
+                debugMessage = debugMessage.substring(0, tokenStart + 9) + "***HIDDEN***" + debugMessage.substring(tokenEnd);
+            }
         }
+        _debugLog("Sending IDENTIFY packet: " + debugMessage, DEBUG_LEVEL_INFO);
     }
-    _debugLog("Sending IDENTIFY packet: " + debugMessage, DEBUG_LEVEL_INFO);
     
     if (sent) {
         _debugLog("IDENTIFY packet sent successfully", DEBUG_LEVEL_INFO);
@@ -987,44 +3146,55 @@ void DiscordAPI::_resume() {
     _debugLog("Attempting to resume session: " + _sessionId, DEBUG_LEVEL_INFO);
     _resumeInProgress = true;
     
-    JsonDocument doc;
+    DiscordPooledDocument lease(_outboundDocuments);
+    JsonDocument& doc = *lease;
     doc["op"] = OPCODE_RESUME;
     
     JsonObject d = doc["d"].to<JsonObject>();
     d["token"] = _botToken;
     d["session_id"] = _sessionId;
-    d["seq"] = _sequenceNumber;
+    d["seq"] = _sequenceNumber.load();
     
-    String message;
-    serializeJson(doc, message);
-    _webSocket.sendTXT(message);
+    _sendGatewayPayload(doc);
     _debugLog("Sent RESUME packet, session: " + _sessionId, DEBUG_LEVEL_INFO);
 }
 
 // Parsing methods
+// Copies a string member into `dst`, reusing its buffer when it is large
+// enough. Non-string values keep the as<String>() text ("null", numbers).
+static void copyJsonString(String& dst, JsonVariantConst src) {
+    dst = "";
+    JsonString str = src.as<JsonString>();
+    if (!str.isNull()) {
+        dst.concat(str.c_str(), str.size());
+    } else {
+        serializeJson(src, dst);
+    }
+}
+
 void DiscordAPI::_parseUser(JsonObject userObj, DiscordUser& user) {
     if (userObj.isNull()) {
         _debugLog("Invalid user object", DEBUG_LEVEL_ERROR);
         return;
     }
     
-    user.id = userObj["id"].as<String>();
-    user.username = userObj["username"].as<String>();
-    user.discriminator = userObj["discriminator"].as<String>();
-    user.global_name = userObj["global_name"].as<String>();
-    user.avatar = userObj["avatar"].as<String>();
+    user.id = userObj["id"].as<Snowflake>();
+    copyJsonString(user.username, userObj["username"]);
+    copyJsonString(user.discriminator, userObj["discriminator"]);
+    copyJsonString(user.global_name, userObj["global_name"]);
+    copyJsonString(user.avatar, userObj["avatar"]);
     user.bot = userObj["bot"].as<bool>();
     user.system = userObj["system"].as<bool>();
     user.mfa_enabled = userObj["mfa_enabled"].as<bool>();
-    user.banner = userObj["banner"].as<String>();
+    copyJsonString(user.banner, userObj["banner"]);
     user.accent_color = userObj["accent_color"].as<int>();
-    user.locale = userObj["locale"].as<String>();
+    copyJsonString(user.locale, userObj["locale"]);
     user.verified = userObj["verified"].as<bool>();
-    user.email = userObj["email"].as<String>();
+    copyJsonString(user.email, userObj["email"]);
     user.flags = userObj["flags"].as<int>();
     user.premium_type = userObj["premium_type"].as<int>();
     user.public_flags = userObj["public_flags"].as<int>();
-    user.avatar_decoration = userObj["avatar_decoration"].as<String>();
+    copyJsonString(user.avatar_decoration, userObj["avatar_decoration"]);
 }
 
 void DiscordAPI::_parseMessage(JsonObject messageObj, DiscordMessage& message) {
@@ -1033,21 +3203,21 @@ void DiscordAPI::_parseMessage(JsonObject messageObj, DiscordMessage& message) {
         return;
     }
     
-    message.id = messageObj["id"].as<String>();
-    message.channel_id = messageObj["channel_id"].as<String>();
-    message.guild_id = messageObj["guild_id"].as<String>();
-    message.content = messageObj["content"].as<String>();
-    message.timestamp = messageObj["timestamp"].as<String>();
-    message.edited_timestamp = messageObj["edited_timestamp"].as<String>();
+    message.id = messageObj["id"].as<Snowflake>();
+    message.channel_id = messageObj["channel_id"].as<Snowflake>();
+    message.guild_id = messageObj["guild_id"].as<Snowflake>();
+    copyJsonString(message.content, messageObj["content"]);
+    copyJsonString(message.timestamp, messageObj["timestamp"]);
+    copyJsonString(message.edited_timestamp, messageObj["edited_timestamp"]);
     message.tts = messageObj["tts"].as<bool>();
     message.mention_everyone = messageObj["mention_everyone"].as<bool>();
-    message.nonce = messageObj["nonce"].as<String>();
+    copyJsonString(message.nonce, messageObj["nonce"]);
     message.pinned = messageObj["pinned"].as<bool>();
-    message.webhook_id = messageObj["webhook_id"].as<String>();
-    message.type = messageObj["type"].as<int>();
-    message.application_id = messageObj["application_id"].as<String>();
-    message.flags = messageObj["flags"].as<int>();
-    message.position = messageObj["position"].as<int>();
+    message.webhook_id = messageObj["webhook_id"].as<Snowflake>();
+    message.type = messageObj["type"].as<uint8_t>();
+    message.application_id = messageObj["application_id"].as<Snowflake>();
+    message.flags = messageObj["flags"].as<int32_t>();
+    message.position = messageObj["position"].as<int32_t>();
     
     // Parse author
     if (messageObj["author"].is<JsonObject>()) {
@@ -1055,19 +3225,38 @@ void DiscordAPI::_parseMessage(JsonObject messageObj, DiscordMessage& message) {
     }
     
     // Parse mentions
-    if (messageObj["mentions"].is<JsonArray>()) {
-        JsonArray mentions = messageObj["mentions"];
-        message.mentions_count = mentions.size();
-        if (message.mentions_count > 0) {
-            message.mentions = new (std::nothrow) String[message.mentions_count];
-            if (message.mentions != nullptr) {
-                for (int i = 0; i < message.mentions_count; i++) {
-                    message.mentions[i] = mentions[i]["id"].as<String>();
-                }
-            } else {
-                _debugLog("Failed to allocate memory for mentions", DEBUG_LEVEL_ERROR);
-                message.mentions_count = 0;
-            }
+    message.mentions.clear();
+    JsonArray mentions = messageObj["mentions"];
+    if (!message.mentions.reserve(mentions.size())) {
+        _debugLog("Failed to allocate memory for mentions", DEBUG_LEVEL_ERROR);
+    } else {
+        for (JsonVariant mention : mentions) {
+            message.mentions.push_back(mention["id"].as<Snowflake>());
+        }
+    }
+
+    message.mention_roles.clear();
+    JsonArray mentionRoles = messageObj["mention_roles"];
+    if (!message.mention_roles.reserve(mentionRoles.size())) {
+        _debugLog("Failed to allocate memory for mention roles", DEBUG_LEVEL_ERROR);
+    } else {
+        for (JsonVariant role : mentionRoles) {
+            message.mention_roles.push_back(role.as<Snowflake>());
+        }
+    }
+
+    // Optional fields are only stored when present and non-empty
+    message.extras.clear();
+    for (int i = 0; i < DISCORD_MESSAGE_FIELD_COUNT; i++) {
+        DiscordMessageField field = (DiscordMessageField)i;
+        JsonVariant value = messageObj[DiscordMessageExtras::key(field)];
+        if (value.isNull() || (value.is<JsonArray>() && value.size() == 0)) {
+            continue;
+        }
+        String json;
+        serializeJson(value, json);
+        if (!message.extras.set(field, json)) {
+            _debugLog("Failed to allocate memory for message field " + String(DiscordMessageExtras::key(field)), DEBUG_LEVEL_ERROR);
         }
     }
 }
@@ -1078,37 +3267,56 @@ void DiscordAPI::_parseChannel(JsonObject channelObj, DiscordChannel& channel) {
         return;
     }
     
-    channel.id = channelObj["id"].as<String>();
+    channel.id = channelObj["id"].as<Snowflake>();
     channel.type = channelObj["type"].as<int>();
-    channel.guild_id = channelObj["guild_id"].as<String>();
+    channel.guild_id = channelObj["guild_id"].as<Snowflake>();
     channel.position = channelObj["position"].as<int>();
-    channel.name = channelObj["name"].as<String>();
-    channel.topic = channelObj["topic"].as<String>();
+    copyJsonString(channel.name, channelObj["name"]);
+    copyJsonString(channel.topic, channelObj["topic"]);
     channel.nsfw = channelObj["nsfw"].as<bool>();
-    channel.last_message_id = channelObj["last_message_id"].as<String>();
+    channel.last_message_id = channelObj["last_message_id"].as<Snowflake>();
     channel.bitrate = channelObj["bitrate"].as<int>();
     channel.user_limit = channelObj["user_limit"].as<int>();
     channel.rate_limit_per_user = channelObj["rate_limit_per_user"].as<int>();
-    channel.icon = channelObj["icon"].as<String>();
-    channel.owner_id = channelObj["owner_id"].as<String>();
-    channel.application_id = channelObj["application_id"].as<String>();
-    channel.parent_id = channelObj["parent_id"].as<String>();
-    channel.last_pin_timestamp = channelObj["last_pin_timestamp"].as<String>();
-    channel.rtc_region = channelObj["rtc_region"].as<String>();
+    copyJsonString(channel.icon, channelObj["icon"]);
+    channel.owner_id = channelObj["owner_id"].as<Snowflake>();
+    channel.application_id = channelObj["application_id"].as<Snowflake>();
+    channel.parent_id = channelObj["parent_id"].as<Snowflake>();
+    copyJsonString(channel.last_pin_timestamp, channelObj["last_pin_timestamp"]);
+    copyJsonString(channel.rtc_region, channelObj["rtc_region"]);
     channel.video_quality_mode = channelObj["video_quality_mode"].as<int>();
     channel.message_count = channelObj["message_count"].as<int>();
     channel.member_count = channelObj["member_count"].as<int>();
-    channel.permissions = channelObj["permissions"].as<String>();
+    copyJsonString(channel.permissions, channelObj["permissions"]);
     channel.flags = channelObj["flags"].as<int>();
     channel.default_auto_archive_duration = channelObj["default_auto_archive_duration"].as<int>();
     channel.default_thread_rate_limit_per_user = channelObj["default_thread_rate_limit_per_user"].as<int>();
 }
 
 // Helper function to call debug callback
+// Lines logged on the REST worker are handed to loop() instead, so
+// onDebug is only ever called on the user's task
 void DiscordAPI::_debugLog(String message, int level) {
-    if (_onDebug) {
-        _onDebug(message, level);
+    if (!_onDebug) {
+        return;
+    }
+    if (_restTask != nullptr && xTaskGetCurrentTaskHandle() == _restTask) {
+        _queueRestLog(message, level);
+        return;
+    }
+    _onDebug(message, level);
+}
+
+// Literal messages only become Strings when someone is listening
+void DiscordAPI::_debugLog(const char* message, int level) {
+    if (!_onDebug) {
+        return;
+    }
+    if (_restTask != nullptr && xTaskGetCurrentTaskHandle() == _restTask) {
+        _queueRestLog(String(message), level);
+        return;
     }
+    _onDebug(String(message), level);
 }
 
 bool DiscordAPI::_shouldReconnect() {
@@ -1141,7 +3349,7 @@ void DiscordAPI::_handleReconnect() {
     
     // Disconnect first if connected
     if (_wsConnected) {
-        _webSocket.disconnect();
+        _disconnectSocket();
         _wsConnected = false;
         _wsAuthenticated = false;
     }
@@ -1172,11 +3380,15 @@ bool DiscordAPI::_checkConnectionStability() {
     
     unsigned long currentTime = millis();
     
-    // Only check heartbeat if we have a valid interval
-    if (_heartbeatInterval > 0) {
-        // Check if we haven't received heartbeat ACK for too long (5x interval for more tolerance)
-        if (currentTime - _lastHeartbeatAck > _heartbeatInterval * 5) {
-            _heartbeatMissedCount++;
+    // Only check heartbeat if we have a valid interval, and only once
+    // loop() has been reading the socket long enough to have seen any ACKs
+    // that arrived while it was busy
+    if (_heartbeatInterval > 0 && currentTime - _pollingSince >= DISCORD_HEARTBEAT_ACK_GRACE) {
+        // A beat is missed when the next one goes out before its ACK came;
+        // the latest beat's ACK may still be on its way
+        int unacked = _heartbeatUnacked;
+        _heartbeatMissedCount = unacked > 1 ? unacked - 1 : 0;
+        if (_heartbeatMissedCount > 0) {
             _debugLog("Heartbeat ACK missed, count: " + String(_heartbeatMissedCount) + "/" + String(_maxHeartbeatMissed), DEBUG_LEVEL_WARNING);
             
             if (_heartbeatMissedCount >= _maxHeartbeatMissed) {
@@ -1199,7 +3411,7 @@ void DiscordAPI::_handleConnectionTimeout() {
     _resumeInProgress = false;
     
     if (_wsConnected) {
-        _webSocket.disconnect();
+        _disconnectSocket();
         _wsConnected = false;
         _wsAuthenticated = false;
     }
@@ -1259,42 +3471,42 @@ void DiscordAPI::_parseGuild(JsonObject guildObj, DiscordGuild& guild) {
         return;
     }
     
-    guild.id = guildObj["id"].as<String>();
-    guild.name = guildObj["name"].as<String>();
-    guild.icon = guildObj["icon"].as<String>();
-    guild.icon_hash = guildObj["icon_hash"].as<String>();
-    guild.splash = guildObj["splash"].as<String>();
-    guild.discovery_splash = guildObj["discovery_splash"].as<String>();
+    guild.id = guildObj["id"].as<Snowflake>();
+    copyJsonString(guild.name, guildObj["name"]);
+    copyJsonString(guild.icon, guildObj["icon"]);
+    copyJsonString(guild.icon_hash, guildObj["icon_hash"]);
+    copyJsonString(guild.splash, guildObj["splash"]);
+    copyJsonString(guild.discovery_splash, guildObj["discovery_splash"]);
     guild.owner = guildObj["owner"].as<bool>();
-    guild.owner_id = guildObj["owner_id"].as<String>();
-    guild.permissions = guildObj["permissions"].as<String>();
-    guild.region = guildObj["region"].as<String>();
-    guild.afk_channel_id = guildObj["afk_channel_id"].as<String>();
+    guild.owner_id = guildObj["owner_id"].as<Snowflake>();
+    copyJsonString(guild.permissions, guildObj["permissions"]);
+    copyJsonString(guild.region, guildObj["region"]);
+    guild.afk_channel_id = guildObj["afk_channel_id"].as<Snowflake>();
     guild.afk_timeout = guildObj["afk_timeout"].as<int>();
     guild.widget_enabled = guildObj["widget_enabled"].as<bool>();
-    guild.widget_channel_id = guildObj["widget_channel_id"].as<String>();
+    guild.widget_channel_id = guildObj["widget_channel_id"].as<Snowflake>();
     guild.verification_level = guildObj["verification_level"].as<int>();
     guild.default_message_notifications = guildObj["default_message_notifications"].as<int>();
     guild.explicit_content_filter = guildObj["explicit_content_filter"].as<int>();
     guild.mfa_level = guildObj["mfa_level"].as<int>();
-    guild.application_id = guildObj["application_id"].as<String>();
-    guild.system_channel_id = guildObj["system_channel_id"].as<String>();
+    guild.application_id = guildObj["application_id"].as<Snowflake>();
+    guild.system_channel_id = guildObj["system_channel_id"].as<Snowflake>();
     guild.system_channel_flags = guildObj["system_channel_flags"].as<int>();
-    guild.rules_channel_id = guildObj["rules_channel_id"].as<String>();
+    guild.rules_channel_id = guildObj["rules_channel_id"].as<Snowflake>();
     guild.max_presences = guildObj["max_presences"].as<int>();
     guild.max_members = guildObj["max_members"].as<int>();
-    guild.vanity_url_code = guildObj["vanity_url_code"].as<String>();
-    guild.description = guildObj["description"].as<String>();
-    guild.banner = guildObj["banner"].as<String>();
+    copyJsonString(guild.vanity_url_code, guildObj["vanity_url_code"]);
+    copyJsonString(guild.description, guildObj["description"]);
+    copyJsonString(guild.banner, guildObj["banner"]);
     guild.premium_tier = guildObj["premium_tier"].as<int>();
     guild.premium_subscription_count = guildObj["premium_subscription_count"].as<int>();
-    guild.preferred_locale = guildObj["preferred_locale"].as<String>();
-    guild.public_updates_channel_id = guildObj["public_updates_channel_id"].as<String>();
+    copyJsonString(guild.preferred_locale, guildObj["preferred_locale"]);
+    guild.public_updates_channel_id = guildObj["public_updates_channel_id"].as<Snowflake>();
     guild.max_video_channel_users = guildObj["max_video_channel_users"].as<int>();
     guild.max_stage_video_channel_users = guildObj["max_stage_video_channel_users"].as<int>();
     guild.nsfw_level = guildObj["nsfw_level"].as<int>();
     guild.premium_progress_bar_enabled = guildObj["premium_progress_bar_enabled"].as<bool>();
-    guild.safety_alerts_channel_id = guildObj["safety_alerts_channel_id"].as<String>();
+    guild.safety_alerts_channel_id = guildObj["safety_alerts_channel_id"].as<Snowflake>();
 }
 
 // Utility methods
@@ -1306,23 +3518,23 @@ String DiscordAPI::getBotInviteURL(String permissions) {
            "&permissions=" + permissions + "&scope=bot";
 }
 
-String DiscordAPI::formatUserMention(String userId) {
-    return "<@" + userId + ">";
+String DiscordAPI::formatUserMention(Snowflake userId) {
+    return "<@" + userId.toString() + ">";
 }
 
-String DiscordAPI::formatChannelMention(String channelId) {
-    return "<#" + channelId + ">";
+String DiscordAPI::formatChannelMention(Snowflake channelId) {
+    return "<#" + channelId.toString() + ">";
 }
 
-String DiscordAPI::formatRoleMention(String roleId) {
-    return "<@&" + roleId + ">";
+String DiscordAPI::formatRoleMention(Snowflake roleId) {
+    return "<@&" + roleId.toString() + ">";
 }
 
-String DiscordAPI::formatEmoji(String name, String id, bool animated) {
+String DiscordAPI::formatEmoji(String name, Snowflake id, bool animated) {
     if (animated) {
-        return "<a:" + name + ":" + id + ">";
+        return "<a:" + name + ":" + id.toString() + ">";
     }
-    return "<:" + name + ":" + id + ">";
+    return "<:" + name + ":" + id.toString() + ">";
 }
 
 String DiscordAPI::formatTimestamp(String timestamp, String style) {
@@ -1367,20 +3579,39 @@ String DiscordAPI::formatBlockQuote(String text) {
 
 // Rate limiting
 bool DiscordAPI::isRateLimited() {
-    if (_rateLimitReset > 0 && millis() < _rateLimitReset) {
+    unsigned long now = millis();
+    if (_rateLimitReset != 0 && (long)(_rateLimitReset - now) > 0) {
         return true;
     }
-    return false;
+    return _globalRateLimit > 0 && getRemainingRequests() == 0;
 }
 
 int DiscordAPI::getRemainingRequests() {
-    return DISCORD_RATE_LIMIT - _requestCount;
+    if (_globalRateLimit <= 0) {
+        return DISCORD_RATE_LIMIT;
+    }
+    if (millis() - _lastRequestTime >= 1000) {
+        return _globalRateLimit;
+    }
+    return _requestCount >= _globalRateLimit ? 0 : _globalRateLimit - _requestCount;
 }
 
 unsigned long DiscordAPI::getRateLimitReset() {
     return _rateLimitReset;
 }
 
+void DiscordAPI::setGlobalRateLimit(int requestsPerSecond) {
+    _globalRateLimit = requestsPerSecond;
+}
+
+void DiscordAPI::setRateLimitRetry(bool blockingCalls) {
+    _blockingRateLimitRetry = blockingCalls;
+}
+
+void DiscordAPI::setRateLimitRetryDeadline(unsigned long timeoutMs) {
+    _rateLimitRetryDeadline = timeoutMs;
+}
+
 // Error handling
 String DiscordAPI::getLastError() {
     return "";
@@ -0,0 +1,224 @@
+#include "DiscordAllocator.h"
+#include <atomic>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef DISCORD_NATIVE
+#include <esp_heap_caps.h>
+#endif
+
+// Every block is preceded by its size and region; 8 bytes keep the payload
+// aligned like malloc()'s
+#define ALLOCATOR_HEADER_SIZE 8
+#define REGION_INTERNAL 0
+#define REGION_PSRAM 1
+
+struct BlockHeader
+{
+    uint32_t size;
+    uint32_t region;
+};
+
+// Counters are updated from whichever task allocates
+struct RegionCounters
+{
+    std::atomic<size_t> used;
+    std::atomic<size_t> peak;
+    std::atomic<uint32_t> allocations;
+};
+
+static RegionCounters regionCounters[2];
+static std::atomic<uint32_t> psramFallbacks(0);
+static std::atomic<uint32_t> allocationFailures(0);
+static std::atomic<size_t> psramThreshold(DISCORD_PSRAM_THRESHOLD);
+
+static bool psramAvailable() {
+#ifdef DISCORD_NATIVE
+    return true;
+#else
+    static const bool available = heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0;
+    return available;
+#endif
+}
+
+static void* regionAllocate(size_t size, int region) {
+#ifdef DISCORD_NATIVE
+    (void)region;
+    return malloc(size);
+#else
+    return heap_caps_malloc(size, region == REGION_PSRAM ? (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+                                                         : (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+#endif
+}
+
+static void* regionReallocate(void* block, size_t size, int region) {
+#ifdef DISCORD_NATIVE
+    (void)region;
+    return realloc(block, size);
+#else
+    return heap_caps_realloc(block, size, region == REGION_PSRAM ? (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+                                                                 : (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+#endif
+}
+
+static void regionFree(void* block) {
+#ifdef DISCORD_NATIVE
+    free(block);
+#else
+    heap_caps_free(block);
+#endif
+}
+
+static void countAllocation(int region, size_t size) {
+    RegionCounters& counters = regionCounters[region];
+    size_t used = counters.used.fetch_add(size) + size;
+    size_t peak = counters.peak.load();
+    while (used > peak && !counters.peak.compare_exchange_weak(peak, used)) {
+    }
+    counters.allocations++;
+}
+
+static void countRelease(int region, size_t size) {
+    regionCounters[region].used.fetch_sub(size);
+    regionCounters[region].allocations--;
+}
+
+static int preferredRegion(size_t size, uint8_t placement) {
+    if (placement == DISCORD_MEMORY_PSRAM || (placement == DISCORD_MEMORY_AUTO && size >= psramThreshold.load())) {
+        return REGION_PSRAM;
+    }
+    return REGION_INTERNAL;
+}
+
+static BlockHeader* headerOf(void* ptr) {
+    return (BlockHeader*)((uint8_t*)ptr - ALLOCATOR_HEADER_SIZE);
+}
+
+void* discordMalloc(size_t size, uint8_t placement) {
+    if (size > UINT32_MAX - ALLOCATOR_HEADER_SIZE) {
+        allocationFailures++;
+        return nullptr;
+    }
+
+    int region = preferredRegion(size, placement);
+    void* block = nullptr;
+    if (region == REGION_PSRAM) {
+        if (psramAvailable()) {
+            block = regionAllocate(size + ALLOCATOR_HEADER_SIZE, REGION_PSRAM);
+        }
+        if (block == nullptr) {
+            psramFallbacks++;
+            region = REGION_INTERNAL;
+        }
+    }
+    if (block == nullptr) {
+        block = regionAllocate(size + ALLOCATOR_HEADER_SIZE, REGION_INTERNAL);
+    }
+    // A full internal heap is better served from PSRAM than not at all
+    if (block == nullptr && region == REGION_INTERNAL && placement != DISCORD_MEMORY_INTERNAL && psramAvailable()) {
+        block = regionAllocate(size + ALLOCATOR_HEADER_SIZE, REGION_PSRAM);
+        region = REGION_PSRAM;
+    }
+    if (block == nullptr) {
+        allocationFailures++;
+        return nullptr;
+    }
+
+    BlockHeader* header = (BlockHeader*)block;
+    header->size = (uint32_t)size;
+    header->region = region;
+    countAllocation(region, size);
+    return (uint8_t*)block + ALLOCATOR_HEADER_SIZE;
+}
+
+void* discordRealloc(void* ptr, size_t size, uint8_t placement) {
+    if (ptr == nullptr) {
+        return discordMalloc(size, placement);
+    }
+    if (size == 0) {
+        discordFree(ptr);
+        return nullptr;
+    }
+    if (size > UINT32_MAX - ALLOCATOR_HEADER_SIZE) {
+        allocationFailures++;
+        return nullptr;
+    }
+
+    BlockHeader* header = headerOf(ptr);
+    int region = header->region;
+    size_t oldSize = header->size;
+    int wanted = preferredRegion(size, placement);
+    if (wanted == REGION_PSRAM && !psramAvailable()) {
+        wanted = REGION_INTERNAL;
+    }
+
+    // Resized in place while it stays in its region, moved when it crosses
+    // the threshold
+    if (wanted == region) {
+        void* block = regionReallocate(header, size + ALLOCATOR_HEADER_SIZE, region);
+        if (block != nullptr) {
+            header = (BlockHeader*)block;
+            header->size = (uint32_t)size;
+            countRelease(region, oldSize);
+            countAllocation(region, size);
+            return (uint8_t*)block + ALLOCATOR_HEADER_SIZE;
+        }
+    }
+
+    void* moved = discordMalloc(size, placement);
+    if (moved == nullptr) {
+        return nullptr;
+    }
+    memcpy(moved, ptr, oldSize < size ? oldSize : size);
+    discordFree(ptr);
+    return moved;
+}
+
+void discordFree(void* ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    BlockHeader* header = headerOf(ptr);
+    countRelease(header->region, header->size);
+    regionFree(header);
+}
+
+void discordSetPsramThreshold(size_t threshold) {
+    psramThreshold = threshold;
+}
+
+size_t discordPsramThreshold() {
+    return psramThreshold.load();
+}
+
+DiscordMemoryStats discordMemoryStats() {
+    DiscordMemoryStats stats;
+    DiscordMemoryRegionStats* regions[2] = {&stats.internal, &stats.psram};
+    for (int i = 0; i < 2; i++) {
+        regions[i]->used = regionCounters[i].used.load();
+        regions[i]->peak = regionCounters[i].peak.load();
+        regions[i]->allocations = regionCounters[i].allocations.load();
+    }
+    stats.psramFallbacks = psramFallbacks.load();
+    stats.failures = allocationFailures.load();
+    stats.threshold = psramThreshold.load();
+    stats.psramAvailable = psramAvailable();
+    return stats;
+}
+
+void* DiscordAllocator::allocate(size_t size) {
+    return discordMalloc(size);
+}
+
+void DiscordAllocator::deallocate(void* ptr) {
+    discordFree(ptr);
+}
+
+void* DiscordAllocator::reallocate(void* ptr, size_t newSize) {
+    return discordRealloc(ptr, newSize);
+}
+
+DiscordAllocator* DiscordAllocator::instance() {
+    static DiscordAllocator allocator;
+    return &allocator;
+}
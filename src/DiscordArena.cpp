@@ -0,0 +1,132 @@
+#include "DiscordArena.h"
+
+// Every block is preceded by a header holding its size, which keeps the
+// payload 8-byte aligned and lets reallocate() copy the right amount
+#define ARENA_ALIGNMENT 8
+#define ARENA_HEADER_SIZE 8
+#define ARENA_NO_BLOCK ((size_t)-1)
+
+static size_t alignUp(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+DiscordArena::DiscordArena(size_t capacity, uint8_t placement) {
+    _buffer = nullptr;
+    _capacity = alignUp(capacity);
+    _used = 0;
+    _last = ARENA_NO_BLOCK;
+    _highWater = 0;
+    _overflows = 0;
+    _placement = placement;
+}
+
+DiscordArena::~DiscordArena() {
+    discordFree(_buffer);
+}
+
+bool DiscordArena::_owns(void* ptr) const {
+    return _buffer != nullptr && (uint8_t*)ptr >= _buffer && (uint8_t*)ptr < _buffer + _capacity;
+}
+
+size_t& DiscordArena::_sizeOf(void* ptr) const {
+    return *(size_t*)((uint8_t*)ptr - ARENA_HEADER_SIZE);
+}
+
+// Overflows are the large documents (GUILD_CREATE and the like), so they
+// follow the PSRAM policy
+void* DiscordArena::_heapAllocate(size_t size) {
+    _overflows++;
+    return discordMalloc(size);
+}
+
+void* DiscordArena::allocate(size_t size) {
+    if (_buffer == nullptr && _capacity > 0) {
+        _buffer = (uint8_t*)discordMalloc(_capacity, _placement);
+        if (_buffer == nullptr) {
+            _capacity = 0;
+        }
+    }
+
+    size_t needed = ARENA_HEADER_SIZE + alignUp(size);
+    if (_buffer == nullptr || needed > _capacity - _used) {
+        return _heapAllocate(size);
+    }
+
+    _last = _used;
+    _used += needed;
+    if (_used > _highWater) {
+        _highWater = _used;
+    }
+    void* ptr = _buffer + _last + ARENA_HEADER_SIZE;
+    _sizeOf(ptr) = size;
+    return ptr;
+}
+
+void DiscordArena::deallocate(void* ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    if (!_owns(ptr)) {
+        discordFree(ptr);
+        return;
+    }
+    // Only the newest block can be handed back; the rest waits for reset()
+    if (_last != ARENA_NO_BLOCK && (uint8_t*)ptr == _buffer + _last + ARENA_HEADER_SIZE) {
+        _used = _last;
+        _last = ARENA_NO_BLOCK;
+    }
+}
+
+void* DiscordArena::reallocate(void* ptr, size_t newSize) {
+    if (ptr == nullptr) {
+        return allocate(newSize);
+    }
+    if (!_owns(ptr)) {
+        return discordRealloc(ptr, newSize);
+    }
+
+    size_t& size = _sizeOf(ptr);
+    bool isLast = _last != ARENA_NO_BLOCK && (uint8_t*)ptr == _buffer + _last + ARENA_HEADER_SIZE;
+    if (isLast && ARENA_HEADER_SIZE + alignUp(newSize) <= _capacity - _last) {
+        // Grow or shrink the newest block in place
+        _used = _last + ARENA_HEADER_SIZE + alignUp(newSize);
+        if (_used > _highWater) {
+            _highWater = _used;
+        }
+        size = newSize;
+        return ptr;
+    }
+    if (newSize <= size) {
+        size = newSize;
+        return ptr;
+    }
+
+    void* moved = allocate(newSize);
+    if (moved != nullptr) {
+        memcpy(moved, ptr, size);
+    }
+    return moved;
+}
+
+void DiscordArena::reset() {
+    _used = 0;
+    _last = ARENA_NO_BLOCK;
+}
+
+void DiscordArena::resize(size_t capacity) {
+    discordFree(_buffer);
+    _buffer = nullptr;
+    _capacity = alignUp(capacity);
+    _used = 0;
+    _last = ARENA_NO_BLOCK;
+    _highWater = 0;
+}
+
+DiscordArenaStats DiscordArena::stats() const {
+    DiscordArenaStats stats;
+    stats.capacity = _capacity;
+    stats.used = _used;
+    stats.highWater = _highWater;
+    stats.overflows = _overflows;
+    return stats;
+}
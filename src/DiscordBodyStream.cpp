@@ -0,0 +1,144 @@
+#include "DiscordBodyStream.h"
+
+// Longest chunk size line accepted, extensions included
+#define BODY_STREAM_MAX_CHUNK_LINE 64
+
+DiscordBodyStream::DiscordBodyStream(Stream& source, int contentLength, bool chunked) {
+    _source = &source;
+    _chunked = chunked;
+    _chunkStarted = false;
+    _remaining = chunked ? 0 : contentLength;
+    _finished = !chunked && contentLength == 0;
+    _error = false;
+}
+
+// Framing bytes are waited for (up to the source's timeout) rather than
+// reported as missing, since the parser only sees body bytes
+int DiscordBodyStream::_framingByte() {
+    char c;
+    return _source->readBytes(&c, 1) == 1 ? (uint8_t)c : -1;
+}
+
+// Reads the CRLF closing the previous chunk and the next "<hex size>[;ext]"
+// line. A zero size is the last chunk: its trailer is skipped and the body
+// ends.
+bool DiscordBodyStream::_nextChunk() {
+    if (_chunkStarted && (_framingByte() != '\r' || _framingByte() != '\n')) {
+        _error = true;
+        return false;
+    }
+    _chunkStarted = true;
+
+    long size = 0;
+    int digits = 0;
+    int lineLength = 0;
+    bool extension = false;
+    int c;
+    while ((c = _framingByte()) != '\n') {
+        if (c < 0 || ++lineLength > BODY_STREAM_MAX_CHUNK_LINE) {
+            _error = true;
+            return false;
+        }
+        if (extension || c == '\r') {
+            continue;
+        }
+        if (c == ';') {
+            extension = true;
+            continue;
+        }
+        int value = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (value < 0 || ++digits > 7) {
+            _error = true;
+            return false;
+        }
+        size = size * 16 + value;
+    }
+    if (digits == 0) {
+        _error = true;
+        return false;
+    }
+
+    if (size == 0) {
+        // Trailer fields, then an empty line
+        lineLength = 0;
+        while ((c = _framingByte()) >= 0) {
+            if (c == '\n') {
+                if (lineLength == 0) {
+                    return false;
+                }
+                lineLength = 0;
+            } else if (c != '\r') {
+                lineLength++;
+            }
+        }
+        _error = true;
+        return false;
+    }
+    _remaining = size;
+    return true;
+}
+
+// True while there are body bytes left to read
+bool DiscordBodyStream::_ensure() {
+    if (_finished) {
+        return false;
+    }
+    if (_remaining == 0 && (!_chunked || !_nextChunk())) {
+        _finished = true;
+        return false;
+    }
+    return true;
+}
+
+int DiscordBodyStream::available() {
+    if (!_ensure()) {
+        return 0;
+    }
+    int available = _source->available();
+    return _remaining >= 0 && available > _remaining ? (int)_remaining : available;
+}
+
+int DiscordBodyStream::read() {
+    if (!_ensure()) {
+        return -1;
+    }
+    int c = _source->read();
+    if (c >= 0 && _remaining > 0) {
+        _remaining--;
+    }
+    return c;
+}
+
+int DiscordBodyStream::peek() {
+    return _ensure() ? _source->peek() : -1;
+}
+
+size_t DiscordBodyStream::readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length && _ensure()) {
+        size_t wanted = length - count;
+        if (_remaining >= 0 && wanted > (size_t)_remaining) {
+            wanted = _remaining;
+        }
+        size_t received = _source->readBytes(buffer + count, wanted);
+        if (received == 0) {
+            // Without a length the body ends when the server closes the
+            // connection; otherwise the server stopped sending mid-body
+            _error = _remaining >= 0;
+            _finished = true;
+            break;
+        }
+        count += received;
+        if (_remaining > 0) {
+            _remaining -= received;
+        }
+    }
+    return count;
+}
+
+bool DiscordBodyStream::drain() {
+    char scratch[64];
+    while (readBytes(scratch, sizeof(scratch)) > 0) {
+    }
+    return _finished && !_error;
+}
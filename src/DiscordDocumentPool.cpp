@@ -0,0 +1,116 @@
+#include "DiscordDocumentPool.h"
+
+DiscordDocumentPool::DiscordDocumentPool() {
+    for (int i = 0; i < DISCORD_DOCUMENT_POOL_MAX_SLOTS; i++) {
+        _arenas[i] = nullptr;
+        _busy[i] = false;
+        _leaseOverflows[i] = 0;
+    }
+    _count = 0;
+    _maxSize = 0;
+    _placement = DISCORD_MEMORY_AUTO;
+    _inUse = 0;
+    _highWater = 0;
+    _acquisitions = 0;
+    _misses = 0;
+    _overflows = 0;
+    _grows = 0;
+    _peakBytes = 0;
+}
+
+DiscordDocumentPool::~DiscordDocumentPool() {
+    end();
+}
+
+void DiscordDocumentPool::begin(uint8_t slots, size_t slotSize, size_t maxSize, uint8_t placement) {
+    end();
+    if (slots > DISCORD_DOCUMENT_POOL_MAX_SLOTS) {
+        slots = DISCORD_DOCUMENT_POOL_MAX_SLOTS;
+    }
+    _maxSize = maxSize > slotSize ? maxSize : slotSize;
+    _placement = placement;
+    // Blocks are only allocated when a slot is first used
+    for (uint8_t i = 0; i < slots; i++) {
+        _arenas[i] = new DiscordArena(slotSize, placement);
+        _busy[i] = false;
+        _count = i + 1;
+    }
+}
+
+void DiscordDocumentPool::end() {
+    for (uint8_t i = 0; i < _count; i++) {
+        delete _arenas[i];
+        _arenas[i] = nullptr;
+    }
+    _count = 0;
+}
+
+int DiscordDocumentPool::acquire() {
+    _acquisitions++;
+    for (uint8_t i = 0; i < _count; i++) {
+        bool expected = false;
+        if (_busy[i].compare_exchange_strong(expected, true)) {
+            _leaseOverflows[i] = _arenas[i]->stats().overflows;
+            uint8_t inUse = ++_inUse;
+            uint8_t highWater = _highWater.load();
+            while (inUse > highWater && !_highWater.compare_exchange_weak(highWater, inUse)) {
+            }
+            return i;
+        }
+    }
+    _misses++;
+    return -1;
+}
+
+// Only the leaseholder touches the slot's arena until _busy is cleared
+void DiscordDocumentPool::release(int slot) {
+    if (slot < 0 || slot >= _count) {
+        return;
+    }
+    DiscordArena* arena = _arenas[slot];
+    DiscordArenaStats stats = arena->stats();
+    size_t peak = _peakBytes.load();
+    while (stats.highWater > peak && !_peakBytes.compare_exchange_weak(peak, stats.highWater)) {
+    }
+    uint32_t overflows = stats.overflows - _leaseOverflows[slot];
+    _overflows += overflows;
+    arena->reset();
+
+    if (overflows > 0 && stats.capacity > 0 && stats.capacity < _maxSize) {
+        size_t capacity = stats.capacity * 2;
+        arena->resize(capacity < _maxSize ? capacity : _maxSize);
+        _grows++;
+    }
+    _inUse--;
+    _busy[slot] = false;
+}
+
+void DiscordDocumentPool::recycle(int slot) {
+    if (slot >= 0 && slot < _count) {
+        _arenas[slot]->reset();
+    }
+}
+
+ArduinoJson::Allocator* DiscordDocumentPool::allocator(int slot) {
+    if (slot < 0 || slot >= _count) {
+        return DiscordAllocator::instance();
+    }
+    return _arenas[slot];
+}
+
+DiscordDocumentPoolStats DiscordDocumentPool::stats() const {
+    DiscordDocumentPoolStats stats;
+    stats.slots = _count;
+    stats.inUse = _inUse.load();
+    stats.highWater = _highWater.load();
+    stats.acquisitions = _acquisitions.load();
+    stats.misses = _misses.load();
+    stats.capacity = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        stats.capacity += _arenas[i]->stats().capacity;
+    }
+    stats.peakBytes = _peakBytes.load();
+    stats.overflows = _overflows.load();
+    stats.grows = _grows.load();
+    return stats;
+}
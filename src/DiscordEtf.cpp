@@ -0,0 +1,666 @@
+#include "DiscordEtf.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+DiscordEtfReader::DiscordEtfReader(const uint8_t* data, size_t length) {
+    _data = data;
+    _length = length;
+    _pos = 0;
+    _error = (data == nullptr);
+}
+
+bool DiscordEtfReader::_need(size_t count) {
+    if (_error || _length - _pos < count) {
+        _error = true;
+        return false;
+    }
+    return true;
+}
+
+uint32_t DiscordEtfReader::_readU16() {
+    uint32_t value = ((uint32_t)_data[_pos] << 8) | _data[_pos + 1];
+    _pos += 2;
+    return value;
+}
+
+uint32_t DiscordEtfReader::_readU32() {
+    uint32_t value = ((uint32_t)_data[_pos] << 24) | ((uint32_t)_data[_pos + 1] << 16) |
+                     ((uint32_t)_data[_pos + 2] << 8) | _data[_pos + 3];
+    _pos += 4;
+    return value;
+}
+
+bool DiscordEtfReader::begin() {
+    if (!_need(1) || _data[_pos] != ETF_FORMAT_VERSION) {
+        _error = true;
+        return false;
+    }
+    _pos++;
+    return true;
+}
+
+uint8_t DiscordEtfReader::peek() const {
+    return (_error || _pos >= _length) ? 0 : _data[_pos];
+}
+
+bool DiscordEtfReader::readMap(uint32_t& pairs) {
+    if (peek() != ETF_MAP_EXT || !_need(5)) {
+        _error = true;
+        return false;
+    }
+    _pos++;
+    pairs = _readU32();
+    // Every term takes at least one byte; rejects absurd counts up front
+    if (pairs > (_length - _pos) / 2) {
+        _error = true;
+        return false;
+    }
+    return true;
+}
+
+bool DiscordEtfReader::readList(uint32_t& count, bool& hasTail) {
+    hasTail = false;
+    switch (peek()) {
+        case ETF_NIL_EXT:
+            _pos++;
+            count = 0;
+            return true;
+        case ETF_LIST_EXT:
+            if (!_need(5)) return false;
+            _pos++;
+            count = _readU32();
+            hasTail = true;
+            break;
+        case ETF_SMALL_TUPLE_EXT:
+            if (!_need(2)) return false;
+            count = _data[_pos + 1];
+            _pos += 2;
+            break;
+        case ETF_LARGE_TUPLE_EXT:
+            if (!_need(5)) return false;
+            _pos++;
+            count = _readU32();
+            break;
+        default:
+            _error = true;
+            return false;
+    }
+    if (count > _length - _pos) {
+        _error = true;
+        return false;
+    }
+    return true;
+}
+
+bool DiscordEtfReader::readByteList(const uint8_t*& bytes, size_t& length) {
+    if (peek() != ETF_STRING_EXT || !_need(3)) {
+        _error = true;
+        return false;
+    }
+    _pos++;
+    length = _readU16();
+    if (!_need(length)) return false;
+    bytes = _data + _pos;
+    _pos += length;
+    return true;
+}
+
+bool DiscordEtfReader::readBinary(const char*& value, size_t& length) {
+    if (peek() != ETF_BINARY_EXT || !_need(5)) {
+        _error = true;
+        return false;
+    }
+    _pos++;
+    length = _readU32();
+    if (!_need(length)) return false;
+    value = (const char*)(_data + _pos);
+    _pos += length;
+    return true;
+}
+
+bool DiscordEtfReader::readAtom(const char*& value, size_t& length) {
+    switch (peek()) {
+        case ETF_ATOM_EXT:
+        case ETF_ATOM_UTF8_EXT:
+            if (!_need(3)) return false;
+            _pos++;
+            length = _readU16();
+            break;
+        case ETF_SMALL_ATOM_EXT:
+        case ETF_SMALL_ATOM_UTF8_EXT:
+            if (!_need(2)) return false;
+            length = _data[_pos + 1];
+            _pos += 2;
+            break;
+        default:
+            _error = true;
+            return false;
+    }
+    if (!_need(length)) return false;
+    value = (const char*)(_data + _pos);
+    _pos += length;
+    return true;
+}
+
+bool DiscordEtfReader::readInteger(uint64_t& magnitude, bool& negative) {
+    size_t digits = 0;
+    switch (peek()) {
+        case ETF_SMALL_INTEGER_EXT:
+            if (!_need(2)) return false;
+            magnitude = _data[_pos + 1];
+            negative = false;
+            _pos += 2;
+            return true;
+        case ETF_INTEGER_EXT: {
+            if (!_need(5)) return false;
+            _pos++;
+            int32_t value = (int32_t)_readU32();
+            negative = value < 0;
+            magnitude = negative ? (uint64_t)(-(int64_t)value) : (uint64_t)value;
+            return true;
+        }
+        case ETF_SMALL_BIG_EXT:
+            if (!_need(3)) return false;
+            digits = _data[_pos + 1];
+            _pos += 2;
+            break;
+        case ETF_LARGE_BIG_EXT:
+            if (!_need(6)) return false;
+            _pos++;
+            digits = _readU32();
+            break;
+        default:
+            _error = true;
+            return false;
+    }
+
+    // Sign byte, then little-endian base-256 digits
+    if (_error || _length - _pos <= digits) {
+        _error = true;
+        return false;
+    }
+    negative = _data[_pos++] != 0;
+    magnitude = 0;
+    for (size_t i = 0; i < digits; i++) {
+        uint8_t digit = _data[_pos + i];
+        if (i >= 8) {
+            if (digit != 0) {
+                _error = true;
+                return false;
+            }
+            continue;
+        }
+        magnitude |= (uint64_t)digit << (8 * i);
+    }
+    _pos += digits;
+    return true;
+}
+
+bool DiscordEtfReader::readFloat(double& value) {
+    if (peek() == ETF_NEW_FLOAT_EXT) {
+        if (!_need(9)) return false;
+        _pos++;
+        uint64_t bits = ((uint64_t)_readU32() << 32);
+        bits |= _readU32();
+        memcpy(&value, &bits, sizeof(value));
+        return true;
+    }
+    if (peek() == ETF_FLOAT_EXT) {
+        // Legacy form: the number printed with "%.20e", NUL padded
+        if (!_need(32)) return false;
+        char text[32];
+        memcpy(text, _data + _pos + 1, 31);
+        text[31] = '\0';
+        value = strtod(text, nullptr);
+        _pos += 32;
+        return true;
+    }
+    _error = true;
+    return false;
+}
+
+bool DiscordEtfReader::skipValue() {
+    // Containers just add their children to the number of terms left, so
+    // nesting depth costs nothing
+    size_t remaining = 1;
+    while (remaining > 0 && !_error) {
+        remaining--;
+        const char* text = nullptr;
+        const uint8_t* bytes = nullptr;
+        size_t length = 0;
+        uint32_t count = 0;
+        bool hasTail = false;
+        double number = 0;
+
+        switch (peek()) {
+            case ETF_MAP_EXT:
+                if (readMap(count)) {
+                    remaining += (size_t)count * 2;
+                }
+                break;
+            case ETF_NIL_EXT:
+            case ETF_LIST_EXT:
+            case ETF_SMALL_TUPLE_EXT:
+            case ETF_LARGE_TUPLE_EXT:
+                if (readList(count, hasTail)) {
+                    remaining += count + (hasTail ? 1 : 0);
+                }
+                break;
+            case ETF_STRING_EXT:
+                readByteList(bytes, length);
+                break;
+            case ETF_BINARY_EXT:
+                readBinary(text, length);
+                break;
+            case ETF_ATOM_EXT:
+            case ETF_ATOM_UTF8_EXT:
+            case ETF_SMALL_ATOM_EXT:
+            case ETF_SMALL_ATOM_UTF8_EXT:
+                readAtom(text, length);
+                break;
+            case ETF_SMALL_INTEGER_EXT:
+                if (_need(2)) _pos += 2;
+                break;
+            case ETF_INTEGER_EXT:
+                if (_need(5)) _pos += 5;
+                break;
+            case ETF_SMALL_BIG_EXT:
+                if (_need(2) && _need(2 + _data[_pos + 1] + 1)) _pos += 2 + _data[_pos + 1] + 1;
+                break;
+            case ETF_LARGE_BIG_EXT:
+                if (_need(5)) {
+                    _pos++;
+                    length = _readU32();
+                    if (_length - _pos > length) {
+                        _pos += length + 1;
+                    } else {
+                        _error = true;
+                    }
+                }
+                break;
+            case ETF_NEW_FLOAT_EXT:
+            case ETF_FLOAT_EXT:
+                readFloat(number);
+                break;
+            default:
+                _error = true;
+                break;
+        }
+    }
+    return !_error;
+}
+
+// Decoding into ArduinoJson
+
+static bool isAtomTag(uint8_t tag) {
+    return tag == ETF_ATOM_EXT || tag == ETF_ATOM_UTF8_EXT || tag == ETF_SMALL_ATOM_EXT || tag == ETF_SMALL_ATOM_UTF8_EXT;
+}
+
+static bool atomEquals(const char* value, size_t length, const char* name) {
+    return strlen(name) == length && memcmp(value, name, length) == 0;
+}
+
+// Map keys are atoms in what the gateway sends and binaries in what it accepts
+static bool readKey(DiscordEtfReader& reader, const char*& key, size_t& keyLength) {
+    if (isAtomTag(reader.peek())) {
+        return reader.readAtom(key, keyLength);
+    }
+    return reader.readBinary(key, keyLength);
+}
+
+// Same truthiness as DeserializationOption::Filter: `true` keeps a whole
+// subtree, an object/array keeps the members/elements it describes
+static bool filterAllows(JsonVariantConst filter) {
+    return filter.is<bool>() ? filter.as<bool>() : !filter.isNull();
+}
+
+static DeserializationError::Code skipTerm(DiscordEtfReader& reader) {
+    return reader.skipValue() ? DeserializationError::Ok : DeserializationError::InvalidInput;
+}
+
+static DeserializationError::Code decodeTerm(DiscordEtfReader& reader, JsonVariant dst, JsonVariantConst filter,
+                                             bool filtered, uint8_t nestingLimit) {
+    if (filtered && filter.is<bool>() && filter.as<bool>()) {
+        filtered = false;
+    }
+
+    const char* text = nullptr;
+    size_t length = 0;
+    DeserializationError::Code code = DeserializationError::Ok;
+    uint8_t tag = reader.peek();
+
+    switch (tag) {
+        case ETF_MAP_EXT: {
+            if (filtered && !filter.is<JsonObjectConst>()) {
+                return skipTerm(reader);
+            }
+            if (nestingLimit == 0) {
+                return DeserializationError::TooDeep;
+            }
+            uint32_t pairs = 0;
+            if (!reader.readMap(pairs)) {
+                return DeserializationError::InvalidInput;
+            }
+            JsonObject object = dst.to<JsonObject>();
+            for (uint32_t i = 0; i < pairs; i++) {
+                if (!readKey(reader, text, length)) {
+                    return DeserializationError::InvalidInput;
+                }
+                JsonVariantConst memberFilter = filter;
+                if (filtered) {
+                    memberFilter = filter[JsonString(text, length)];
+                    if (memberFilter.isNull()) {
+                        memberFilter = filter["*"];
+                    }
+                    if (!filterAllows(memberFilter)) {
+                        code = skipTerm(reader);
+                        if (code != DeserializationError::Ok) return code;
+                        continue;
+                    }
+                }
+                code = decodeTerm(reader, object[JsonString(text, length)].to<JsonVariant>(), memberFilter, filtered,
+                                  nestingLimit - 1);
+                if (code != DeserializationError::Ok) return code;
+            }
+            return DeserializationError::Ok;
+        }
+
+        case ETF_NIL_EXT:
+        case ETF_LIST_EXT:
+        case ETF_SMALL_TUPLE_EXT:
+        case ETF_LARGE_TUPLE_EXT: {
+            if (filtered && !filter.is<JsonArrayConst>()) {
+                return skipTerm(reader);
+            }
+            if (nestingLimit == 0) {
+                return DeserializationError::TooDeep;
+            }
+            uint32_t count = 0;
+            bool hasTail = false;
+            if (!reader.readList(count, hasTail)) {
+                return DeserializationError::InvalidInput;
+            }
+            JsonArray array = dst.to<JsonArray>();
+            JsonVariantConst elementFilter = filtered ? filter[0] : filter;
+            bool keep = !filtered || filterAllows(elementFilter);
+            for (uint32_t i = 0; i < count; i++) {
+                code = keep ? decodeTerm(reader, array.add<JsonVariant>(), elementFilter, filtered, nestingLimit - 1)
+                            : skipTerm(reader);
+                if (code != DeserializationError::Ok) return code;
+            }
+            return hasTail ? skipTerm(reader) : DeserializationError::Ok;
+        }
+
+        case ETF_STRING_EXT: {
+            if (filtered && !filter.is<JsonArrayConst>()) {
+                return skipTerm(reader);
+            }
+            const uint8_t* bytes = nullptr;
+            if (!reader.readByteList(bytes, length)) {
+                return DeserializationError::InvalidInput;
+            }
+            JsonArray array = dst.to<JsonArray>();
+            if (!filtered || filterAllows(filter[0])) {
+                for (size_t i = 0; i < length; i++) {
+                    array.add(bytes[i]);
+                }
+            }
+            return DeserializationError::Ok;
+        }
+
+        default:
+            break;
+    }
+
+    // Scalars are only kept when the filter allows the whole value
+    if (filtered) {
+        return skipTerm(reader);
+    }
+
+    switch (tag) {
+        case ETF_BINARY_EXT:
+            if (!reader.readBinary(text, length)) break;
+            dst.set(JsonString(text, length));
+            return DeserializationError::Ok;
+
+        case ETF_ATOM_EXT:
+        case ETF_ATOM_UTF8_EXT:
+        case ETF_SMALL_ATOM_EXT:
+        case ETF_SMALL_ATOM_UTF8_EXT:
+            if (!reader.readAtom(text, length)) break;
+            if (atomEquals(text, length, "nil") || atomEquals(text, length, "null")) {
+                dst.set(nullptr);
+            } else if (atomEquals(text, length, "true")) {
+                dst.set(true);
+            } else if (atomEquals(text, length, "false")) {
+                dst.set(false);
+            } else {
+                dst.set(JsonString(text, length));
+            }
+            return DeserializationError::Ok;
+
+        case ETF_SMALL_INTEGER_EXT:
+        case ETF_INTEGER_EXT:
+        case ETF_SMALL_BIG_EXT:
+        case ETF_LARGE_BIG_EXT: {
+            uint64_t magnitude = 0;
+            bool negative = false;
+            if (!reader.readInteger(magnitude, negative)) break;
+            if (magnitude <= (negative ? 2147483648ULL : 2147483647ULL)) {
+                dst.set(negative ? (int32_t)(0 - (int64_t)magnitude) : (int32_t)magnitude);
+                return DeserializationError::Ok;
+            }
+            char digits[22];
+            char* end = digits + sizeof(digits);
+            char* start = end;
+            *--start = '\0';
+            do {
+                *--start = (char)('0' + magnitude % 10);
+                magnitude /= 10;
+            } while (magnitude > 0);
+            if (negative) {
+                *--start = '-';
+            }
+            dst.set(JsonString(start, end - start - 1));
+            return DeserializationError::Ok;
+        }
+
+        case ETF_NEW_FLOAT_EXT:
+        case ETF_FLOAT_EXT: {
+            double value = 0;
+            if (!reader.readFloat(value)) break;
+            dst.set(value);
+            return DeserializationError::Ok;
+        }
+
+        default:
+            break;
+    }
+    return DeserializationError::InvalidInput;
+}
+
+static DeserializationError decodeDocument(JsonDocument& doc, const uint8_t* data, size_t length,
+                                           JsonVariantConst filter, bool filtered) {
+    doc.clear();
+    if (data == nullptr || length == 0) {
+        return DeserializationError::EmptyInput;
+    }
+
+    DiscordEtfReader reader(data, length);
+    if (!reader.begin()) {
+        return DeserializationError::InvalidInput;
+    }
+
+    DeserializationError::Code code;
+    if (filtered && !filterAllows(filter)) {
+        code = skipTerm(reader);
+    } else {
+        code = decodeTerm(reader, doc.as<JsonVariant>(), filter, filtered, ARDUINOJSON_DEFAULT_NESTING_LIMIT);
+    }
+    if (code == DeserializationError::Ok && doc.overflowed()) {
+        code = DeserializationError::NoMemory;
+    }
+    return code;
+}
+
+DeserializationError deserializeEtf(JsonDocument& doc, const uint8_t* data, size_t length) {
+    return decodeDocument(doc, data, length, JsonVariantConst(), false);
+}
+
+DeserializationError deserializeEtf(JsonDocument& doc, const uint8_t* data, size_t length, JsonVariantConst filter) {
+    return decodeDocument(doc, data, length, filter, true);
+}
+
+bool peekEtfString(const uint8_t* data, size_t length, const char* key, const char*& value, size_t& valueLength) {
+    DiscordEtfReader reader(data, length);
+    uint32_t pairs = 0;
+    if (!reader.begin() || reader.peek() != ETF_MAP_EXT || !reader.readMap(pairs)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < pairs; i++) {
+        const char* name = nullptr;
+        size_t nameLength = 0;
+        if (!readKey(reader, name, nameLength)) {
+            return false;
+        }
+        if (atomEquals(name, nameLength, key)) {
+            uint8_t tag = reader.peek();
+            if (tag == ETF_BINARY_EXT) {
+                return reader.readBinary(value, valueLength);
+            }
+            if (isAtomTag(tag) && reader.readAtom(value, valueLength)) {
+                return !atomEquals(value, valueLength, "nil");
+            }
+            return false;
+        }
+        if (!reader.skipValue()) {
+            return false;
+        }
+    }
+    return false;
+}
+
+// Encoding
+
+struct EtfOutput {
+    uint8_t* data;
+    size_t capacity;
+    size_t length;
+};
+
+static void etfPut(EtfOutput& out, uint8_t value) {
+    if (out.length < out.capacity) {
+        out.data[out.length] = value;
+    }
+    out.length++;
+}
+
+static void etfPutU32(EtfOutput& out, uint32_t value) {
+    etfPut(out, (uint8_t)(value >> 24));
+    etfPut(out, (uint8_t)(value >> 16));
+    etfPut(out, (uint8_t)(value >> 8));
+    etfPut(out, (uint8_t)value);
+}
+
+static void etfPutBytes(EtfOutput& out, const void* bytes, size_t length) {
+    if (out.length < out.capacity) {
+        size_t room = out.capacity - out.length;
+        memcpy(out.data + out.length, bytes, length < room ? length : room);
+    }
+    out.length += length;
+}
+
+static void etfWriteAtom(EtfOutput& out, const char* name) {
+    size_t length = strlen(name);
+    etfPut(out, ETF_SMALL_ATOM_UTF8_EXT);
+    etfPut(out, (uint8_t)length);
+    etfPutBytes(out, name, length);
+}
+
+static void etfWriteBinary(EtfOutput& out, const char* value, size_t length) {
+    etfPut(out, ETF_BINARY_EXT);
+    etfPutU32(out, (uint32_t)length);
+    etfPutBytes(out, value, length);
+}
+
+static void etfWriteInteger(EtfOutput& out, uint64_t magnitude, bool negative) {
+    if (!negative && magnitude < 256) {
+        etfPut(out, ETF_SMALL_INTEGER_EXT);
+        etfPut(out, (uint8_t)magnitude);
+    } else if (magnitude <= (negative ? 2147483648ULL : 2147483647ULL)) {
+        etfPut(out, ETF_INTEGER_EXT);
+        etfPutU32(out, (uint32_t)(negative ? 0 - magnitude : magnitude));
+    } else {
+        uint8_t digits = 0;
+        for (uint64_t rest = magnitude; rest > 0; rest >>= 8) {
+            digits++;
+        }
+        etfPut(out, ETF_SMALL_BIG_EXT);
+        etfPut(out, digits);
+        etfPut(out, negative ? 1 : 0);
+        for (uint8_t i = 0; i < digits; i++) {
+            etfPut(out, (uint8_t)(magnitude >> (8 * i)));
+        }
+    }
+}
+
+static void etfWriteTerm(EtfOutput& out, JsonVariantConst value) {
+    if (value.is<JsonObjectConst>()) {
+        JsonObjectConst object = value.as<JsonObjectConst>();
+        etfPut(out, ETF_MAP_EXT);
+        etfPutU32(out, (uint32_t)object.size());
+        for (JsonPairConst pair : object) {
+            etfWriteBinary(out, pair.key().c_str(), pair.key().size());
+            etfWriteTerm(out, pair.value());
+        }
+    } else if (value.is<JsonArrayConst>()) {
+        JsonArrayConst array = value.as<JsonArrayConst>();
+        if (array.size() > 0) {
+            etfPut(out, ETF_LIST_EXT);
+            etfPutU32(out, (uint32_t)array.size());
+            for (JsonVariantConst element : array) {
+                etfWriteTerm(out, element);
+            }
+        }
+        etfPut(out, ETF_NIL_EXT);
+    } else if (value.is<bool>()) {
+        etfWriteAtom(out, value.as<bool>() ? "true" : "false");
+    } else if (value.is<int32_t>()) {
+        int32_t number = value.as<int32_t>();
+        etfWriteInteger(out, number < 0 ? (uint64_t)(-(int64_t)number) : (uint64_t)number, number < 0);
+    } else if (value.is<uint32_t>()) {
+        etfWriteInteger(out, value.as<uint32_t>(), false);
+#if ARDUINOJSON_USE_LONG_LONG
+    } else if (value.is<int64_t>()) {
+        int64_t number = value.as<int64_t>();
+        etfWriteInteger(out, number < 0 ? 0 - (uint64_t)number : (uint64_t)number, number < 0);
+    } else if (value.is<uint64_t>()) {
+        etfWriteInteger(out, value.as<uint64_t>(), false);
+#endif
+    } else if (value.is<double>()) {
+        double number = value.as<double>();
+        uint64_t bits = 0;
+        memcpy(&bits, &number, sizeof(bits));
+        etfPut(out, ETF_NEW_FLOAT_EXT);
+        etfPutU32(out, (uint32_t)(bits >> 32));
+        etfPutU32(out, (uint32_t)bits);
+    } else if (value.is<JsonString>()) {
+        JsonString text = value.as<JsonString>();
+        etfWriteBinary(out, text.c_str(), text.size());
+    } else {
+        etfWriteAtom(out, "nil");
+    }
+}
+
+size_t serializeEtf(JsonVariantConst src, uint8_t* output, size_t capacity) {
+    EtfOutput out = {output, output != nullptr ? capacity : 0, 0};
+    etfPut(out, ETF_FORMAT_VERSION);
+    etfWriteTerm(out, src);
+    return out.length;
+}
+
+size_t measureEtf(JsonVariantConst src) {
+    return serializeEtf(src, nullptr, 0);
+}
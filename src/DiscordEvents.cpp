@@ -0,0 +1,46 @@
+#include "DiscordEvents.h"
+
+#include <string.h>
+
+#define DISCORD_EVENT_NAME_ENTRY(name) #name,
+
+static const char* const EVENT_NAMES[DISCORD_EVENT_COUNT] = {
+    "",
+    DISCORD_DISPATCH_EVENTS(DISCORD_EVENT_NAME_ENTRY)
+};
+
+uint32_t discordEventHash(const char* name, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+#define DISCORD_EVENT_CASE(name) \
+    case discordEventNameHash(#name): type = DISCORD_EVENT_##name; break;
+
+DiscordEventType discordEventType(const char* name, size_t length) {
+    if (name == nullptr) {
+        return DISCORD_EVENT_UNKNOWN;
+    }
+
+    DiscordEventType type;
+    switch (discordEventHash(name, length)) {
+        DISCORD_DISPATCH_EVENTS(DISCORD_EVENT_CASE)
+        default:
+            return DISCORD_EVENT_UNKNOWN;
+    }
+
+    // The hash is only perfect over the known names; confirm the match so
+    // an unknown event that happens to share a hash is not misrouted
+    const char* expected = EVENT_NAMES[type];
+    if (strlen(expected) != length || memcmp(expected, name, length) != 0) {
+        return DISCORD_EVENT_UNKNOWN;
+    }
+    return type;
+}
+
+const char* discordEventName(DiscordEventType type) {
+    return type < DISCORD_EVENT_COUNT ? EVENT_NAMES[type] : "";
+}
@@ -0,0 +1,452 @@
+#include "DiscordInflate.h"
+#include "DiscordAllocator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Canonical Huffman decoding after Mark Adler's puff.c (RFC 1951)
+#define INFLATE_MAX_BITS 15
+#define INFLATE_MAX_LCODES 286
+#define INFLATE_MAX_DCODES 30
+#define INFLATE_FIXED_LCODES 288
+#define INFLATE_WINDOW_MASK (DISCORD_INFLATE_WINDOW_SIZE - 1)
+
+static const uint16_t LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const uint8_t DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t CODE_LENGTH_ORDER[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+DiscordInflate::DiscordInflate() {
+    _window = nullptr;
+    _in = nullptr;
+    _inLength = 0;
+    _inCapacity = 0;
+    _out = nullptr;
+    _outLength = 0;
+    _outCapacity = 0;
+    _errorMessage = "";
+    _totalIn = 0;
+    _totalOut = 0;
+    reset();
+}
+
+DiscordInflate::~DiscordInflate() {
+    discordFree(_window);
+    discordFree(_in);
+    discordFree(_out);
+}
+
+void DiscordInflate::reset() {
+    _windowPos = 0;
+    _history = 0;
+    _started = false;
+    _finished = false;
+    _inLength = 0;
+    _outLength = 0;
+    _error = false;
+}
+
+bool DiscordInflate::_fail(const char* message) {
+    if (!_error) {
+        _errorMessage = message;
+    }
+    _error = true;
+    return false;
+}
+
+uint32_t DiscordInflate::_getBits(uint8_t count) {
+    while (_bitCount < count) {
+        if (_srcPos >= _srcLength) {
+            _fail("unexpected end of compressed data");
+            return 0;
+        }
+        _bits |= (uint32_t)_src[_srcPos++] << _bitCount;
+        _bitCount += 8;
+    }
+    uint32_t value = _bits & ((1UL << count) - 1);
+    _bits >>= count;
+    _bitCount -= count;
+    return value;
+}
+
+int DiscordInflate::_decode(const Huffman& h) {
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int len = 1; len <= INFLATE_MAX_BITS; len++) {
+        code |= (int)_getBits(1);
+        int count = h.count[len];
+        if (code - count < first) {
+            return h.symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+bool DiscordInflate::_build(Huffman& h, const uint8_t* lengths, int count) {
+    memset(h.count, 0, sizeof(h.count));
+    for (int symbol = 0; symbol < count; symbol++) {
+        h.count[lengths[symbol]]++;
+    }
+    if (h.count[0] == count) {
+        // No codes; only valid for a distance table that is never used
+        return true;
+    }
+
+    int left = 1;
+    for (int len = 1; len <= INFLATE_MAX_BITS; len++) {
+        left <<= 1;
+        left -= h.count[len];
+        if (left < 0) {
+            return _fail("over-subscribed Huffman table");
+        }
+    }
+
+    uint16_t offsets[INFLATE_MAX_BITS + 1];
+    offsets[1] = 0;
+    for (int len = 1; len < INFLATE_MAX_BITS; len++) {
+        offsets[len + 1] = offsets[len] + h.count[len];
+    }
+    for (int symbol = 0; symbol < count; symbol++) {
+        if (lengths[symbol] != 0) {
+            h.symbol[offsets[lengths[symbol]]++] = (uint16_t)symbol;
+        }
+    }
+    return true;
+}
+
+bool DiscordInflate::_reserveOut(size_t extra) {
+    // +1 keeps room for the terminating NUL
+    size_t needed = _outLength + extra + 1;
+    if (needed <= _outCapacity) {
+        return true;
+    }
+    size_t capacity = _outCapacity > 0 ? _outCapacity : 1024;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    char* out = (char*)discordRealloc(_out, capacity);
+    if (out == nullptr) {
+        return _fail("out of memory for inflated message");
+    }
+    _out = out;
+    _outCapacity = capacity;
+    return true;
+}
+
+void DiscordInflate::_emit(uint8_t value) {
+    _out[_outLength++] = (char)value;
+    _window[_windowPos] = value;
+    _windowPos = (_windowPos + 1) & INFLATE_WINDOW_MASK;
+    if (_history < DISCORD_INFLATE_WINDOW_SIZE) {
+        _history++;
+    }
+}
+
+bool DiscordInflate::_stored() {
+    // Stored blocks start on a byte boundary
+    _bits = 0;
+    _bitCount = 0;
+    if (_srcPos + 4 > _srcLength) {
+        return _fail("truncated stored block");
+    }
+    uint16_t length = (uint16_t)(_src[_srcPos] | (_src[_srcPos + 1] << 8));
+    uint16_t complement = (uint16_t)(_src[_srcPos + 2] | (_src[_srcPos + 3] << 8));
+    _srcPos += 4;
+    if (length != (uint16_t)~complement) {
+        return _fail("stored block length mismatch");
+    }
+    if (_srcPos + length > _srcLength) {
+        return _fail("truncated stored block");
+    }
+    if (!_reserveOut(length)) {
+        return false;
+    }
+    for (uint16_t i = 0; i < length; i++) {
+        _emit(_src[_srcPos++]);
+    }
+    return true;
+}
+
+bool DiscordInflate::_codes() {
+    for (;;) {
+        int symbol = _decode(_lencode);
+        if (_error) {
+            return false;
+        }
+        if (symbol < 0) {
+            return _fail("invalid literal/length code");
+        }
+        if (symbol < 256) {
+            if (!_reserveOut(1)) {
+                return false;
+            }
+            _emit((uint8_t)symbol);
+            continue;
+        }
+        if (symbol == 256) {
+            return true;
+        }
+
+        symbol -= 257;
+        if (symbol >= 29) {
+            return _fail("invalid length symbol");
+        }
+        uint32_t length = LENGTH_BASE[symbol] + _getBits(LENGTH_EXTRA[symbol]);
+
+        symbol = _decode(_distcode);
+        if (_error) {
+            return false;
+        }
+        if (symbol < 0 || symbol >= 30) {
+            return _fail("invalid distance code");
+        }
+        uint32_t distance = DIST_BASE[symbol] + _getBits(DIST_EXTRA[symbol]);
+        if (_error) {
+            return false;
+        }
+        if (distance > _history) {
+            return _fail("distance too far back");
+        }
+
+        if (!_reserveOut(length)) {
+            return false;
+        }
+        // Byte by byte so overlapping copies repeat the pattern
+        while (length-- > 0) {
+            _emit(_window[(_windowPos - distance) & INFLATE_WINDOW_MASK]);
+        }
+    }
+}
+
+bool DiscordInflate::_fixed() {
+    uint8_t lengths[INFLATE_FIXED_LCODES];
+    int symbol = 0;
+    for (; symbol < 144; symbol++) {
+        lengths[symbol] = 8;
+    }
+    for (; symbol < 256; symbol++) {
+        lengths[symbol] = 9;
+    }
+    for (; symbol < 280; symbol++) {
+        lengths[symbol] = 7;
+    }
+    for (; symbol < INFLATE_FIXED_LCODES; symbol++) {
+        lengths[symbol] = 8;
+    }
+    _build(_lencode, lengths, INFLATE_FIXED_LCODES);
+
+    for (symbol = 0; symbol < INFLATE_MAX_DCODES; symbol++) {
+        lengths[symbol] = 5;
+    }
+    _build(_distcode, lengths, INFLATE_MAX_DCODES);
+    return _codes();
+}
+
+bool DiscordInflate::_dynamic() {
+    uint8_t lengths[INFLATE_MAX_LCODES + INFLATE_MAX_DCODES];
+
+    int lengthCount = (int)_getBits(5) + 257;
+    int distCount = (int)_getBits(5) + 1;
+    int codeCount = (int)_getBits(4) + 4;
+    if (_error) {
+        return false;
+    }
+    if (lengthCount > INFLATE_MAX_LCODES || distCount > INFLATE_MAX_DCODES) {
+        return _fail("bad dynamic block counts");
+    }
+
+    int index = 0;
+    for (; index < codeCount; index++) {
+        lengths[CODE_LENGTH_ORDER[index]] = (uint8_t)_getBits(3);
+    }
+    for (; index < 19; index++) {
+        lengths[CODE_LENGTH_ORDER[index]] = 0;
+    }
+    if (_error || !_build(_lencode, lengths, 19)) {
+        return false;
+    }
+
+    index = 0;
+    while (index < lengthCount + distCount) {
+        int symbol = _decode(_lencode);
+        if (_error) {
+            return false;
+        }
+        if (symbol < 0) {
+            return _fail("invalid code length code");
+        }
+        if (symbol < 16) {
+            lengths[index++] = (uint8_t)symbol;
+            continue;
+        }
+
+        uint8_t value = 0;
+        int repeat;
+        if (symbol == 16) {
+            if (index == 0) {
+                return _fail("repeat with no previous length");
+            }
+            value = lengths[index - 1];
+            repeat = 3 + (int)_getBits(2);
+        } else if (symbol == 17) {
+            repeat = 3 + (int)_getBits(3);
+        } else {
+            repeat = 11 + (int)_getBits(7);
+        }
+        if (_error) {
+            return false;
+        }
+        if (index + repeat > lengthCount + distCount) {
+            return _fail("too many code lengths");
+        }
+        while (repeat-- > 0) {
+            lengths[index++] = value;
+        }
+    }
+
+    if (lengths[256] == 0) {
+        return _fail("missing end-of-block code");
+    }
+    if (!_build(_lencode, lengths, lengthCount) || !_build(_distcode, lengths + lengthCount, distCount)) {
+        return false;
+    }
+    return _codes();
+}
+
+bool DiscordInflate::_inflate(const uint8_t* data, size_t length) {
+    _src = data;
+    _srcLength = length;
+    _srcPos = 0;
+    _bits = 0;
+    _bitCount = 0;
+    _outLength = 0;
+
+    if (_window == nullptr) {
+        _window = (uint8_t*)discordMalloc(DISCORD_INFLATE_WINDOW_SIZE);
+        if (_window == nullptr) {
+            return _fail("out of memory for inflate window");
+        }
+    }
+
+    if (!_started) {
+        // zlib header: deflate, no preset dictionary, valid check bits
+        if (length < 2) {
+            return _fail("truncated zlib header");
+        }
+        uint8_t cmf = data[0];
+        uint8_t flg = data[1];
+        if ((cmf & 0x0F) != 8 || (flg & 0x20) != 0 || ((cmf << 8) | flg) % 31 != 0) {
+            return _fail("invalid zlib header");
+        }
+        _srcPos = 2;
+        _started = true;
+    }
+
+    // Blocks until the input is used up; a sync flush always ends on a
+    // byte boundary, so leftover bits are padding
+    while (!_finished && (_srcPos < _srcLength || _bitCount >= 3)) {
+        bool last = _getBits(1) != 0;
+        uint32_t type = _getBits(2);
+        if (_error) {
+            return false;
+        }
+
+        bool ok;
+        switch (type) {
+            case 0:
+                ok = _stored();
+                break;
+            case 1:
+                ok = _fixed();
+                break;
+            case 2:
+                ok = _dynamic();
+                break;
+            default:
+                ok = _fail("invalid block type");
+                break;
+        }
+        if (!ok) {
+            return false;
+        }
+        if (last) {
+            // Anything after the final block is the adler32 trailer
+            _finished = true;
+        }
+    }
+
+    if (!_reserveOut(0)) {
+        return false;
+    }
+    _out[_outLength] = '\0';
+    return true;
+}
+
+int DiscordInflate::push(const uint8_t* data, size_t length) {
+    if (_error) {
+        return DISCORD_INFLATE_ERROR;
+    }
+    _totalIn += length;
+
+    const uint8_t* input = data;
+    size_t inputLength = length;
+    bool buffered = _inLength > 0;
+    bool complete = length >= 4 && data[length - 4] == 0x00 && data[length - 3] == 0x00 &&
+                    data[length - 2] == 0xFF && data[length - 1] == 0xFF;
+
+    if (buffered || !complete) {
+        if (_inLength + length > _inCapacity) {
+            size_t capacity = _inCapacity > 0 ? _inCapacity : 1024;
+            while (capacity < _inLength + length) {
+                capacity *= 2;
+            }
+            uint8_t* in = (uint8_t*)discordRealloc(_in, capacity);
+            if (in == nullptr) {
+                _fail("out of memory for fragmented message");
+                return DISCORD_INFLATE_ERROR;
+            }
+            _in = in;
+            _inCapacity = capacity;
+        }
+        memcpy(_in + _inLength, data, length);
+        _inLength += length;
+
+        complete = _inLength >= 4 && _in[_inLength - 4] == 0x00 && _in[_inLength - 3] == 0x00 &&
+                   _in[_inLength - 2] == 0xFF && _in[_inLength - 1] == 0xFF;
+        if (!complete) {
+            _outLength = 0;
+            return DISCORD_INFLATE_PENDING;
+        }
+        input = _in;
+        inputLength = _inLength;
+    }
+
+    bool ok = _inflate(input, inputLength);
+    _inLength = 0;
+    if (!ok) {
+        return DISCORD_INFLATE_ERROR;
+    }
+    _totalOut += _outLength;
+    return DISCORD_INFLATE_OK;
+}
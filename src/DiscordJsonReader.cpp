@@ -0,0 +1,225 @@
+#include "DiscordJsonReader.h"
+
+DiscordJsonReader::DiscordJsonReader(const char* json, size_t length) {
+    _json = json;
+    _length = length;
+    _pos = 0;
+    _error = (json == nullptr);
+}
+
+void DiscordJsonReader::_skipWhitespace() {
+    while (_pos < _length) {
+        char c = _json[_pos];
+        if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+            return;
+        }
+        _pos++;
+    }
+}
+
+bool DiscordJsonReader::_skipString() {
+    // _pos is on the opening quote
+    _pos++;
+    while (_pos < _length) {
+        char c = _json[_pos++];
+        if (c == '\\') {
+            _pos++;
+        } else if (c == '"') {
+            return true;
+        }
+    }
+    _error = true;
+    return false;
+}
+
+bool DiscordJsonReader::_skipContainer() {
+    // _pos is on the opening bracket; only nesting depth is tracked
+    int depth = 0;
+    while (_pos < _length) {
+        char c = _json[_pos];
+        if (c == '"') {
+            if (!_skipString()) {
+                return false;
+            }
+            continue;
+        }
+        _pos++;
+        if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (--depth == 0) {
+                return true;
+            }
+        }
+    }
+    _error = true;
+    return false;
+}
+
+bool DiscordJsonReader::_skipLiteral() {
+    size_t start = _pos;
+    while (_pos < _length) {
+        char c = _json[_pos];
+        if (c == ',' || c == '}' || c == ']' || c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            break;
+        }
+        _pos++;
+    }
+    if (_pos == start) {
+        _error = true;
+        return false;
+    }
+    return true;
+}
+
+char DiscordJsonReader::peek() {
+    if (_error) {
+        return 0;
+    }
+    _skipWhitespace();
+    if (_pos >= _length) {
+        return 0;
+    }
+    char c = _json[_pos];
+    switch (c) {
+        case '{':
+        case '[':
+        case '"':
+        case 'n':
+        case 't':
+        case 'f':
+            return c;
+        default:
+            return (c == '-' || (c >= '0' && c <= '9')) ? '0' : 0;
+    }
+}
+
+bool DiscordJsonReader::enterObject() {
+    if (peek() != '{') {
+        _error = true;
+        return false;
+    }
+    _pos++;
+    return true;
+}
+
+bool DiscordJsonReader::enterArray() {
+    if (peek() != '[') {
+        _error = true;
+        return false;
+    }
+    _pos++;
+    return true;
+}
+
+bool DiscordJsonReader::nextMember(const char*& key, size_t& keyLength) {
+    if (_error) {
+        return false;
+    }
+    _skipWhitespace();
+    if (_pos < _length && _json[_pos] == ',') {
+        _pos++;
+        _skipWhitespace();
+    }
+    if (_pos >= _length) {
+        _error = true;
+        return false;
+    }
+    if (_json[_pos] == '}') {
+        _pos++;
+        return false;
+    }
+    if (_json[_pos] != '"') {
+        _error = true;
+        return false;
+    }
+
+    size_t keyStart = _pos + 1;
+    if (!_skipString()) {
+        return false;
+    }
+    key = _json + keyStart;
+    keyLength = _pos - 1 - keyStart;
+
+    _skipWhitespace();
+    if (_pos >= _length || _json[_pos] != ':') {
+        _error = true;
+        return false;
+    }
+    _pos++;
+    return true;
+}
+
+bool DiscordJsonReader::nextElement() {
+    if (_error) {
+        return false;
+    }
+    _skipWhitespace();
+    if (_pos < _length && _json[_pos] == ',') {
+        _pos++;
+        _skipWhitespace();
+    }
+    if (_pos >= _length) {
+        _error = true;
+        return false;
+    }
+    if (_json[_pos] == ']') {
+        _pos++;
+        return false;
+    }
+    return true;
+}
+
+bool DiscordJsonReader::skipValue() {
+    switch (peek()) {
+        case '{':
+        case '[':
+            return _skipContainer();
+        case '"':
+            return _skipString();
+        case 0:
+            _error = true;
+            return false;
+        default:
+            return _skipLiteral();
+    }
+}
+
+bool DiscordJsonReader::rawValue(const char*& start, size_t& length) {
+    if (peek() == 0) {
+        _error = true;
+        return false;
+    }
+    size_t begin = _pos;
+    if (!skipValue()) {
+        return false;
+    }
+    start = _json + begin;
+    length = _pos - begin;
+    return true;
+}
+
+bool DiscordJsonReader::readInt(long& value) {
+    if (peek() != '0') {
+        skipValue();
+        return false;
+    }
+    bool negative = (_json[_pos] == '-');
+    if (negative) {
+        _pos++;
+    }
+    long result = 0;
+    while (_pos < _length && _json[_pos] >= '0' && _json[_pos] <= '9') {
+        result = result * 10 + (_json[_pos++] - '0');
+    }
+    value = negative ? -result : result;
+    // Fractions/exponents are not expected here; step over them if present
+    while (_pos < _length) {
+        char c = _json[_pos];
+        if (c == ',' || c == '}' || c == ']' || c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            break;
+        }
+        _pos++;
+    }
+    return true;
+}
@@ -0,0 +1,54 @@
+#include "DiscordSnowflake.h"
+
+Snowflake Snowflake::parse(const char* str, size_t length) {
+    // A 64-bit value has at most 20 decimal digits
+    if (str == nullptr || length == 0 || length > 20) {
+        return Snowflake();
+    }
+
+    uint64_t value = 0;
+    for (size_t i = 0; i < length; i++) {
+        char c = str[i];
+        if (c < '0' || c > '9') {
+            return Snowflake();
+        }
+        value = value * 10 + (uint64_t)(c - '0');
+    }
+    return Snowflake(value);
+}
+
+Snowflake Snowflake::fromTimestamp(uint64_t unixMillis) {
+    if (unixMillis <= DISCORD_EPOCH) {
+        return Snowflake();
+    }
+    return Snowflake((unixMillis - DISCORD_EPOCH) << 22);
+}
+
+size_t Snowflake::toChars(char* buffer, size_t size) const {
+    char digits[DISCORD_SNOWFLAKE_STRING_SIZE];
+    size_t count = 0;
+    uint64_t value = _value;
+    do {
+        digits[count++] = (char)('0' + (value % 10));
+        value /= 10;
+    } while (value != 0);
+
+    if (buffer == nullptr || size < count + 1) {
+        if (buffer != nullptr && size > 0) {
+            buffer[0] = '\0';
+        }
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        buffer[i] = digits[count - 1 - i];
+    }
+    buffer[count] = '\0';
+    return count;
+}
+
+String Snowflake::toString() const {
+    char buffer[DISCORD_SNOWFLAKE_STRING_SIZE];
+    toChars(buffer, sizeof(buffer));
+    return String(buffer);
+}
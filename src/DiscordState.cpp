@@ -0,0 +1,565 @@
+#include "DiscordState.h"
+#include "DiscordAllocator.h"
+
+// Table slots allocated on first use
+#define STATE_INITIAL_CAPACITY 4
+
+// CHANNEL_TYPE_ANNOUNCEMENT_THREAD .. CHANNEL_TYPE_PRIVATE_THREAD
+#define STATE_FIRST_THREAD_TYPE 10
+#define STATE_LAST_THREAD_TYPE 12
+
+// Permission bitfields are decimal strings in JSON; the ETF decoder turns
+// values past 32 bits into strings too, but smaller ones stay integers
+static uint64_t parsePermissions(JsonVariantConst value) {
+    if (value.is<const char*>()) {
+        return strtoull(value.as<const char*>(), nullptr, 10);
+    }
+    return value.as<uint64_t>();
+}
+
+DiscordState::DiscordState() {
+    _guilds = nullptr;
+    _guildCount = 0;
+    _guildCapacity = 0;
+    _channels = nullptr;
+    _channelCount = 0;
+    _channelCapacity = 0;
+    _roles = nullptr;
+    _roleCount = 0;
+    _roleCapacity = 0;
+    _budget = 0;
+    _bytes = 0;
+    _fields = 0;
+    _dropped = 0;
+}
+
+DiscordState::~DiscordState() {
+    end();
+}
+
+void DiscordState::begin(size_t budgetBytes, uint32_t fields) {
+    end();
+    _budget = budgetBytes;
+    _fields = budgetBytes > 0 ? fields : 0;
+    _dropped = 0;
+}
+
+void DiscordState::end() {
+    clear();
+    discordFree(_guilds);
+    discordFree(_channels);
+    discordFree(_roles);
+    _guilds = nullptr;
+    _channels = nullptr;
+    _roles = nullptr;
+    _guildCapacity = 0;
+    _channelCapacity = 0;
+    _roleCapacity = 0;
+    _bytes = 0;
+    _budget = 0;
+    _fields = 0;
+}
+
+bool DiscordState::_charge(size_t bytes) {
+    if (bytes > _budget - _bytes) {
+        return false;
+    }
+    _bytes += bytes;
+    return true;
+}
+
+void DiscordState::_release(size_t bytes) {
+    _bytes -= bytes;
+}
+
+// Doubles a full table, or grows it by one slot when doubling would go
+// over budget
+bool DiscordState::_grow(void*& table, size_t& capacity, size_t count, size_t elementSize) {
+    if (count < capacity) {
+        return true;
+    }
+    size_t newCapacity = capacity == 0 ? STATE_INITIAL_CAPACITY : capacity * 2;
+    if (!_charge((newCapacity - capacity) * elementSize)) {
+        newCapacity = capacity + 1;
+        if (!_charge(elementSize)) {
+            return false;
+        }
+    }
+    void* grown = discordRealloc(table, newCapacity * elementSize);
+    if (grown == nullptr) {
+        _release((newCapacity - capacity) * elementSize);
+        return false;
+    }
+    table = grown;
+    capacity = newCapacity;
+    return true;
+}
+
+void DiscordState::_freeString(char*& field) {
+    if (field != nullptr) {
+        _release(strlen(field) + 1);
+        discordFree(field);
+        field = nullptr;
+    }
+}
+
+// A missing member leaves the field alone; null clears it. Unchanged
+// strings keep their allocation.
+void DiscordState::_setString(char*& field, JsonVariantConst value) {
+    if (value.isUnbound()) {
+        return;
+    }
+    const char* str = value.as<const char*>();
+    if (str == nullptr) {
+        _freeString(field);
+        return;
+    }
+    if (field != nullptr && strcmp(field, str) == 0) {
+        return;
+    }
+    _freeString(field);
+    size_t size = strlen(str) + 1;
+    if (!_charge(size)) {
+        _dropped++;
+        return;
+    }
+    field = (char*)discordMalloc(size);
+    if (field == nullptr) {
+        _release(size);
+        _dropped++;
+        return;
+    }
+    memcpy(field, str, size);
+}
+
+void DiscordState::_setOverwrites(DiscordChannelState& channel, JsonArrayConst overwrites) {
+    if (channel.overwrites != nullptr) {
+        _release(channel.overwriteCount * sizeof(DiscordPermissionOverwrite));
+        discordFree(channel.overwrites);
+        channel.overwrites = nullptr;
+        channel.overwriteCount = 0;
+    }
+    size_t count = overwrites.size();
+    if (count == 0) {
+        return;
+    }
+    if (count > UINT16_MAX || !_charge(count * sizeof(DiscordPermissionOverwrite))) {
+        _dropped++;
+        return;
+    }
+    channel.overwrites = (DiscordPermissionOverwrite*)discordMalloc(count * sizeof(DiscordPermissionOverwrite));
+    if (channel.overwrites == nullptr) {
+        _release(count * sizeof(DiscordPermissionOverwrite));
+        _dropped++;
+        return;
+    }
+    for (JsonObjectConst overwrite : overwrites) {
+        DiscordPermissionOverwrite& entry = channel.overwrites[channel.overwriteCount++];
+        entry.id = overwrite["id"].as<Snowflake>();
+        entry.type = overwrite["type"].as<uint8_t>();
+        entry.allow = parsePermissions(overwrite["allow"]);
+        entry.deny = parsePermissions(overwrite["deny"]);
+    }
+}
+
+DiscordGuildState* DiscordState::_findGuild(Snowflake id) const {
+    for (size_t i = 0; i < _guildCount; i++) {
+        if (_guilds[i].id == id) {
+            return &_guilds[i];
+        }
+    }
+    return nullptr;
+}
+
+DiscordChannelState* DiscordState::_findChannel(Snowflake id) const {
+    for (size_t i = 0; i < _channelCount; i++) {
+        if (_channels[i].id == id) {
+            return &_channels[i];
+        }
+    }
+    return nullptr;
+}
+
+DiscordRoleState* DiscordState::_findRole(Snowflake id) const {
+    for (size_t i = 0; i < _roleCount; i++) {
+        if (_roles[i].id == id) {
+            return &_roles[i];
+        }
+    }
+    return nullptr;
+}
+
+// Tables are unordered: the last entry moves into the freed slot
+void DiscordState::_eraseChannel(size_t index) {
+    DiscordChannelState& channel = _channels[index];
+    _freeString(channel.name);
+    _freeString(channel.topic);
+    _setOverwrites(channel, JsonArrayConst());
+    _channels[index] = _channels[--_channelCount];
+}
+
+void DiscordState::_eraseRole(size_t index) {
+    _freeString(_roles[index].name);
+    _roles[index] = _roles[--_roleCount];
+}
+
+void DiscordState::apply(DiscordEventType type, JsonObjectConst data) {
+    if (!enabled() || data.isNull()) {
+        return;
+    }
+    switch (type) {
+        case DISCORD_EVENT_READY:
+            // A new session sends every guild again
+            clear();
+            break;
+
+        case DISCORD_EVENT_GUILD_CREATE:
+            // An outage announces the guild without its fields
+            if (data["unavailable"].as<bool>()) {
+                break;
+            }
+            removeGuild(data["id"].as<Snowflake>());
+            putGuild(data);
+            break;
+
+        case DISCORD_EVENT_GUILD_UPDATE:
+            putGuild(data);
+            break;
+
+        case DISCORD_EVENT_GUILD_DELETE:
+            removeGuild(data["id"].as<Snowflake>());
+            break;
+
+        case DISCORD_EVENT_CHANNEL_CREATE:
+        case DISCORD_EVENT_CHANNEL_UPDATE:
+            if (!data["guild_id"].isNull()) {
+                putChannel(data);
+            }
+            break;
+
+        case DISCORD_EVENT_CHANNEL_DELETE:
+            removeChannel(data["id"].as<Snowflake>());
+            break;
+
+        case DISCORD_EVENT_GUILD_ROLE_CREATE:
+        case DISCORD_EVENT_GUILD_ROLE_UPDATE:
+            putRole(data["guild_id"].as<Snowflake>(), data["role"].as<JsonObjectConst>());
+            break;
+
+        case DISCORD_EVENT_GUILD_ROLE_DELETE:
+            removeRole(data["role_id"].as<Snowflake>());
+            break;
+
+        default:
+            break;
+    }
+}
+
+void DiscordState::putGuild(JsonObjectConst guildObj) {
+    Snowflake id = guildObj["id"].as<Snowflake>();
+    if (!enabled() || !id.isValid()) {
+        return;
+    }
+
+    DiscordGuildState* guild = _findGuild(id);
+    if (guild == nullptr) {
+        void* table = _guilds;
+        if (!_grow(table, _guildCapacity, _guildCount, sizeof(DiscordGuildState))) {
+            _dropped++;
+            return;
+        }
+        _guilds = (DiscordGuildState*)table;
+        guild = &_guilds[_guildCount++];
+        memset(guild, 0, sizeof(DiscordGuildState));
+        guild->id = id;
+    }
+    if (!guildObj["owner_id"].isNull()) {
+        guild->ownerId = guildObj["owner_id"].as<Snowflake>();
+    }
+    if (_fields & DISCORD_STATE_NAMES) {
+        _setString(guild->name, guildObj["name"]);
+    }
+
+    for (JsonObjectConst channel : guildObj["channels"].as<JsonArrayConst>()) {
+        putChannel(channel, id);
+    }
+
+    JsonArrayConst roles = guildObj["roles"].as<JsonArrayConst>();
+    if ((_fields & DISCORD_STATE_ROLES) && !roles.isNull()) {
+        for (JsonObjectConst role : roles) {
+            putRole(id, role);
+        }
+        // The array is the guild's full role list
+        for (size_t i = _roleCount; i-- > 0;) {
+            if (_roles[i].guildId != id) {
+                continue;
+            }
+            bool listed = false;
+            for (JsonObjectConst role : roles) {
+                if (role["id"].as<Snowflake>() == _roles[i].id) {
+                    listed = true;
+                    break;
+                }
+            }
+            if (!listed) {
+                _eraseRole(i);
+            }
+        }
+    }
+}
+
+void DiscordState::putChannel(JsonObjectConst channelObj, Snowflake guildId) {
+    Snowflake id = channelObj["id"].as<Snowflake>();
+    if (!enabled() || !id.isValid()) {
+        return;
+    }
+
+    DiscordChannelState* channel = _findChannel(id);
+    if (channel == nullptr) {
+        void* table = _channels;
+        if (!_grow(table, _channelCapacity, _channelCount, sizeof(DiscordChannelState))) {
+            _dropped++;
+            return;
+        }
+        _channels = (DiscordChannelState*)table;
+        channel = &_channels[_channelCount++];
+        memset(channel, 0, sizeof(DiscordChannelState));
+        channel->id = id;
+        channel->guildId = guildId;
+    }
+
+    JsonVariantConst value = channelObj["guild_id"];
+    if (!value.isNull()) {
+        channel->guildId = value.as<Snowflake>();
+    }
+    value = channelObj["type"];
+    if (!value.isNull()) {
+        channel->type = value.as<uint8_t>();
+    }
+    value = channelObj["position"];
+    if (!value.isNull()) {
+        channel->position = value.as<int16_t>();
+    }
+    value = channelObj["nsfw"];
+    if (!value.isNull()) {
+        channel->nsfw = value.as<bool>();
+    }
+    // null when the channel leaves its category
+    value = channelObj["parent_id"];
+    if (!value.isUnbound()) {
+        channel->parentId = value.as<Snowflake>();
+    }
+    if (_fields & DISCORD_STATE_NAMES) {
+        _setString(channel->name, channelObj["name"]);
+    }
+    if (_fields & DISCORD_STATE_TOPICS) {
+        _setString(channel->topic, channelObj["topic"]);
+    }
+    JsonArrayConst overwrites = channelObj["permission_overwrites"].as<JsonArrayConst>();
+    if ((_fields & DISCORD_STATE_OVERWRITES) && !overwrites.isNull()) {
+        _setOverwrites(*channel, overwrites);
+    }
+}
+
+void DiscordState::putRole(Snowflake guildId, JsonObjectConst roleObj) {
+    Snowflake id = roleObj["id"].as<Snowflake>();
+    if (!enabled() || !(_fields & DISCORD_STATE_ROLES) || !id.isValid()) {
+        return;
+    }
+
+    DiscordRoleState* role = _findRole(id);
+    if (role == nullptr) {
+        void* table = _roles;
+        if (!_grow(table, _roleCapacity, _roleCount, sizeof(DiscordRoleState))) {
+            _dropped++;
+            return;
+        }
+        _roles = (DiscordRoleState*)table;
+        role = &_roles[_roleCount++];
+        memset(role, 0, sizeof(DiscordRoleState));
+        role->id = id;
+    }
+    if (guildId.isValid()) {
+        role->guildId = guildId;
+    }
+
+    JsonVariantConst value = roleObj["permissions"];
+    if (!value.isNull()) {
+        role->permissions = parsePermissions(value);
+    }
+    value = roleObj["color"];
+    if (!value.isNull()) {
+        role->color = value.as<uint32_t>();
+    }
+    value = roleObj["position"];
+    if (!value.isNull()) {
+        role->position = value.as<int16_t>();
+    }
+    if (_fields & DISCORD_STATE_NAMES) {
+        _setString(role->name, roleObj["name"]);
+    }
+}
+
+void DiscordState::removeGuild(Snowflake guildId) {
+    if (!guildId.isValid()) {
+        return;
+    }
+    for (size_t i = _channelCount; i-- > 0;) {
+        if (_channels[i].guildId == guildId) {
+            _eraseChannel(i);
+        }
+    }
+    for (size_t i = _roleCount; i-- > 0;) {
+        if (_roles[i].guildId == guildId) {
+            _eraseRole(i);
+        }
+    }
+    for (size_t i = 0; i < _guildCount; i++) {
+        if (_guilds[i].id == guildId) {
+            _freeString(_guilds[i].name);
+            _guilds[i] = _guilds[--_guildCount];
+            break;
+        }
+    }
+}
+
+void DiscordState::removeChannel(Snowflake channelId) {
+    for (size_t i = 0; i < _channelCount; i++) {
+        if (_channels[i].id == channelId) {
+            _eraseChannel(i);
+            return;
+        }
+    }
+}
+
+void DiscordState::removeRole(Snowflake roleId) {
+    for (size_t i = 0; i < _roleCount; i++) {
+        if (_roles[i].id == roleId) {
+            _eraseRole(i);
+            return;
+        }
+    }
+}
+
+// Empties the tables but keeps them allocated
+void DiscordState::clear() {
+    while (_channelCount > 0) {
+        _eraseChannel(_channelCount - 1);
+    }
+    while (_roleCount > 0) {
+        _eraseRole(_roleCount - 1);
+    }
+    for (size_t i = 0; i < _guildCount; i++) {
+        _freeString(_guilds[i].name);
+    }
+    _guildCount = 0;
+}
+
+uint64_t DiscordState::permissions(Snowflake channelId, Snowflake userId, const Snowflake* roleIds, size_t roleCount) const {
+    const DiscordChannelState* channel = _findChannel(channelId);
+    if (channel == nullptr) {
+        return 0;
+    }
+    Snowflake guildId = channel->guildId;
+    const DiscordGuildState* guild = _findGuild(guildId);
+    if (guild != nullptr && guild->ownerId.isValid() && guild->ownerId == userId) {
+        return DISCORD_PERMISSION_ALL;
+    }
+
+    // The @everyone role has the guild's id
+    uint64_t permissions = 0;
+    const DiscordRoleState* everyone = _findRole(guildId);
+    if (everyone != nullptr) {
+        permissions = everyone->permissions;
+    }
+    for (size_t i = 0; i < roleCount; i++) {
+        const DiscordRoleState* role = _findRole(roleIds[i]);
+        if (role != nullptr && role->guildId == guildId) {
+            permissions |= role->permissions;
+        }
+    }
+    if (permissions & DISCORD_PERMISSION_ADMINISTRATOR) {
+        return DISCORD_PERMISSION_ALL;
+    }
+
+    if (channel->type >= STATE_FIRST_THREAD_TYPE && channel->type <= STATE_LAST_THREAD_TYPE) {
+        const DiscordChannelState* parent = _findChannel(channel->parentId);
+        if (parent != nullptr) {
+            channel = parent;
+        }
+    }
+
+    // @everyone overwrite, then all role overwrites together, then the member's
+    uint64_t roleAllow = 0;
+    uint64_t roleDeny = 0;
+    const DiscordPermissionOverwrite* member = nullptr;
+    for (uint16_t i = 0; i < channel->overwriteCount; i++) {
+        const DiscordPermissionOverwrite& overwrite = channel->overwrites[i];
+        if (overwrite.type == DISCORD_OVERWRITE_MEMBER) {
+            if (overwrite.id == userId) {
+                member = &overwrite;
+            }
+        } else if (overwrite.id == guildId) {
+            permissions = (permissions & ~overwrite.deny) | overwrite.allow;
+        } else {
+            for (size_t r = 0; r < roleCount; r++) {
+                if (roleIds[r] == overwrite.id) {
+                    roleAllow |= overwrite.allow;
+                    roleDeny |= overwrite.deny;
+                    break;
+                }
+            }
+        }
+    }
+    permissions = (permissions & ~roleDeny) | roleAllow;
+    if (member != nullptr) {
+        permissions = (permissions & ~member->deny) | member->allow;
+    }
+    return permissions;
+}
+
+DiscordStateStats DiscordState::stats() const {
+    DiscordStateStats stats;
+    stats.guilds = _guildCount;
+    stats.channels = _channelCount;
+    stats.roles = _roleCount;
+    stats.bytes = _bytes;
+    stats.budget = _budget;
+    stats.dropped = _dropped;
+    return stats;
+}
+
+void DiscordState::addFilter(JsonObject guildFilter, uint32_t fields) {
+    guildFilter["id"] = true;
+    guildFilter["owner_id"] = true;
+    guildFilter["unavailable"] = true;
+    if (fields & DISCORD_STATE_NAMES) {
+        guildFilter["name"] = true;
+    }
+
+    JsonObject channel = guildFilter["channels"][0].to<JsonObject>();
+    static const char* const channelFields[] = {"id", "guild_id", "type", "position", "nsfw", "parent_id"};
+    for (size_t i = 0; i < sizeof(channelFields) / sizeof(channelFields[0]); i++) {
+        channel[channelFields[i]] = true;
+    }
+    if (fields & DISCORD_STATE_NAMES) {
+        channel["name"] = true;
+    }
+    if (fields & DISCORD_STATE_TOPICS) {
+        channel["topic"] = true;
+    }
+    if (fields & DISCORD_STATE_OVERWRITES) {
+        channel["permission_overwrites"] = true;
+    }
+
+    if (fields & DISCORD_STATE_ROLES) {
+        JsonObject role = guildFilter["roles"][0].to<JsonObject>();
+        role["id"] = true;
+        role["permissions"] = true;
+        role["color"] = true;
+        role["position"] = true;
+        if (fields & DISCORD_STATE_NAMES) {
+            role["name"] = true;
+        }
+    }
+}
@@ -19,7 +19,7 @@ void onBotReady(DiscordUser user)
 {
     Serial.println("Bot is ready!");
     Serial.println("Bot name: " + user.username);
-    Serial.println("Bot ID: " + user.id);
+    Serial.println("Bot ID: " + user.id.toString());
 
     // // Reset connection state on successful connection
     // discord.resetReconnectionState();
@@ -38,30 +38,32 @@ void onBotReady(DiscordUser user)
 }
 
 // Callback function when receiving new message
-void onMessageReceived(DiscordMessage message)
+void onMessageReceived(const MessageView &message)
 {
-    Serial.println("Received message from: " + message.author.username);
-    Serial.println("Content: " + message.content);
+    Serial.print("Received message from: ");
+    Serial.println(message.authorName());
+    Serial.print("Content: ");
+    Serial.println(message.content());
 
     // Respond to messages
-    if (message.content.startsWith("!ping"))
+    if (message.contentStartsWith("!ping"))
     {
-        DiscordResponse response = discord.sendMessage(message.channel_id, "🏓 Pong! Bot is working normally.");
+        DiscordResponse response = discord.sendMessage(message.channelId(), "🏓 Pong! Bot is working normally.");
         if (response.success)
         {
             Serial.println("Responded to ping command!");
         }
     }
-    else if (message.content.startsWith("!time"))
+    else if (message.contentStartsWith("!time"))
     {
         String currentTime = String(millis() / 1000) + " seconds";
-        DiscordResponse response = discord.sendMessage(message.channel_id, "⏰ Uptime: " + currentTime);
+        DiscordResponse response = discord.sendMessage(message.channelId(), "⏰ Uptime: " + currentTime);
         if (response.success)
         {
             Serial.println("Sent uptime!");
         }
     }
-    else if (message.content.startsWith("!help"))
+    else if (message.contentStartsWith("!help"))
     {
         String helpText = "📋 **Available commands:**\n";
         helpText += "`!ping` - Check bot\n";
@@ -71,13 +73,13 @@ void onMessageReceived(DiscordMessage message)
         helpText += "`!debug` - Debug connection state\n";
         helpText += "`!reset` - Reset connection\n";
 
-        DiscordResponse response = discord.sendMessage(message.channel_id, helpText);
+        DiscordResponse response = discord.sendMessage(message.channelId(), helpText);
         if (response.success)
         {
             Serial.println("Sent help!");
         }
     }
-    else if (message.content.startsWith("!status"))
+    else if (message.contentStartsWith("!status"))
     {
         String statusText = "📊 **System Status:**\n";
         statusText += "• WiFi: " + String(WiFi.isConnected() ? "✅ Connected" : "❌ Disconnected") + "\n";
@@ -85,25 +87,25 @@ void onMessageReceived(DiscordMessage message)
         statusText += "• Free RAM: " + String(ESP.getFreeHeap()) + " bytes\n";
         statusText += "• Uptime: " + String(millis() / 1000) + " seconds";
 
-        DiscordResponse response = discord.sendMessage(message.channel_id, statusText);
+        DiscordResponse response = discord.sendMessage(message.channelId(), statusText);
         if (response.success)
         {
             Serial.println("Sent system status!");
         }
     }
-    else if (message.content.startsWith("!debug"))
+    else if (message.contentStartsWith("!debug"))
     {
         discord.debugConnectionState();
-        DiscordResponse response = discord.sendMessage(message.channel_id, "🔍 Debug info sent to console");
+        DiscordResponse response = discord.sendMessage(message.channelId(), "🔍 Debug info sent to console");
         if (response.success)
         {
             Serial.println("Sent debug info!");
         }
     }
-    else if (message.content.startsWith("!reset"))
+    else if (message.contentStartsWith("!reset"))
     {
         discord.forceDisconnect();
-        DiscordResponse response = discord.sendMessage(message.channel_id, "🔄 Connection reset initiated");
+        DiscordResponse response = discord.sendMessage(message.channelId(), "🔄 Connection reset initiated");
         if (response.success)
         {
             Serial.println("Sent reset command!");
@@ -279,5 +281,7 @@ void loop()
         }
     }
 
-    delay(100);
+    // Heartbeats have their own task; this only paces event handling, and
+    // the client reads one frame per discord.loop()
+    delay(10);
 }
\ No newline at end of file